@@ -5,14 +5,14 @@
 #ifndef PROJECT_BASE_COMMON_H
 #define PROJECT_BASE_COMMON_H
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <learnopengl/filesystem.h>
 
-std::string readFileContents(std::string path) {
-    std::ifstream in(path);
-    std::stringstream buffer;
-    buffer << in.rdbuf();
-    return buffer.str();
+inline std::string readFileContents(std::string path) {
+    AssetData data = FileSystem::read(path);
+    if (!data.valid())
+        return std::string();
+    AssetIoStats::instance().addCopied(path, data.size());
+    return data.str();
 }
 
 
@@ -0,0 +1,64 @@
+#ifndef AFFINE_MATH_H
+#define AFFINE_MATH_H
+
+#include <glm/glm.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Normal matrices of affine transforms (last row 0 0 0 1), computed once per object on the CPU instead
+// of transpose(inverse(model)) per vertex. Only the upper 3x3 part A matters. With a, b, c the columns
+// of A, the rows of inverse(A) are b x c, c x a and a x b over det = a . (b x c), so
+// transpose(inverse(A)) has them as columns: three cross products and one reciprocal, and no general
+// 4x4 inverse.
+
+// the 3x3 normal matrix of model as std140/std430 lay out a mat3: each column padded to a vec4
+struct NormalMatrix {
+    glm::vec4 columns[3];
+};
+
+#ifdef __SSE2__
+namespace affine_math_detail {
+    // a x b in xyz; w is a.w * b.w - a.w * b.w, 0 for the columns of an affine transform
+    inline __m128 cross(__m128 a, __m128 b)
+    {
+        __m128 a1 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 b1 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 zxy = _mm_sub_ps(_mm_mul_ps(a, b1), _mm_mul_ps(a1, b));
+        return _mm_shuffle_ps(zxy, zxy, _MM_SHUFFLE(3, 0, 2, 1));
+    }
+}
+#endif
+
+inline NormalMatrix affineNormalMatrix(const glm::mat4 &model)
+{
+    NormalMatrix normal;
+#ifdef __SSE2__
+    using affine_math_detail::cross;
+    __m128 a = _mm_loadu_ps(&model[0][0]), b = _mm_loadu_ps(&model[1][0]), c = _mm_loadu_ps(&model[2][0]);
+    // the translation column is never loaded, but a projective last row would leak into w
+    const __m128 xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    a = _mm_and_ps(a, xyz);
+    b = _mm_and_ps(b, xyz);
+    c = _mm_and_ps(c, xyz);
+    __m128 bc = cross(b, c), ca = cross(c, a), ab = cross(a, b);
+    __m128 d = _mm_mul_ps(a, bc);
+    d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)));
+    d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 3, 2)));
+    __m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), d);
+    _mm_storeu_ps(&normal.columns[0][0], _mm_mul_ps(bc, scale));
+    _mm_storeu_ps(&normal.columns[1][0], _mm_mul_ps(ca, scale));
+    _mm_storeu_ps(&normal.columns[2][0], _mm_mul_ps(ab, scale));
+#else
+    glm::vec3 a(model[0]), b(model[1]), c(model[2]);
+    glm::vec3 bc = glm::cross(b, c), ca = glm::cross(c, a), ab = glm::cross(a, b);
+    float scale = 1.0f / glm::dot(a, bc);
+    normal.columns[0] = glm::vec4(bc * scale, 0.0f);
+    normal.columns[1] = glm::vec4(ca * scale, 0.0f);
+    normal.columns[2] = glm::vec4(ab * scale, 0.0f);
+#endif
+    return normal;
+}
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <learnopengl/mapped_file.h>
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Pack file layout (little endian):
+//   AssetPackHeader
+//   blobs, each aligned to ASSET_PACK_ALIGNMENT
+//   AssetPackEntry[entryCount] sorted by pathHash, starting at indexOffset
+// Paths are never stored, entries are found by the FNV-1a hash of their normalized relative path.
+
+const uint32_t ASSET_PACK_MAGIC = 0x4b504752; // "RGPK"
+const uint32_t ASSET_PACK_VERSION = 1;
+const uint64_t ASSET_PACK_ALIGNMENT = 16;
+
+enum AssetCompression : uint32_t {
+    ASSET_COMPRESSION_NONE = 0,
+    ASSET_COMPRESSION_LZ4 = 1
+};
+
+struct AssetPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t indexOffset;
+};
+
+struct AssetPackEntry {
+    uint64_t pathHash;
+    uint64_t offset;
+    uint32_t storedSize;
+    uint32_t rawSize;
+    uint32_t compression;
+    uint32_t reserved;
+};
+
+// turns "./a\\b/../c.png" into "a/c.png" so every spelling of a path hashes the same
+inline std::string normalizeAssetPath(const std::string &path)
+{
+    std::vector<std::string> parts;
+    std::string part;
+    for (size_t i = 0; i <= path.size(); i++) {
+        char c = i < path.size() ? path[i] : '/';
+        if (c == '/' || c == '\\') {
+            if (part == "..") {
+                if (!parts.empty())
+                    parts.pop_back();
+            } else if (!part.empty() && part != ".") {
+                parts.push_back(part);
+            }
+            part.clear();
+        } else {
+            part += c;
+        }
+    }
+    std::string result;
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (i)
+            result += '/';
+        result += parts[i];
+    }
+    return result;
+}
+
+inline uint64_t hashAssetPath(const std::string &normalizedPath)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : normalizedPath) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Read side of a pack. The whole file stays mapped for the lifetime of the reader, so uncompressed
+// entries are returned as views into the mapping without any syscall or copy.
+class AssetPackReader
+{
+public:
+    bool open(const std::string &path)
+    {
+        if (!file.open(path))
+            return false;
+        const AssetPackHeader *header = reinterpret_cast<const AssetPackHeader*>(file.data());
+        if (file.size() < sizeof(AssetPackHeader) || header->magic != ASSET_PACK_MAGIC || header->version != ASSET_PACK_VERSION
+            || header->indexOffset + (uint64_t)header->entryCount * sizeof(AssetPackEntry) > file.size()) {
+            std::cout << "ERROR::ASSET_PACK::INVALID " << path << std::endl;
+            file.close();
+            return false;
+        }
+        packPath = path;
+        entries = reinterpret_cast<const AssetPackEntry*>(file.data() + header->indexOffset);
+        entryCount = header->entryCount;
+        return true;
+    }
+
+    bool valid() const { return file.valid(); }
+    uint32_t size() const { return entryCount; }
+
+    const AssetPackEntry* find(const std::string &path) const
+    {
+        if (!valid())
+            return nullptr;
+        uint64_t hash = hashAssetPath(normalizeAssetPath(path));
+        const AssetPackEntry *end = entries + entryCount;
+        const AssetPackEntry *it = std::lower_bound(entries, end, hash,
+                [](const AssetPackEntry &e, uint64_t h) { return e.pathHash < h; });
+        return it != end && it->pathHash == hash ? it : nullptr;
+    }
+
+    AssetData read(const std::string &path) const
+    {
+        auto start = std::chrono::steady_clock::now();
+        const AssetPackEntry *entry = find(path);
+        if (!entry || entry->offset + entry->storedSize > file.size())
+            return AssetData();
+        const unsigned char *blob = file.data() + entry->offset;
+        if (entry->compression == ASSET_COMPRESSION_NONE) {
+            AssetIoStats::instance().record(path, asset_io_detail::secondsSince(start), entry->rawSize, 0, "pack");
+            return AssetData::fromView(blob, entry->rawSize);
+        }
+#ifdef HAVE_LZ4
+        if (entry->compression == ASSET_COMPRESSION_LZ4) {
+            std::vector<unsigned char> buffer(entry->rawSize);
+            int n = LZ4_decompress_safe(reinterpret_cast<const char*>(blob), reinterpret_cast<char*>(buffer.data()),
+                                        (int)entry->storedSize, (int)entry->rawSize);
+            if (n == (int)entry->rawSize) {
+                AssetIoStats::instance().record(path, asset_io_detail::secondsSince(start), entry->rawSize, entry->rawSize, "pack+lz4");
+                return AssetData::fromBuffer(std::move(buffer));
+            }
+        }
+#endif
+        std::cout << "ERROR::ASSET_PACK::CANNOT_DECODE " << path << " in " << packPath << std::endl;
+        return AssetData();
+    }
+
+private:
+    MappedFile file;
+    std::string packPath;
+    const AssetPackEntry *entries = nullptr;
+    uint32_t entryCount = 0;
+};
+
+// one entry as it goes into a pack, stored bytes and index entry without the offset; path is the
+// normalized path the entry's hash was made from
+struct AssetPackBlob {
+    std::string path;
+    AssetPackEntry entry;
+    std::vector<unsigned char> blob;
+};
+
+// Builds a pack in memory and writes it out in one go. Entries are compressed with LZ4 when it is
+// available and actually makes the blob smaller; already compressed data such as jpg is stored as is.
+class AssetPackWriter
+{
+public:
+    // compresses one entry; touches no writer state, so blobs can be made on several threads and
+    // added afterwards
+    static AssetPackBlob makeBlob(const std::string &path, const unsigned char *data, size_t size, bool compress = true)
+    {
+        AssetPackBlob p;
+        p.path = normalizeAssetPath(path);
+        p.entry.pathHash = hashAssetPath(p.path);
+        p.entry.rawSize = (uint32_t)size;
+        p.entry.compression = ASSET_COMPRESSION_NONE;
+        p.entry.reserved = 0;
+#ifdef HAVE_LZ4
+        if (compress && size > 0) {
+            std::vector<unsigned char> packed((size_t)LZ4_compressBound((int)size));
+            int n = LZ4_compress_default(reinterpret_cast<const char*>(data), reinterpret_cast<char*>(packed.data()),
+                                         (int)size, (int)packed.size());
+            if (n > 0 && (size_t)n < size - size / 8) {
+                packed.resize((size_t)n);
+                p.blob = std::move(packed);
+                p.entry.compression = ASSET_COMPRESSION_LZ4;
+            }
+        }
+#endif
+        if (p.entry.compression == ASSET_COMPRESSION_NONE)
+            p.blob.assign(data, data + size);
+        p.entry.storedSize = (uint32_t)p.blob.size();
+        return p;
+    }
+
+    void add(const std::string &path, const unsigned char *data, size_t size, bool compress = true)
+    {
+        add(makeBlob(path, data, size, compress));
+    }
+
+    // an entry from makeBlob, replacing any earlier one for the same path. A different path with the same
+    // hash stays, and fails write()
+    void add(AssetPackBlob p)
+    {
+        pending.erase(std::remove_if(pending.begin(), pending.end(),
+                [&](const AssetPackBlob &o) { return o.path == p.path; }), pending.end());
+        pending.push_back(std::move(p));
+    }
+
+    bool write(const std::string &path)
+    {
+        std::sort(pending.begin(), pending.end(),
+                [](const AssetPackBlob &a, const AssetPackBlob &b) { return a.entry.pathHash < b.entry.pathHash; });
+        for (size_t i = 1; i < pending.size(); i++) {
+            if (pending[i].entry.pathHash == pending[i - 1].entry.pathHash) {
+                std::cout << "ERROR::ASSET_PACK::HASH_COLLISION " << path << ": " << pending[i - 1].path << " and "
+                          << pending[i].path << std::endl;
+                return false;
+            }
+        }
+
+        std::vector<unsigned char> out(sizeof(AssetPackHeader));
+        std::vector<AssetPackEntry> index;
+        for (AssetPackBlob &p : pending) {
+            out.resize((out.size() + ASSET_PACK_ALIGNMENT - 1) & ~(ASSET_PACK_ALIGNMENT - 1));
+            p.entry.offset = out.size();
+            out.insert(out.end(), p.blob.begin(), p.blob.end());
+            index.push_back(p.entry);
+        }
+        out.resize((out.size() + ASSET_PACK_ALIGNMENT - 1) & ~(ASSET_PACK_ALIGNMENT - 1));
+
+        AssetPackHeader header;
+        header.magic = ASSET_PACK_MAGIC;
+        header.version = ASSET_PACK_VERSION;
+        header.entryCount = (uint32_t)index.size();
+        header.reserved = 0;
+        header.indexOffset = out.size();
+        std::memcpy(out.data(), &header, sizeof(header));
+        const unsigned char *indexBytes = reinterpret_cast<const unsigned char*>(index.data());
+        out.insert(out.end(), indexBytes, indexBytes + index.size() * sizeof(AssetPackEntry));
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(out.data()), (std::streamsize)out.size());
+        return (bool)file;
+    }
+
+    size_t size() const { return pending.size(); }
+
+private:
+    std::vector<AssetPackBlob> pending;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <learnopengl/light_clusters.h>
+#include <learnopengl/job_system.h>
+#include <learnopengl/stream_buffer.h>
+#include <learnopengl/gl_backend.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// Clustered forward lighting: LightClusters assigns the point lights to froxels on the job system, and
+// this writes the result into a StreamBuffer, read by the lit fragment shaders through three texture
+// buffers over it (3.1 core, so the GL 3.3 fallback has them too):
+//   lightData    RGBA32F, 4 texels per light: position + radius, ambient + constant, diffuse + linear,
+//                specular + quadratic
+//   lightGrid    RG32UI, offset and count into lightIndices per cluster
+//   lightIndices R32UI
+// They sit on texture units TEXTURE_UNIT.. so they never collide with material samplers. The texture
+// buffers are attached through StreamBuffer::attachTexture; where this frame's data starts in them goes
+// to the shaders as the lightDataBase, lightGridBase and lightIndexBase uniforms, in texels of each format.
+class ClusteredLighting
+{
+public:
+    static const int TEXTURE_UNIT = 8;
+
+    LightClusters clusters;
+
+    explicit ClusteredLighting(StreamBuffer &stream) : stream(stream)
+    {
+        for (GLuint &texture : textures)
+            texture = GLBackend::createTexture(GL_TEXTURE_BUFFER);
+    }
+
+    ~ClusteredLighting()
+    {
+        glDeleteTextures(3, textures);
+    }
+
+    ClusteredLighting(const ClusteredLighting&) = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    // assigns lights to the clusters of this frame's camera; no GL, so it can run as a job. fovy in radians
+    void assign(const std::vector<PointLight> &lights, const glm::mat4 &view, float fovy, float aspect,
+                float zNear, float zFar, JobSystem &jobs)
+    {
+        clusters.setProjection(fovy, aspect, zNear, zFar);
+        clusters.assign(lights, view, jobs);
+    }
+
+    // writes lights and their last assignment to the stream buffer, which has to be in its frame already
+    void upload(const std::vector<PointLight> &lights)
+    {
+        lightData.resize(lights.size() * 4);
+        for (size_t i = 0; i < lights.size(); i++) {
+            const PointLight &light = lights[i];
+            lightData[i * 4 + 0] = glm::vec4(light.position, light.radius());
+            lightData[i * 4 + 1] = glm::vec4(light.ambient, light.constant);
+            lightData[i * 4 + 2] = glm::vec4(light.diffuse, light.linear);
+            lightData[i * 4 + 3] = glm::vec4(light.specular, light.quadratic);
+        }
+        write(0, lightData.data(), lightData.size() * sizeof(glm::vec4));
+        write(1, clusters.grid.data(), clusters.grid.size() * sizeof(uint32_t));
+        write(2, clusters.indices.data(), clusters.indices.size() * sizeof(uint32_t));
+    }
+
+    // binds the buffers and sets the cluster uniforms; call whenever a lit shader starts a frame
+    void bind(Shader &shader) const
+    {
+        const char *names[3] = {"lightData", "lightGrid", "lightIndices"};
+        const char *bases[3] = {"lightDataBase", "lightGridBase", "lightIndexBase"};
+        for (int i = 0; i < 3; i++) {
+            GLBackend::bindTexture(TEXTURE_UNIT + i, GL_TEXTURE_BUFFER, textures[i]);
+            shader.setInt(names[i], TEXTURE_UNIT + i);
+            shader.setInt(bases[i], (int)firstTexels[i]);
+        }
+        GLBackend::resetActiveTexture();
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        shader.setVec2("clusterTileSize", (float)viewport[2] / LightClusters::X, (float)viewport[3] / LightClusters::Y);
+        shader.setVec3("clusterCount", glm::vec3(LightClusters::X, LightClusters::Y, LightClusters::Z));
+        shader.setFloat("clusterScale", clusters.sliceScale());
+        shader.setFloat("clusterBias", clusters.sliceBias());
+    }
+
+private:
+    StreamBuffer &stream;
+    GLuint textures[3] = {0, 0, 0};
+    GLuint attached[3] = {0, 0, 0};    // stream buffer object each texture views whole
+    size_t firstTexels[3] = {0, 0, 0}; // where this frame's data starts in each texture
+    std::vector<glm::vec4> lightData;
+
+    void write(int index, const void *data, size_t size)
+    {
+        const GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+        const size_t texelBytes[3] = {16, 8, 4};
+        StreamAllocation allocation = stream.allocateTexels(size, texelBytes[index]);
+        std::memcpy(allocation.data, data, size);
+        stream.commit(allocation);
+        firstTexels[index] = StreamBuffer::attachTexture(textures[index], formats[index], texelBytes[index], allocation,
+                                                         attached[index]);
+    }
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef COMMAND_RECORDER_H
+#define COMMAND_RECORDER_H
+
+#include <learnopengl/render_queue.h>
+#include <learnopengl/job_system.h>
+
+#include <functional>
+#include <vector>
+
+// Fills one CommandList per job system worker from contiguous ranges of objects, so recording scales with
+// the number of cores and never touches GL.
+class CommandRecorder
+{
+public:
+    std::vector<CommandList> lists;
+
+    explicit CommandRecorder(JobSystem &jobs) : lists(jobs.threadCount()), jobs(jobs) {}
+
+    unsigned int threadCount() const { return (unsigned int)lists.size(); }
+
+    // splits [0, count) into one contiguous range per list and calls fn(list, begin, end) for each;
+    // fn must not touch GL. Returns once every range is recorded.
+    void record(size_t count, const glm::mat4 &view, const std::function<void(CommandList&, size_t, size_t)> &fn)
+    {
+        for (CommandList &list : lists)
+            list.begin(view);
+        size_t parts = lists.size();
+        jobs.run((unsigned int)parts, [&](unsigned int task, unsigned int) {
+            size_t begin = count * task / parts, end = count * (task + 1) / parts;
+            if (begin < end)
+                fn(lists[task], begin, end);
+        });
+    }
+
+    // adds every list to queue; the lists stay valid until the next record
+    void submitTo(RenderQueue &queue) const
+    {
+        for (const CommandList &list : lists)
+            queue.add(list);
+    }
+
+private:
+    JobSystem &jobs;
+};
+
+#endif
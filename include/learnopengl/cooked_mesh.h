@@ -0,0 +1,139 @@
+#ifndef COOKED_MESH_H
+#define COOKED_MESH_H
+
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mesh_data.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Models cooked by asset_cooker are the MeshData the native OBJ reader produces, stored flat behind this
+// header, so loading one is a copy instead of a parse. The pack keeps the source next to it under its own
+// path (Assimp still reads that); the cooked meshes go in as path + COOKED_MESH_SUFFIX.
+//
+// Layout after the header, per mesh: vertex, index and texture counts (uint32), the material name, then
+// a (type, path) pair per texture, every string as a uint32 length and its bytes; then the meshes'
+// Vertex arrays and index arrays in the same order. Vertex is stored as laid out in memory, so a change to
+// it needs a new COOKED_MESH_VERSION.
+const uint32_t COOKED_MESH_MAGIC = 0x534d4752; // "RGMS"
+const uint32_t COOKED_MESH_VERSION = 1;
+const char * const COOKED_MESH_SUFFIX = ".mesh";
+
+struct CookedMeshHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t reserved;
+};
+
+namespace cooked_mesh_detail {
+    inline void put(std::vector<unsigned char> &out, const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    inline void putString(std::vector<unsigned char> &out, const std::string &s)
+    {
+        uint32_t length = (uint32_t)s.size();
+        put(out, &length, sizeof(length));
+        put(out, s.data(), s.size());
+    }
+
+    // bounds checked reads from a cooked blob
+    struct Reader {
+        const unsigned char *p, *end;
+
+        bool get(void *data, size_t size)
+        {
+            if ((size_t)(end - p) < size)
+                return false;
+            std::memcpy(data, p, size);
+            p += size;
+            return true;
+        }
+
+        bool getString(std::string &s)
+        {
+            uint32_t length;
+            if (!get(&length, sizeof(length)) || (size_t)(end - p) < length)
+                return false;
+            s.assign(reinterpret_cast<const char*>(p), length);
+            p += length;
+            return true;
+        }
+    };
+}
+
+inline std::vector<unsigned char> cookMeshes(const std::vector<MeshData> &meshes)
+{
+    using namespace cooked_mesh_detail;
+    std::vector<unsigned char> out;
+    CookedMeshHeader header;
+    header.magic = COOKED_MESH_MAGIC;
+    header.version = COOKED_MESH_VERSION;
+    header.meshCount = (uint32_t)meshes.size();
+    header.reserved = 0;
+    put(out, &header, sizeof(header));
+    for (const MeshData &mesh : meshes) {
+        uint32_t counts[3] = {(uint32_t)mesh.vertices.size(), (uint32_t)mesh.indices.size(), (uint32_t)mesh.textures.size()};
+        put(out, counts, sizeof(counts));
+        putString(out, mesh.material);
+        for (const auto &texture : mesh.textures) {
+            putString(out, texture.first);
+            putString(out, texture.second);
+        }
+    }
+    for (const MeshData &mesh : meshes) {
+        put(out, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+        put(out, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+    }
+    return out;
+}
+
+// the meshes of a cooked blob; false, with meshes empty, if it is not one or is cut short
+inline bool readCookedMeshes(const AssetData &file, std::vector<MeshData> &meshes)
+{
+    using namespace cooked_mesh_detail;
+    meshes.clear();
+    if (!file.valid())
+        return false;
+    Reader in = {file.data(), file.data() + file.size()};
+    CookedMeshHeader header;
+    if (!in.get(&header, sizeof(header)) || header.magic != COOKED_MESH_MAGIC || header.version != COOKED_MESH_VERSION)
+        return false;
+    // every mesh takes at least its three counts
+    if (header.meshCount > (size_t)(in.end - in.p) / 12)
+        return false;
+    std::vector<uint32_t> vertexCounts(header.meshCount), indexCounts(header.meshCount);
+    meshes.resize(header.meshCount);
+    bool ok = true;
+    for (uint32_t m = 0; ok && m < header.meshCount; m++) {
+        uint32_t counts[3] = {0, 0, 0};
+        ok = in.get(counts, sizeof(counts)) && in.getString(meshes[m].material);
+        vertexCounts[m] = counts[0];
+        indexCounts[m] = counts[1];
+        for (uint32_t t = 0; ok && t < counts[2]; t++) {
+            std::pair<std::string, std::string> texture;
+            ok = in.getString(texture.first) && in.getString(texture.second);
+            meshes[m].textures.push_back(texture);
+        }
+    }
+    for (uint32_t m = 0; ok && m < header.meshCount; m++) {
+        size_t vertexBytes = (size_t)vertexCounts[m] * sizeof(Vertex), indexBytes = (size_t)indexCounts[m] * sizeof(unsigned int);
+        ok = (size_t)(in.end - in.p) >= vertexBytes + indexBytes;
+        if (!ok)
+            break;
+        meshes[m].vertices.resize(vertexCounts[m]);
+        meshes[m].indices.resize(indexCounts[m]);
+        in.get(meshes[m].vertices.data(), vertexBytes);
+        in.get(meshes[m].indices.data(), indexBytes);
+    }
+    if (!ok)
+        meshes.clear();
+    return ok;
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+#include <stb_image.h>
+
+#include <learnopengl/mapped_file.h>
+
+#include <cstdint>
+#include <cstring>
+
+// Textures cooked by asset_cooker are stored as raw 8 bit pixels behind this header, so loading them
+// is an upload instead of a jpg/png decode. Anything without the magic is handed to stb_image.
+const uint32_t COOKED_TEXTURE_MAGIC = 0x58544752; // "RGTX"
+const uint32_t COOKED_TEXTURE_VERSION = 1;
+
+struct CookedTextureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t components;
+    uint32_t reserved;
+};
+
+// decoded pixels of a texture; either points into the asset data or owns an stb_image allocation
+class TextureImage
+{
+public:
+    int width = 0, height = 0, components = 0;
+    const unsigned char *pixels = nullptr;
+
+    TextureImage() {}
+    ~TextureImage() { if (decoded) stbi_image_free(decoded); }
+    TextureImage(const TextureImage&) = delete;
+    TextureImage& operator=(const TextureImage&) = delete;
+
+    bool decode(const AssetData &file)
+    {
+        if (!file.valid())
+            return false;
+        CookedTextureHeader header;
+        if (file.size() >= sizeof(header)) {
+            std::memcpy(&header, file.data(), sizeof(header));
+            if (header.magic == COOKED_TEXTURE_MAGIC && header.version == COOKED_TEXTURE_VERSION
+                && file.size() >= sizeof(header) + (size_t)header.width * header.height * header.components) {
+                width = (int)header.width;
+                height = (int)header.height;
+                components = (int)header.components;
+                pixels = file.data() + sizeof(header);
+                return true;
+            }
+        }
+        decoded = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &components, 0);
+        pixels = decoded;
+        return pixels != nullptr;
+    }
+
+private:
+    unsigned char *decoded = nullptr;
+};
+
+#endif
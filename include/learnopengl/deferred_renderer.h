@@ -0,0 +1,110 @@
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <learnopengl/frame_graph.h>
+#include <learnopengl/gpu_timer.h>
+
+#include <functional>
+#include <vector>
+
+// Deferred shading next to the forward path. Lit surfaces are drawn with gbuffer.fs into a compact
+// G-buffer, 14 bytes per pixel:
+//   normal    RG16     octahedral encoding
+//   albedo    RGBA8
+//   specular  RG8      specular map intensity, log2(shininess) / 8
+//   depth     DEPTH24_STENCIL8, world positions are reconstructed from it
+// A full-screen pass then shades every pixel once, with the same clustered light lists as pyramid.fs,
+// and writes the depth next to the color so forward passes can follow. The G-buffer is transient, the
+// frame graph allocates it for the two passes.
+class DeferredRenderer
+{
+public:
+    static const unsigned int BYTES_PER_PIXEL = 4 + 4 + 2 + 4;
+
+    GpuTimer geometryTimer, lightingTimer;
+
+    DeferredRenderer() : lightingShader("resources/shaders/deferred_lighting.vs", "resources/shaders/deferred_lighting.fs")
+    {
+        emptyVAO = GLBackend::createVertexArray();
+    }
+
+    ~DeferredRenderer()
+    {
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteProgram(lightingShader.ID);
+    }
+
+    DeferredRenderer(const DeferredRenderer&) = delete;
+    DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+    // the geometry pass, with drawGeometry drawing the lit surfaces into the cleared G-buffer, and the
+    // lighting pass shading it into color and depth. setLights sets the camera, dirLight and cluster
+    // uniforms, the same ones the forward shader takes.
+    void addPasses(FrameGraph &graph, int width, int height, FrameGraphHandle color, FrameGraphHandle depth,
+                   std::function<void()> drawGeometry, const glm::mat4 &viewProjection,
+                   std::function<void(Shader&)> setLights)
+    {
+        this->width = width;
+        this->height = height;
+        FrameGraphHandle gbuffer[4] = {
+                graph.createTexture("gbuffer normal", TextureDesc(width, height, GL_RG16)),
+                graph.createTexture("gbuffer albedo", TextureDesc(width, height, GL_RGBA8)),
+                graph.createTexture("gbuffer specular", TextureDesc(width, height, GL_RG8)),
+                graph.createTexture("gbuffer depth", TextureDesc(width, height, GL_DEPTH24_STENCIL8))
+        };
+        graph.addPass("gbuffer", [&](FrameGraph::Builder &builder) {
+            for (FrameGraphHandle target : gbuffer)
+                builder.write(target);
+        }, [this, drawGeometry](const FrameGraph::Resources&) {
+            geometryTimer.begin();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawGeometry();
+            geometryTimer.end();
+        });
+        std::vector<FrameGraphHandle> inputs(gbuffer, gbuffer + 4);
+        graph.addPass("deferred lighting", [&](FrameGraph::Builder &builder) {
+            for (FrameGraphHandle target : gbuffer)
+                builder.read(target);
+            builder.write(color);
+            builder.write(depth);
+        }, [this, inputs, viewProjection, setLights](const FrameGraph::Resources &resources) {
+            lightingTimer.begin();
+            GLuint textures[4];
+            for (int i = 0; i < 4; i++)
+                textures[i] = resources.texture(inputs[i]);
+            light(textures, viewProjection, setLights);
+            lightingTimer.end();
+        });
+    }
+
+    size_t memoryBytes() const { return (size_t)width * height * BYTES_PER_PIXEL; }
+
+private:
+    Shader lightingShader;
+    GLuint emptyVAO = 0;
+    int width = 0, height = 0;
+
+    void light(const GLuint textures[4], const glm::mat4 &viewProjection, const std::function<void(Shader&)> &setLights)
+    {
+        lightingShader.use();
+        setLights(lightingShader);
+        lightingShader.setMat4("inverseViewProjection", glm::inverse(viewProjection));
+        const char *names[4] = {"gNormal", "gAlbedo", "gSpecular", "gDepth"};
+        for (int i = 0; i < 4; i++) {
+            GLBackend::bindTexture(i, GL_TEXTURE_2D, textures[i]);
+            lightingShader.setInt(names[i], i);
+        }
+        glDepthFunc(GL_ALWAYS);
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glDepthFunc(GL_LESS);
+        GLBackend::resetActiveTexture();
+    }
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef DEPTH_PREPASS_H
+#define DEPTH_PREPASS_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gpu_timer.h>
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum DepthPrepassMode {
+    DEPTH_PREPASS_OFF,
+    DEPTH_PREPASS_ON,
+    DEPTH_PREPASS_AUTO
+};
+
+// Per object class bookkeeping for a depth only prepass. A class with the prepass on draws its depth
+// with a position only shader first, then shades with GL_LEQUAL and depth writes off, so early-Z lets
+// exactly the visible fragments through. Each class is wrapped in GL_SAMPLES_PASSED queries in both
+// passes. With early-Z, samples passed is what the fragment shader runs on, and the prepass draws in
+// the same order as the main pass would, so
+//   prepass samples - shaded samples = fragment shader invocations the prepass saved.
+// AUTO classes keep the prepass while the fragments saved outweigh the extra vertex work
+// (FRAGMENTS_PER_VERTEX each), checked every PROBE_INTERVAL frames. Classes that dropped it turn it
+// back on for PROBE_FRAMES then to measure again.
+class DepthPrepass
+{
+public:
+    static const unsigned int FRAGMENTS_PER_VERTEX = 4;
+    static const unsigned int PROBE_INTERVAL = 300;
+    static const unsigned int PROBE_FRAMES = 8;
+
+    int addClass(const std::string &name, DepthPrepassMode mode)
+    {
+        classes.emplace_back(new ObjectClass(name, mode));
+        return (int)classes.size() - 1;
+    }
+
+    size_t classCount() const { return classes.size(); }
+    bool enabled(int id) const { return classes[id]->enabled; }
+    DepthPrepassMode mode(int id) const { return classes[id]->mode; }
+
+    void setMode(int id, DepthPrepassMode mode)
+    {
+        classes[id]->mode = mode;
+        if (mode == DEPTH_PREPASS_AUTO)
+            startProbe(*classes[id]);
+    }
+
+    // decides which classes draw a prepass this frame
+    void beginFrame()
+    {
+        frame++;
+        for (std::unique_ptr<ObjectClass> &c : classes) {
+            if (c->mode != DEPTH_PREPASS_AUTO) {
+                c->enabled = c->mode == DEPTH_PREPASS_ON;
+                continue;
+            }
+            if (c->probeFrames) {
+                c->enabled = true;
+                if (--c->probeFrames == 0)
+                    decide(*c);
+            } else if (frame % PROBE_INTERVAL == 0) {
+                // while on, the counters keep measuring, so just look again
+                if (c->worthIt)
+                    decide(*c);
+                if (!c->worthIt)
+                    startProbe(*c);
+                c->enabled = true;
+            } else {
+                c->enabled = c->worthIt;
+            }
+        }
+    }
+
+    // wrap the class's draws in the depth pass, vertices being what they submitted
+    void beginPrepass(int id) { classes[id]->prepassSamples.begin(); }
+    void endPrepass(int id, unsigned int vertices)
+    {
+        ObjectClass &c = *classes[id];
+        c.prepassSamples.end();
+        c.vertices += vertices;
+        c.vertexFrames++;
+    }
+
+    // wrap the class's draws in the main pass; sets the depth state for it
+    void beginShading(int id)
+    {
+        if (classes[id]->enabled) {
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_FALSE);
+        }
+        classes[id]->shadedSamples.begin();
+    }
+    void endShading(int id)
+    {
+        classes[id]->shadedSamples.end();
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    // one line per class, then starts averaging afresh (except for probes in flight)
+    void report(std::ostream &out)
+    {
+        static const char *modes[3] = {"off", "on", "auto"};
+        for (std::unique_ptr<ObjectClass> &c : classes) {
+            out << "  " << c->name << ": prepass " << (c->enabled ? "on" : "off") << " (" << modes[c->mode] << "), "
+                << (unsigned long)c->shadedSamples.average() << " fragments shaded";
+            double saved = c->saved;
+            if (c->enabled && c->prepassSamples.resultCount())
+                saved = c->prepassSamples.average() - c->shadedSamples.average();
+            if (c->enabled || c->mode == DEPTH_PREPASS_AUTO)
+                out << ", " << (long)saved << " saved";
+            if (c->vertexFrames)
+                out << ", " << c->vertices / c->vertexFrames << " prepass vertices";
+            out << std::endl;
+            if (!c->probeFrames) {
+                c->shadedSamples.reset();
+                c->prepassSamples.reset();
+                c->vertices = c->vertexFrames = 0;
+            }
+        }
+    }
+
+private:
+    struct ObjectClass {
+        std::string name;
+        DepthPrepassMode mode;
+        bool enabled = true;
+        bool worthIt = true;      // AUTO: outcome of the last probe
+        unsigned int probeFrames = PROBE_FRAMES;
+        double saved = 0.0;       // fragments saved per frame at the last probe
+        GpuCounter prepassSamples{GL_SAMPLES_PASSED};
+        GpuCounter shadedSamples{GL_SAMPLES_PASSED};
+        unsigned long vertices = 0;
+        unsigned long vertexFrames = 0;
+
+        ObjectClass(const std::string &name, DepthPrepassMode mode) : name(name), mode(mode) {}
+    };
+
+    std::vector<std::unique_ptr<ObjectClass>> classes;
+    unsigned long frame = 0;
+
+    void startProbe(ObjectClass &c)
+    {
+        c.probeFrames = PROBE_FRAMES;
+        c.prepassSamples.reset();
+        c.shadedSamples.reset();
+        c.vertices = c.vertexFrames = 0;
+    }
+
+    void decide(ObjectClass &c)
+    {
+        // results lag a few frames; without any, keep the previous decision
+        if (!c.prepassSamples.resultCount() || !c.vertexFrames)
+            return;
+        c.saved = c.prepassSamples.average() - c.shadedSamples.average();
+        c.worthIt = c.saved > (double)FRAGMENTS_PER_VERTEX * c.vertices / c.vertexFrames;
+    }
+};
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef ECS_H
+#define ECS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Entities with their components stored by archetype, the exact set of component types an entity has.
+// Each archetype keeps its entities in Chunk::BYTES blocks: the entity ids, then one array per component
+// type, so a system reading two components of a thousand entities walks two dense arrays instead of a
+// thousand scattered objects. Chunks stay packed, destroy() moves the archetype's last entity into the
+// hole, and only the archetype's last chunk is ever partly filled.
+//
+// Components are plain data: trivially destructible, at most 16 byte aligned, moved with memcpy.
+struct Entity {
+    uint32_t index = ~0u;
+    uint32_t generation = 0;
+};
+
+namespace ecs_detail {
+    inline unsigned int nextComponentId()
+    {
+        static std::atomic<unsigned int> next{0};
+        return next++;
+    }
+
+    inline size_t align16(size_t offset) { return (offset + 15) & ~(size_t)15; }
+}
+
+// a small id per component type, taken on first use
+template <typename T>
+unsigned int componentId()
+{
+    static const unsigned int id = ecs_detail::nextComponentId();
+    return id;
+}
+
+class Archetype;
+
+class Chunk
+{
+public:
+    static const size_t BYTES = 16 * 1024;
+
+    Archetype *archetype = nullptr;
+    unsigned int count = 0;
+
+    Entity* entities() { return reinterpret_cast<Entity*>(data.get()); }
+
+    // the chunk's array of T, count long; nullptr if the archetype has no T
+    template <typename T>
+    T* array();
+
+private:
+    friend class World;
+    std::unique_ptr<unsigned char[]> data{new unsigned char[BYTES]};
+};
+
+class Archetype
+{
+public:
+    static const unsigned int MAX_COMPONENTS = 64;
+
+    uint64_t mask = 0;
+    unsigned int capacity = 0; // entities per chunk
+    size_t offsets[MAX_COMPONENTS];
+    size_t sizes[MAX_COMPONENTS];
+    std::vector<std::unique_ptr<Chunk>> chunks;
+
+    Archetype(uint64_t mask, std::initializer_list<unsigned int> ids, std::initializer_list<size_t> componentSizes)
+        : mask(mask)
+    {
+        std::fill(sizes, sizes + MAX_COMPONENTS, (size_t)0);
+        size_t row = sizeof(Entity);
+        auto size = componentSizes.begin();
+        for (unsigned int id : ids) {
+            sizes[id] = *size++;
+            row += sizes[id];
+        }
+        // every array may lose up to 15 bytes to alignment
+        capacity = (unsigned int)((Chunk::BYTES - 16 * (ids.size() + 1)) / row);
+        size_t offset = ecs_detail::align16(capacity * sizeof(Entity));
+        for (unsigned int id = 0; id < MAX_COMPONENTS; id++) {
+            offsets[id] = 0;
+            if (!(mask & (uint64_t(1) << id)))
+                continue;
+            offsets[id] = offset;
+            offset = ecs_detail::align16(offset + capacity * sizes[id]);
+        }
+    }
+
+    bool has(unsigned int id) const { return (mask & (uint64_t(1) << id)) != 0; }
+};
+
+template <typename T>
+T* Chunk::array()
+{
+    unsigned int id = componentId<T>();
+    if (!archetype->has(id))
+        return nullptr;
+    return reinterpret_cast<T*>(data.get() + archetype->offsets[id]);
+}
+
+class World
+{
+public:
+    World() = default;
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    size_t size() const { return live; }
+
+    template <typename... Ts>
+    Entity create(const Ts&... components)
+    {
+        static_assert(sizeof...(Ts) > 0, "an entity needs a component");
+        uint64_t mask = 0;
+        for (unsigned int id : {componentId<Ts>()...}) {
+            if (id >= Archetype::MAX_COMPONENTS) {
+                std::cout << "ERROR::ECS::TOO_MANY_COMPONENT_TYPES" << std::endl;
+                return Entity();
+            }
+            mask |= uint64_t(1) << id;
+        }
+        Archetype &archetype = findArchetype(mask, {componentId<Ts>()...}, {sizeof(Ts)...});
+
+        Entity entity;
+        if (freeIndices.empty()) {
+            entity.index = (uint32_t)records.size();
+            records.push_back(Record());
+        } else {
+            entity.index = freeIndices.back();
+            freeIndices.pop_back();
+        }
+        Record &record = records[entity.index];
+        entity.generation = record.generation;
+        if (archetype.chunks.empty() || archetype.chunks.back()->count == archetype.capacity) {
+            archetype.chunks.emplace_back(new Chunk());
+            archetype.chunks.back()->archetype = &archetype;
+        }
+        Chunk *chunk = archetype.chunks.back().get();
+        record.chunk = chunk;
+        record.row = chunk->count++;
+        chunk->entities()[record.row] = entity;
+        int expand[] = {0, (place(chunk, record.row, components), 0)...};
+        (void)expand;
+        live++;
+        return entity;
+    }
+
+    bool alive(Entity entity) const
+    {
+        return entity.index < records.size() && records[entity.index].chunk &&
+               records[entity.index].generation == entity.generation;
+    }
+
+    // the entity's T, nullptr if it has none or is gone; valid until the next destroy
+    template <typename T>
+    T* get(Entity entity)
+    {
+        if (!alive(entity))
+            return nullptr;
+        const Record &record = records[entity.index];
+        T *array = record.chunk->array<T>();
+        return array ? array + record.row : nullptr;
+    }
+
+    void destroy(Entity entity)
+    {
+        if (!alive(entity))
+            return;
+        Record &record = records[entity.index];
+        Chunk *chunk = record.chunk;
+        Archetype &archetype = *chunk->archetype;
+        Chunk *last = archetype.chunks.back().get();
+        unsigned int lastRow = last->count - 1;
+        if (last != chunk || lastRow != record.row) {
+            // the archetype's last entity fills the hole
+            for (unsigned int id = 0; id < Archetype::MAX_COMPONENTS; id++)
+                if (archetype.has(id))
+                    std::memcpy(chunk->data.get() + archetype.offsets[id] + record.row * archetype.sizes[id],
+                                last->data.get() + archetype.offsets[id] + lastRow * archetype.sizes[id],
+                                archetype.sizes[id]);
+            Entity moved = last->entities()[lastRow];
+            chunk->entities()[record.row] = moved;
+            records[moved.index].chunk = chunk;
+            records[moved.index].row = record.row;
+        }
+        if (--last->count == 0)
+            archetype.chunks.pop_back();
+        record.chunk = nullptr;
+        record.generation++;
+        freeIndices.push_back(entity.index);
+        live--;
+    }
+
+    // every chunk whose archetype has all of Ts, archetypes in creation order, each one's chunks in order
+    template <typename... Ts>
+    void chunks(std::vector<Chunk*> &out)
+    {
+        out.clear();
+        uint64_t mask = 0;
+        for (unsigned int id : {componentId<Ts>()...})
+            mask |= uint64_t(1) << id;
+        for (const std::unique_ptr<Archetype> &archetype : archetypes)
+            if ((archetype->mask & mask) == mask)
+                for (const std::unique_ptr<Chunk> &chunk : archetype->chunks)
+                    out.push_back(chunk.get());
+    }
+
+    size_t archetypeCount() const { return archetypes.size(); }
+
+private:
+    struct Record {
+        Chunk *chunk = nullptr;
+        uint32_t row = 0;
+        uint32_t generation = 0;
+    };
+
+    std::vector<std::unique_ptr<Archetype>> archetypes;
+    std::vector<Record> records;
+    std::vector<uint32_t> freeIndices;
+    size_t live = 0;
+
+    Archetype& findArchetype(uint64_t mask, std::initializer_list<unsigned int> ids,
+                             std::initializer_list<size_t> sizes)
+    {
+        for (const std::unique_ptr<Archetype> &archetype : archetypes)
+            if (archetype->mask == mask)
+                return *archetype;
+        archetypes.emplace_back(new Archetype(mask, ids, sizes));
+        return *archetypes.back();
+    }
+
+    template <typename T>
+    static void place(Chunk *chunk, unsigned int row, const T &component)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "components must be trivially destructible");
+        static_assert(alignof(T) <= 16, "components must be at most 16 byte aligned");
+        new (chunk->array<T>() + row) T(component);
+    }
+};
+
+#endif
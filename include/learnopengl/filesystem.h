@@ -3,8 +3,14 @@
 
 #include <string>
 #include <cstdlib>
+#include <memory>
+#include <vector>
+#include <learnopengl/vfs.h>
 #include "root_directory.h" // This is a configuration file generated by CMake.
 
+// name of the pack produced from resources/, mounted over the loose files when present
+const char * const RESOURCE_PACK_NAME = "resources.pack";
+
 class FileSystem
 {
 private:
@@ -17,6 +23,29 @@ public:
     return (*pathBuilder)(path);
   }
 
+  // assets are looked up in the virtual file system by their path relative to the root,
+  // e.g. "resources/textures/sand.jpg"; absolute paths are read from disk directly
+  static AssetData read(const std::string& path)
+  {
+    return vfs().read(path);
+  }
+
+  static std::vector<AssetData> readBatch(const std::vector<std::string>& paths)
+  {
+    return vfs().readBatch(paths);
+  }
+
+  static bool exists(const std::string& path)
+  {
+    return vfs().exists(path);
+  }
+
+  static VirtualFileSystem& vfs()
+  {
+    static VirtualFileSystem* fs = createVfs();
+    return *fs;
+  }
+
 private:
   static std::string const & getRoot()
   {
@@ -45,6 +74,16 @@ private:
     return path;
   }
 
+  static VirtualFileSystem* createVfs()
+  {
+    VirtualFileSystem* fs = new VirtualFileSystem();
+    fs->mount("", std::unique_ptr<VfsMount>(new DirectoryMount(getRoot())));
+    std::unique_ptr<PackMount> pack(new PackMount());
+    if (pack->open(getPath(RESOURCE_PACK_NAME)))
+      fs->mount("", std::move(pack));
+    return fs;
+  }
+
 
 };
 
@@ -0,0 +1,406 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_backend.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A render target a frame graph allocates for the frame.
+struct TextureDesc {
+    int width = 0;
+    int height = 0;
+    GLenum internalFormat = GL_RGBA8;
+
+    TextureDesc() = default;
+    TextureDesc(int width, int height, GLenum internalFormat) : width(width), height(height), internalFormat(internalFormat) {}
+
+    bool operator==(const TextureDesc &other) const
+    {
+        return width == other.width && height == other.height && internalFormat == other.internalFormat;
+    }
+};
+
+// glTexImage2D's format and type for a render target format, its size, and whether it is a depth target.
+// False for formats the graph does not know.
+inline bool renderTargetFormat(GLenum internalFormat, GLenum &format, GLenum &type, unsigned int &bytesPerPixel, bool &depth)
+{
+    depth = false;
+    switch (internalFormat) {
+    case GL_RGBA8:   format = GL_RGBA; type = GL_UNSIGNED_BYTE; bytesPerPixel = 4; return true;
+    case GL_RG8:     format = GL_RG; type = GL_UNSIGNED_BYTE; bytesPerPixel = 2; return true;
+    case GL_RG16:    format = GL_RG; type = GL_UNSIGNED_SHORT; bytesPerPixel = 4; return true;
+    case GL_R32UI:   format = GL_RED_INTEGER; type = GL_UNSIGNED_INT; bytesPerPixel = 4; return true;
+    case GL_RGBA16F: format = GL_RGBA; type = GL_HALF_FLOAT; bytesPerPixel = 8; return true;
+    case GL_DEPTH24_STENCIL8:
+        format = GL_DEPTH_STENCIL; type = GL_UNSIGNED_INT_24_8; bytesPerPixel = 4; depth = true; return true;
+    case GL_DEPTH_COMPONENT24:
+        format = GL_DEPTH_COMPONENT; type = GL_UNSIGNED_INT; bytesPerPixel = 4; depth = true; return true;
+    }
+    return false;
+}
+
+typedef int FrameGraphHandle;
+
+struct FrameGraphStats {
+    unsigned int passes = 0;      // declared this frame
+    unsigned int culled = 0;      // of them, skipped because nothing used their outputs
+    unsigned int transients = 0;  // transient textures the surviving passes use
+    unsigned int textures = 0;    // GL textures backing them
+    size_t unaliasedBytes = 0;    // every transient in its own texture
+    size_t aliasedBytes = 0;      // the textures actually used, transients with disjoint lifetimes sharing one
+    size_t livePeakBytes = 0;     // most transient bytes alive at any one pass, what aliasing could reach at best
+};
+
+// Per frame render graph. Passes are added in execution order and declare the textures they read
+// (sampled) and write (attached); the graph then
+//   - culls passes none of whose outputs reach the backbuffer or a pass marked as having side effects,
+//   - works out each transient's lifetime, from the first to the last surviving pass that uses it,
+//   - backs the transients with pooled GL textures, handing a texture over once its transient is dead,
+//     so targets with disjoint lifetimes share memory. GL cannot place differently shaped textures in
+//     the same memory, so only transients of equal size and format alias,
+//   - binds a framebuffer with a pass's writes attached (colors in declaration order, depth formats on
+//     the depth attachment) before running it.
+// Pooled textures that go unused for POOL_FRAMES frames are deleted, resizing the window included.
+class FrameGraph
+{
+    struct Pass;
+
+public:
+    static const unsigned int POOL_FRAMES = 4;
+
+    FrameGraphStats stats;
+
+    // what a pass declares while it is added
+    class Builder
+    {
+    public:
+        FrameGraphHandle read(FrameGraphHandle resource)
+        {
+            pass.reads.push_back(resource);
+            return resource;
+        }
+        FrameGraphHandle write(FrameGraphHandle resource)
+        {
+            pass.writes.push_back(resource);
+            return resource;
+        }
+        // never culled, e.g. occlusion queries whose results are read back later
+        void sideEffect() { pass.sideEffect = true; }
+
+    private:
+        friend class FrameGraph;
+        Pass &pass;
+        explicit Builder(Pass &pass) : pass(pass) {}
+    };
+
+    // what a pass sees when it runs
+    class Resources
+    {
+    public:
+        GLuint texture(FrameGraphHandle resource) const { return graph.textureOf(resource); }
+        const TextureDesc& desc(FrameGraphHandle resource) const { return graph.resources[resource].desc; }
+
+    private:
+        friend class FrameGraph;
+        const FrameGraph &graph;
+        explicit Resources(const FrameGraph &graph) : graph(graph) {}
+    };
+
+    FrameGraph() = default;
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+
+    ~FrameGraph()
+    {
+        for (auto &framebuffer : framebuffers)
+            glDeleteFramebuffers(1, &framebuffer.second);
+        for (PooledTexture &pooled : pool)
+            glDeleteTextures(1, &pooled.texture);
+    }
+
+    FrameGraphHandle createTexture(const std::string &name, const TextureDesc &desc)
+    {
+        Resource resource;
+        resource.name = name;
+        resource.desc = desc;
+        resources.push_back(resource);
+        return (FrameGraphHandle)resources.size() - 1;
+    }
+
+    // the default framebuffer; a pass writing it writes nothing else
+    FrameGraphHandle importBackbuffer()
+    {
+        Resource resource;
+        resource.name = "backbuffer";
+        resource.imported = true;
+        resources.push_back(resource);
+        return (FrameGraphHandle)resources.size() - 1;
+    }
+
+    void addPass(const std::string &name, const std::function<void(Builder&)> &setup,
+                 std::function<void(const Resources&)> execute)
+    {
+        passes.emplace_back();
+        Pass &pass = passes.back();
+        pass.name = name;
+        pass.execute = std::move(execute);
+        Builder builder(pass);
+        setup(builder);
+    }
+
+    // culls, places the transients in textures and runs the surviving passes, then starts the next frame
+    void execute()
+    {
+        compile();
+        Resources view(*this);
+        for (Pass &pass : passes) {
+            if (pass.culled)
+                continue;
+            bindTargets(pass);
+            pass.execute(view);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        passes.clear();
+        resources.clear();
+        frame++;
+        expirePool();
+    }
+
+    // pass names in order, culled ones in brackets, and the memory the last frame's transients took
+    void report(std::ostream &out) const
+    {
+        out << "frame graph: " << stats.passes - stats.culled << " of " << stats.passes << " passes (" << lastOrder
+            << "), " << stats.transients << " transients in " << stats.textures << " textures: "
+            << stats.unaliasedBytes / (1024.0f * 1024.0f) << " MB without aliasing, "
+            << stats.aliasedBytes / (1024.0f * 1024.0f) << " MB with, "
+            << stats.livePeakBytes / (1024.0f * 1024.0f) << " MB live at most" << std::endl;
+    }
+
+private:
+    struct Pass {
+        std::string name;
+        std::vector<FrameGraphHandle> reads, writes;
+        std::function<void(const Resources&)> execute;
+        bool sideEffect = false;
+        bool culled = false;
+        unsigned int references = 0;
+    };
+
+    struct Resource {
+        std::string name;
+        TextureDesc desc;
+        bool imported = false;
+        unsigned int references = 0;
+        int first = -1, last = -1; // surviving passes using it
+        int pooled = -1;
+    };
+
+    struct PooledTexture {
+        TextureDesc desc;
+        GLuint texture = 0;
+        unsigned long lastFrame = 0;
+        bool busy = false;
+    };
+
+    std::vector<Pass> passes;
+    std::vector<Resource> resources;
+    std::vector<PooledTexture> pool;
+    std::map<std::vector<GLuint>, GLuint> framebuffers;
+    unsigned long frame = 0;
+    std::string lastOrder;
+
+    GLuint textureOf(FrameGraphHandle resource) const
+    {
+        int pooled = resources[resource].pooled;
+        return pooled < 0 ? 0 : pool[pooled].texture;
+    }
+
+    void compile()
+    {
+        stats = FrameGraphStats();
+        stats.passes = (unsigned int)passes.size();
+
+        // reference counting from the outputs back: a pass lives while something uses what it writes
+        for (Pass &pass : passes) {
+            pass.references = (unsigned int)pass.writes.size();
+            for (FrameGraphHandle read : pass.reads)
+                resources[read].references++;
+        }
+        std::vector<FrameGraphHandle> unused;
+        for (size_t i = 0; i < resources.size(); i++)
+            if (!resources[i].references && !resources[i].imported)
+                unused.push_back((FrameGraphHandle)i);
+        while (!unused.empty()) {
+            FrameGraphHandle resource = unused.back();
+            unused.pop_back();
+            for (Pass &pass : passes) {
+                if (pass.culled || pass.sideEffect || std::find(pass.writes.begin(), pass.writes.end(), resource) == pass.writes.end())
+                    continue;
+                if (--pass.references)
+                    continue;
+                pass.culled = true;
+                stats.culled++;
+                for (FrameGraphHandle read : pass.reads)
+                    if (--resources[read].references == 0 && !resources[read].imported)
+                        unused.push_back(read);
+            }
+        }
+
+        // lifetimes over the surviving passes
+        lastOrder.clear();
+        for (int i = 0; i < (int)passes.size(); i++) {
+            Pass &pass = passes[i];
+            lastOrder += (lastOrder.empty() ? "" : " ") + (pass.culled ? "[" + pass.name + "]" : pass.name);
+            if (pass.culled)
+                continue;
+            auto use = [&](FrameGraphHandle handle) {
+                Resource &resource = resources[handle];
+                if (resource.first < 0)
+                    resource.first = i;
+                resource.last = i;
+            };
+            std::for_each(pass.reads.begin(), pass.reads.end(), use);
+            std::for_each(pass.writes.begin(), pass.writes.end(), use);
+        }
+
+        // walk the passes, taking textures at a transient's first use and handing them back after its last
+        for (PooledTexture &pooled : pool)
+            pooled.busy = false;
+        size_t live = 0;
+        for (int i = 0; i < (int)passes.size(); i++) {
+            for (Resource &resource : resources) {
+                if (resource.imported || resource.first != i)
+                    continue;
+                resource.pooled = acquire(resource.desc);
+                size_t bytes = textureBytes(resource.desc);
+                live += bytes;
+                stats.transients++;
+                stats.unaliasedBytes += bytes;
+            }
+            stats.livePeakBytes = std::max(stats.livePeakBytes, live);
+            for (Resource &resource : resources) {
+                if (resource.imported || resource.last != i)
+                    continue;
+                pool[resource.pooled].busy = false;
+                live -= textureBytes(resource.desc);
+            }
+        }
+        for (PooledTexture &pooled : pool) {
+            if (pooled.lastFrame != frame)
+                continue;
+            stats.textures++;
+            stats.aliasedBytes += textureBytes(pooled.desc);
+        }
+    }
+
+    int acquire(const TextureDesc &desc)
+    {
+        for (size_t i = 0; i < pool.size(); i++) {
+            if (pool[i].busy || !(pool[i].desc == desc))
+                continue;
+            pool[i].busy = true;
+            pool[i].lastFrame = frame;
+            return (int)i;
+        }
+        PooledTexture pooled;
+        pooled.desc = desc;
+        pooled.busy = true;
+        pooled.lastFrame = frame;
+        GLenum format, type;
+        unsigned int bytesPerPixel;
+        bool depth;
+        if (!renderTargetFormat(desc.internalFormat, format, type, bytesPerPixel, depth)) {
+            std::cout << "ERROR::FRAME_GRAPH::UNKNOWN_FORMAT " << desc.internalFormat << std::endl;
+            format = GL_RGBA;
+            type = GL_UNSIGNED_BYTE;
+        }
+        pooled.texture = GLBackend::createTexture(GL_TEXTURE_2D);
+        GLBackend::textureStorage2D(pooled.texture, 1, desc.internalFormat, desc.width, desc.height, format, type, nullptr);
+        GLBackend::textureParameter(pooled.texture, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        GLBackend::textureParameter(pooled.texture, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        GLBackend::textureParameter(pooled.texture, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        GLBackend::textureParameter(pooled.texture, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        pool.push_back(pooled);
+        return (int)pool.size() - 1;
+    }
+
+    static size_t textureBytes(const TextureDesc &desc)
+    {
+        GLenum format, type;
+        unsigned int bytesPerPixel = 4;
+        bool depth;
+        renderTargetFormat(desc.internalFormat, format, type, bytesPerPixel, depth);
+        return (size_t)desc.width * desc.height * bytesPerPixel;
+    }
+
+    void bindTargets(const Pass &pass)
+    {
+        if (pass.writes.empty())
+            return;
+        if (resources[pass.writes[0]].imported) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            return;
+        }
+        std::vector<GLuint> attachments;
+        for (FrameGraphHandle write : pass.writes)
+            attachments.push_back(textureOf(write));
+        auto found = framebuffers.find(attachments);
+        if (found != framebuffers.end()) {
+            glBindFramebuffer(GL_FRAMEBUFFER, found->second);
+            return;
+        }
+        GLuint fbo;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        std::vector<GLenum> drawBuffers;
+        for (FrameGraphHandle write : pass.writes) {
+            GLenum format, type;
+            unsigned int bytesPerPixel;
+            bool depth;
+            renderTargetFormat(resources[write].desc.internalFormat, format, type, bytesPerPixel, depth);
+            GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+            if (depth)
+                attachment = format == GL_DEPTH_STENCIL ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+            else
+                drawBuffers.push_back(attachment);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, textureOf(write), 0);
+        }
+        if (drawBuffers.empty())
+            glDrawBuffer(GL_NONE);
+        else
+            glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAME_GRAPH::FRAMEBUFFER_INCOMPLETE " << pass.name << std::endl;
+        framebuffers[attachments] = fbo;
+    }
+
+    // deletes pooled textures, and the framebuffers using them, that sat unused for POOL_FRAMES frames
+    void expirePool()
+    {
+        for (size_t i = pool.size(); i-- > 0;) {
+            if (frame - pool[i].lastFrame <= POOL_FRAMES)
+                continue;
+            GLuint texture = pool[i].texture;
+            for (auto it = framebuffers.begin(); it != framebuffers.end();) {
+                if (std::find(it->first.begin(), it->first.end(), texture) != it->first.end()) {
+                    glDeleteFramebuffers(1, &it->second);
+                    it = framebuffers.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            glDeleteTextures(1, &texture);
+            pool.erase(pool.begin() + i);
+        }
+    }
+};
+
+#endif
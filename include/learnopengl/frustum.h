@@ -0,0 +1,75 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+// Axis aligned box; transformed() gives the box around the transformed box (Arvo).
+struct BoundingBox {
+    glm::vec3 min = glm::vec3(1e30f);
+    glm::vec3 max = glm::vec3(-1e30f);
+
+    void expand(const glm::vec3 &p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    BoundingBox transformed(const glm::mat4 &m) const
+    {
+        BoundingBox box;
+        glm::vec3 translation(m[3]);
+        box.min = box.max = translation;
+        for (int column = 0; column < 3; column++)
+            for (int row = 0; row < 3; row++) {
+                float a = m[column][row] * min[column], b = m[column][row] * max[column];
+                box.min[row] += std::fmin(a, b);
+                box.max[row] += std::fmax(a, b);
+            }
+        return box;
+    }
+};
+
+// The six planes of a projection * view matrix (Gribb/Hartmann), normals pointing inwards.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4 &m)
+    {
+        Frustum f;
+        glm::vec4 row[4];
+        for (int i = 0; i < 4; i++)
+            row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+        f.planes[0] = row[3] + row[0]; // left
+        f.planes[1] = row[3] - row[0]; // right
+        f.planes[2] = row[3] + row[1]; // bottom
+        f.planes[3] = row[3] - row[1]; // top
+        f.planes[4] = row[3] + row[2]; // near
+        f.planes[5] = row[3] - row[2]; // far
+        for (glm::vec4 &p : f.planes)
+            p = p / glm::length(glm::vec3(p));
+        return f;
+    }
+
+    bool intersectsSphere(const glm::vec3 &center, float radius) const
+    {
+        for (const glm::vec4 &p : planes)
+            if (glm::dot(glm::vec3(p), center) + p.w < -radius)
+                return false;
+        return true;
+    }
+
+    bool intersectsBox(const glm::vec3 &min, const glm::vec3 &max) const
+    {
+        for (const glm::vec4 &p : planes) {
+            // the corner furthest along the plane normal
+            glm::vec3 v(p.x >= 0.0f ? max.x : min.x, p.y >= 0.0f ? max.y : min.y, p.z >= 0.0f ? max.z : min.z);
+            if (glm::dot(glm::vec3(p), v) + p.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef GEOMETRY_BUFFER_H
+#define GEOMETRY_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/gl_backend.h>
+
+#include <cstdint>
+#include <vector>
+
+// Where one mesh lives in the GeometryBuffer: triangle t is indices[firstIndex + 3t ..] + baseVertex.
+struct SharedMesh {
+    uint32_t firstIndex = 0;
+    uint32_t baseVertex = 0;
+    uint32_t triangles = 0;
+};
+
+// Every mesh's vertices and indices in two texture buffers, so shaders can fetch any triangle by id
+// (the visibility buffer resolve does). Vertices keep the interleaved layout of the scene arrays,
+// position, normal, texture coords, as two RGBA32F texels: (px, py, pz, nx) (ny, nz, u, v); add()
+// converts other layouts into it.
+// The same buffers also draw the meshes with programmable vertex pulling: pulled() turns a mesh's
+// RenderGeometry into a range of the index buffer behind one attribute-less VAO, and vertex shaders
+// including vertex_pulling.glsl fetch their attributes by gl_VertexID. Every mesh then shares that VAO
+// whatever its source layout, so nothing is rebound between them.
+class GeometryBuffer
+{
+public:
+    static const int FLOATS_PER_VERTEX = 8;
+
+    ~GeometryBuffer()
+    {
+        if (buffers[0]) {
+            glDeleteVertexArrays(1, &VAO);
+            glDeleteTextures(2, textures);
+            glDeleteBuffers(2, buffers);
+        }
+    }
+
+    GeometryBuffer() = default;
+    GeometryBuffer(const GeometryBuffer&) = delete;
+    GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+
+    // stride in floats; position, normal and texture coords at float 0, 3 and 6. Returns the mesh id.
+    int add(const float *vertexData, size_t vertexCount, size_t stride, const unsigned int *indexData, size_t indexCount)
+    {
+        SharedMesh mesh;
+        mesh.firstIndex = (uint32_t)indices.size();
+        mesh.baseVertex = (uint32_t)(vertices.size() / FLOATS_PER_VERTEX);
+        mesh.triangles = (uint32_t)(indexCount / 3);
+        for (size_t i = 0; i < vertexCount; i++)
+            vertices.insert(vertices.end(), vertexData + i * stride, vertexData + i * stride + FLOATS_PER_VERTEX);
+        indices.insert(indices.end(), indexData, indexData + indexCount);
+        meshes.push_back(mesh);
+        return (int)meshes.size() - 1;
+    }
+
+    // -1 for meshes that only exist in GL buffers
+    int add(const Mesh &mesh)
+    {
+        if (mesh.vertices.empty() || mesh.indices.empty())
+            return -1;
+        std::vector<float> data;
+        data.reserve(mesh.vertices.size() * FLOATS_PER_VERTEX);
+        for (const Vertex &vertex : mesh.vertices) {
+            const float v[FLOATS_PER_VERTEX] = {vertex.Position.x, vertex.Position.y, vertex.Position.z,
+                                                vertex.Normal.x, vertex.Normal.y, vertex.Normal.z,
+                                                vertex.TexCoords.x, vertex.TexCoords.y};
+            data.insert(data.end(), v, v + FLOATS_PER_VERTEX);
+        }
+        return add(data.data(), mesh.vertices.size(), FLOATS_PER_VERTEX, mesh.indices.data(), mesh.indices.size());
+    }
+
+    const SharedMesh& mesh(int id) const { return meshes[id]; }
+    size_t meshCount() const { return meshes.size(); }
+    unsigned int pullingVao() const { return VAO; }
+
+    // the range of geometry (which needs a sharedMesh) drawn by vertex pulling, after upload()
+    RenderGeometry pulled(const RenderGeometry &geometry) const
+    {
+        const SharedMesh &shared = meshes[geometry.sharedMesh];
+        // arrays draws start at first; element draws cover the whole mesh
+        uint32_t firstIndex = shared.firstIndex + (geometry.indexType ? 0 : (uint32_t)geometry.first);
+        RenderGeometry g = RenderGeometry::elements(VAO, geometry.count, GL_UNSIGNED_INT, firstIndex * sizeof(uint32_t));
+        g.mode = geometry.mode;
+        g.baseVertex = (GLint)shared.baseVertex;
+        g.sharedMesh = geometry.sharedMesh;
+        return g;
+    }
+
+    // call once, after every mesh is added; the CPU copies are dropped
+    void upload()
+    {
+        if (!buffers[0]) {
+            for (int i = 0; i < 2; i++) {
+                buffers[i] = GLBackend::createBuffer();
+                textures[i] = GLBackend::createTexture(GL_TEXTURE_BUFFER);
+            }
+            VAO = GLBackend::createVertexArray();
+        }
+        GLBackend::bufferData(buffers[0], vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        GLBackend::bufferData(buffers[1], indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        GLBackend::textureBuffer(textures[0], GL_RGBA32F, buffers[0]);
+        GLBackend::textureBuffer(textures[1], GL_R32UI, buffers[1]);
+        // no attributes, only the indices
+        GLBackend::elementBuffer(VAO, buffers[1]);
+        uploadedBytes = vertices.size() * sizeof(float) + indices.size() * sizeof(unsigned int);
+        std::vector<float>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
+    }
+
+    // geometryVertices and geometryIndices on unit and unit + 1
+    void bind(Shader &shader, int unit) const
+    {
+        GLBackend::bindTexture(unit, GL_TEXTURE_BUFFER, textures[0]);
+        shader.setInt("geometryVertices", unit);
+        GLBackend::bindTexture(unit + 1, GL_TEXTURE_BUFFER, textures[1]);
+        shader.setInt("geometryIndices", unit + 1);
+        GLBackend::resetActiveTexture();
+    }
+
+    size_t memoryBytes() const { return uploadedBytes; }
+
+private:
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<SharedMesh> meshes;
+    GLuint buffers[2] = {0, 0};
+    GLuint textures[2] = {0, 0};
+    GLuint VAO = 0;
+    size_t uploadedBytes = 0;
+};
+
+#endif
@@ -0,0 +1,436 @@
+#ifndef GL_BACKEND_H
+#define GL_BACKEND_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_ext.h>
+
+// Object setup, uploads, texture binds and uniforms go through here, in one of two ways picked once at
+// context creation:
+//   direct state access (4.5): objects are edited by name, glCreate*, glNamedBuffer*, glTexture*,
+//                              glVertexArray*, glProgramUniform* and glBindTextureUnit, so nothing
+//                              that is bound changes and a texture bind is a single call
+//   bind to edit (3.3):        each edit binds the object to a target, edits it and binds back what
+//                              was there (on the active texture unit for textures), so edits can
+//                              happen between draws; buffers go through GL_COPY_WRITE_BUFFER, which
+//                              nothing draws from.
+//                              Uniforms need the program in use, as before.
+// Objects have to be created through the backend that edits them: names from glGen* are not objects
+// until first bound, which DSA calls never do. stats counts the bind calls the backend makes (texture
+// units, edit targets); reset it once a frame.
+struct GLBackendStats {
+    unsigned int binds = 0;
+};
+
+class GLBackend
+{
+public:
+    static GLBackendStats& stats()
+    {
+        static GLBackendStats stats;
+        return stats;
+    }
+
+    // call once after GLCapabilities::load; DSA is only taken when the context has it
+    static void select(bool directStateAccess)
+    {
+        dsaFlag() = directStateAccess && GLCapabilities::get().directStateAccess;
+    }
+
+    static bool dsa() { return dsaFlag(); }
+    static const char* name() { return dsa() ? "direct state access" : "bind to edit"; }
+
+    // buffers
+    // ------------------------------------------------------------------------
+    static GLuint createBuffer()
+    {
+        GLuint buffer = 0;
+        if (dsa())
+            glCreateBuffers(1, &buffer);
+        else
+            glGenBuffers(1, &buffer);
+        return buffer;
+    }
+
+    static void bufferData(GLuint buffer, GLsizeiptr size, const void *data, GLenum usage)
+    {
+        if (dsa()) {
+            glNamedBufferData(buffer, size, data, usage);
+            return;
+        }
+        bindEditBuffer(buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, data, usage);
+        bindEditBuffer(0);
+    }
+
+    static void bufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void *data)
+    {
+        if (dsa()) {
+            glNamedBufferSubData(buffer, offset, size, data);
+            return;
+        }
+        bindEditBuffer(buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+        bindEditBuffer(0);
+    }
+
+    // needs GLCapabilities::bufferStorage
+    static void bufferStorage(GLuint buffer, GLsizeiptr size, const void *data, GLbitfield flags)
+    {
+        if (dsa()) {
+            glNamedBufferStorage(buffer, size, data, flags);
+            return;
+        }
+        bindEditBuffer(buffer);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, data, flags);
+        bindEditBuffer(0);
+    }
+
+    static void* mapBufferRange(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access)
+    {
+        if (dsa())
+            return glMapNamedBufferRange(buffer, offset, length, access);
+        bindEditBuffer(buffer);
+        void *data = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, length, access);
+        bindEditBuffer(0);
+        return data;
+    }
+
+    static bool unmapBuffer(GLuint buffer)
+    {
+        if (dsa())
+            return glUnmapNamedBuffer(buffer) == GL_TRUE;
+        bindEditBuffer(buffer);
+        bool intact = glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE;
+        bindEditBuffer(0);
+        return intact;
+    }
+
+    // textures
+    // ------------------------------------------------------------------------
+    static GLuint createTexture(GLenum target)
+    {
+        GLuint texture = 0;
+        if (dsa())
+            glCreateTextures(target, 1, &texture);
+        else
+            glGenTextures(1, &texture);
+        return texture;
+    }
+
+    // levels of storage in a sized internalFormat, level 0 filled from pixels if there are any; the other
+    // levels are left to generateMipmap
+    static void textureStorage2D(GLuint texture, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height,
+                                 GLenum format, GLenum type, const void *pixels)
+    {
+        if (dsa()) {
+            glTextureStorage2D(texture, levels, internalFormat, width, height);
+            if (pixels)
+                glTextureSubImage2D(texture, 0, 0, 0, width, height, format, type, pixels);
+            return;
+        }
+        GLuint previous = bindEditTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, pixels);
+        restoreEditTexture(GL_TEXTURE_2D, previous);
+    }
+
+    static void textureParameter(GLuint texture, GLenum target, GLenum name, GLint value)
+    {
+        if (dsa()) {
+            glTextureParameteri(texture, name, value);
+            return;
+        }
+        GLuint previous = bindEditTexture(target, texture);
+        glTexParameteri(target, name, value);
+        restoreEditTexture(target, previous);
+    }
+
+    static void generateMipmap(GLuint texture, GLenum target)
+    {
+        if (dsa()) {
+            glGenerateTextureMipmap(texture);
+            return;
+        }
+        GLuint previous = bindEditTexture(target, texture);
+        glGenerateMipmap(target);
+        restoreEditTexture(target, previous);
+    }
+
+    // points a GL_TEXTURE_BUFFER texture at buffer
+    static void textureBuffer(GLuint texture, GLenum internalFormat, GLuint buffer)
+    {
+        if (dsa()) {
+            glTextureBuffer(texture, internalFormat, buffer);
+            return;
+        }
+        GLuint previous = bindEditTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+        restoreEditTexture(GL_TEXTURE_BUFFER, previous);
+    }
+
+    // points a GL_TEXTURE_BUFFER texture at size bytes of buffer from offset; needs
+    // GLCapabilities::textureBufferRange, and offset a multiple of its textureBufferOffsetAlignment
+    static void textureBufferRange(GLuint texture, GLenum internalFormat, GLuint buffer, size_t offset, size_t size)
+    {
+        if (dsa()) {
+            glTextureBufferRange(texture, internalFormat, buffer, (GLintptr)offset, (GLsizeiptr)size);
+            return;
+        }
+        GLuint previous = bindEditTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBufferRange(GL_TEXTURE_BUFFER, internalFormat, buffer, (GLintptr)offset, (GLsizeiptr)size);
+        restoreEditTexture(GL_TEXTURE_BUFFER, previous);
+    }
+
+    // texture to unit for drawing. Bind to edit leaves unit active; resetActiveTexture() puts unit 0
+    // back for code that still binds with glBindTexture
+    static void bindTexture(int unit, GLenum target, GLuint texture)
+    {
+        if (dsa()) {
+            glBindTextureUnit((GLuint)unit, texture);
+            stats().binds++;
+            return;
+        }
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        stats().binds += 2;
+    }
+
+    static void resetActiveTexture()
+    {
+        if (dsa())
+            return;
+        glActiveTexture(GL_TEXTURE0);
+        stats().binds++;
+    }
+
+    // vertex arrays
+    // ------------------------------------------------------------------------
+    static GLuint createVertexArray()
+    {
+        GLuint vao = 0;
+        if (dsa())
+            glCreateVertexArrays(1, &vao);
+        else
+            glGenVertexArrays(1, &vao);
+        return vao;
+    }
+
+    // float attribute index read from buffer at offset + i * stride (+ divisor instances per element if set);
+    // each attribute gets the buffer binding point of the same index. stride has to be given even for tightly
+    // packed data, DSA takes 0 literally. normalized maps integer types to [0, 1] or [-1, 1]
+    static void vertexAttribute(GLuint vao, GLuint index, GLint size, GLenum type, GLuint buffer, GLsizei stride,
+                                size_t offset, GLuint divisor = 0, GLboolean normalized = GL_FALSE)
+    {
+        if (dsa()) {
+            glVertexArrayVertexBuffer(vao, index, buffer, (GLintptr)offset, stride);
+            glVertexArrayAttribFormat(vao, index, size, type, normalized, 0);
+            finishAttribute(vao, index, divisor);
+            return;
+        }
+        VertexArrayEdit previous = bindEditVertexArray(vao, buffer);
+        glVertexAttribPointer(index, size, type, normalized, stride, (void*)offset);
+        finishAttribute(vao, index, divisor);
+        restoreEditVertexArray(previous);
+    }
+
+    // the same for an integer attribute
+    static void vertexAttributeI(GLuint vao, GLuint index, GLint size, GLenum type, GLuint buffer, GLsizei stride,
+                                 size_t offset, GLuint divisor = 0)
+    {
+        if (dsa()) {
+            glVertexArrayVertexBuffer(vao, index, buffer, (GLintptr)offset, stride);
+            glVertexArrayAttribIFormat(vao, index, size, type, 0);
+            finishAttribute(vao, index, divisor);
+            return;
+        }
+        VertexArrayEdit previous = bindEditVertexArray(vao, buffer);
+        glVertexAttribIPointer(index, size, type, stride, (void*)offset);
+        finishAttribute(vao, index, divisor);
+        restoreEditVertexArray(previous);
+    }
+
+    static void elementBuffer(GLuint vao, GLuint buffer)
+    {
+        if (dsa()) {
+            glVertexArrayElementBuffer(vao, buffer);
+            return;
+        }
+        // the element buffer binding is VAO state, so only the VAO needs putting back
+        GLint previous = 0;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+        glBindVertexArray((GLuint)previous);
+        stats().binds += 3;
+    }
+
+    // uniforms of program; bind to edit needs program in use
+    // ------------------------------------------------------------------------
+    static void uniform1i(GLuint program, GLint location, GLint value)
+    {
+        if (dsa())
+            glProgramUniform1i(program, location, value);
+        else
+            glUniform1i(location, value);
+    }
+
+    static void uniform1ui(GLuint program, GLint location, GLuint value)
+    {
+        if (dsa())
+            glProgramUniform1ui(program, location, value);
+        else
+            glUniform1ui(location, value);
+    }
+
+    static void uniform1f(GLuint program, GLint location, GLfloat value)
+    {
+        if (dsa())
+            glProgramUniform1f(program, location, value);
+        else
+            glUniform1f(location, value);
+    }
+
+    static void uniform1fv(GLuint program, GLint location, GLsizei count, const GLfloat *value)
+    {
+        if (dsa())
+            glProgramUniform1fv(program, location, count, value);
+        else
+            glUniform1fv(location, count, value);
+    }
+
+    static void uniform2fv(GLuint program, GLint location, GLsizei count, const GLfloat *value)
+    {
+        if (dsa())
+            glProgramUniform2fv(program, location, count, value);
+        else
+            glUniform2fv(location, count, value);
+    }
+
+    static void uniform3fv(GLuint program, GLint location, GLsizei count, const GLfloat *value)
+    {
+        if (dsa())
+            glProgramUniform3fv(program, location, count, value);
+        else
+            glUniform3fv(location, count, value);
+    }
+
+    static void uniform4fv(GLuint program, GLint location, GLsizei count, const GLfloat *value)
+    {
+        if (dsa())
+            glProgramUniform4fv(program, location, count, value);
+        else
+            glUniform4fv(location, count, value);
+    }
+
+    static void uniformMatrix2fv(GLuint program, GLint location, const GLfloat *value)
+    {
+        if (dsa())
+            glProgramUniformMatrix2fv(program, location, 1, GL_FALSE, value);
+        else
+            glUniformMatrix2fv(location, 1, GL_FALSE, value);
+    }
+
+    static void uniformMatrix3fv(GLuint program, GLint location, const GLfloat *value)
+    {
+        if (dsa())
+            glProgramUniformMatrix3fv(program, location, 1, GL_FALSE, value);
+        else
+            glUniformMatrix3fv(location, 1, GL_FALSE, value);
+    }
+
+    static void uniformMatrix4fv(GLuint program, GLint location, const GLfloat *value)
+    {
+        if (dsa())
+            glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, value);
+        else
+            glUniformMatrix4fv(location, 1, GL_FALSE, value);
+    }
+
+private:
+    static bool& dsaFlag()
+    {
+        static bool flag = false;
+        return flag;
+    }
+
+    static void bindEditBuffer(GLuint buffer)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        stats().binds++;
+    }
+
+    // binds texture on the active unit for an edit; returns what was bound there for restoreEditTexture
+    static GLuint bindEditTexture(GLenum target, GLuint texture)
+    {
+        GLint previous = 0;
+        glGetIntegerv(textureBinding(target), &previous);
+        glBindTexture(target, texture);
+        stats().binds++;
+        return (GLuint)previous;
+    }
+
+    static void restoreEditTexture(GLenum target, GLuint previous)
+    {
+        glBindTexture(target, previous);
+        stats().binds++;
+    }
+
+    static GLenum textureBinding(GLenum target)
+    {
+        switch (target) {
+        case GL_TEXTURE_1D: return GL_TEXTURE_BINDING_1D;
+        case GL_TEXTURE_3D: return GL_TEXTURE_BINDING_3D;
+        case GL_TEXTURE_1D_ARRAY: return GL_TEXTURE_BINDING_1D_ARRAY;
+        case GL_TEXTURE_2D_ARRAY: return GL_TEXTURE_BINDING_2D_ARRAY;
+        case GL_TEXTURE_RECTANGLE: return GL_TEXTURE_BINDING_RECTANGLE;
+        case GL_TEXTURE_CUBE_MAP: return GL_TEXTURE_BINDING_CUBE_MAP;
+        case GL_TEXTURE_BUFFER: return GL_TEXTURE_BINDING_BUFFER;
+        case GL_TEXTURE_2D_MULTISAMPLE: return GL_TEXTURE_BINDING_2D_MULTISAMPLE;
+        default: return GL_TEXTURE_BINDING_2D;
+        }
+    }
+
+    // what bindEditVertexArray replaced, put back by restoreEditVertexArray
+    struct VertexArrayEdit {
+        GLuint vao = 0;
+        GLuint arrayBuffer = 0;
+    };
+
+    // attribute pointers capture GL_ARRAY_BUFFER; both stay bound until restoreEditVertexArray
+    static VertexArrayEdit bindEditVertexArray(GLuint vao, GLuint buffer)
+    {
+        GLint previousVao = 0, previousBuffer = 0;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+        glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousBuffer);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        stats().binds += 2;
+        VertexArrayEdit previous;
+        previous.vao = (GLuint)previousVao;
+        previous.arrayBuffer = (GLuint)previousBuffer;
+        return previous;
+    }
+
+    static void restoreEditVertexArray(const VertexArrayEdit &previous)
+    {
+        glBindVertexArray(previous.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, previous.arrayBuffer);
+        stats().binds += 2;
+    }
+
+    static void finishAttribute(GLuint vao, GLuint index, GLuint divisor)
+    {
+        if (dsa()) {
+            glVertexArrayAttribBinding(vao, index, index);
+            if (divisor)
+                glVertexArrayBindingDivisor(vao, index, divisor);
+            glEnableVertexArrayAttrib(vao, index);
+            return;
+        }
+        if (divisor)
+            glVertexAttribDivisor(index, divisor);
+        glEnableVertexAttribArray(index);
+    }
+};
+
+#endif
@@ -0,0 +1,268 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+#include <glad/glad.h>
+
+#include <string>
+
+// glad is generated for 3.3 core; the optional 4.x paths load the few entry points they need here, the
+// same way glad does (a function pointer behind a gl* macro). Every pointer is null when the context
+// does not provide it, so check GLCapabilities before using one.
+
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT
+#define GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT 0x919F
+#endif
+
+struct GLExtFunctions {
+    void (APIENTRYP DispatchCompute)(GLuint x, GLuint y, GLuint z) = nullptr;
+    void (APIENTRYP MemoryBarrier)(GLbitfield barriers) = nullptr;
+    void (APIENTRYP MultiDrawElementsIndirect)(GLenum mode, GLenum type, const void *indirect,
+                                               GLsizei drawCount, GLsizei stride) = nullptr;
+    void (APIENTRYP BufferStorage)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) = nullptr;
+    void (APIENTRYP TexBufferRange)(GLenum target, GLenum internalFormat, GLuint buffer, GLintptr offset,
+                                    GLsizeiptr size) = nullptr;
+
+    // direct state access (4.5 core), see GLBackend
+    void (APIENTRYP CreateBuffers)(GLsizei n, GLuint *buffers) = nullptr;
+    void (APIENTRYP NamedBufferData)(GLuint buffer, GLsizeiptr size, const void *data, GLenum usage) = nullptr;
+    void (APIENTRYP NamedBufferSubData)(GLuint buffer, GLintptr offset, GLsizeiptr size, const void *data) = nullptr;
+    void (APIENTRYP NamedBufferStorage)(GLuint buffer, GLsizeiptr size, const void *data, GLbitfield flags) = nullptr;
+    void *(APIENTRYP MapNamedBufferRange)(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access) = nullptr;
+    GLboolean (APIENTRYP UnmapNamedBuffer)(GLuint buffer) = nullptr;
+    void (APIENTRYP CreateTextures)(GLenum target, GLsizei n, GLuint *textures) = nullptr;
+    void (APIENTRYP TextureStorage2D)(GLuint texture, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height) = nullptr;
+    void (APIENTRYP TextureSubImage2D)(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                                       GLenum format, GLenum type, const void *pixels) = nullptr;
+    void (APIENTRYP TextureParameteri)(GLuint texture, GLenum name, GLint value) = nullptr;
+    void (APIENTRYP GenerateTextureMipmap)(GLuint texture) = nullptr;
+    void (APIENTRYP TextureBuffer)(GLuint texture, GLenum internalFormat, GLuint buffer) = nullptr;
+    void (APIENTRYP TextureBufferRange)(GLuint texture, GLenum internalFormat, GLuint buffer, GLintptr offset,
+                                        GLsizeiptr size) = nullptr;
+    void (APIENTRYP BindTextureUnit)(GLuint unit, GLuint texture) = nullptr;
+    void (APIENTRYP CreateVertexArrays)(GLsizei n, GLuint *arrays) = nullptr;
+    void (APIENTRYP VertexArrayVertexBuffer)(GLuint vao, GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride) = nullptr;
+    void (APIENTRYP VertexArrayElementBuffer)(GLuint vao, GLuint buffer) = nullptr;
+    void (APIENTRYP VertexArrayAttribFormat)(GLuint vao, GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                             GLuint offset) = nullptr;
+    void (APIENTRYP VertexArrayAttribIFormat)(GLuint vao, GLuint index, GLint size, GLenum type, GLuint offset) = nullptr;
+    void (APIENTRYP VertexArrayAttribBinding)(GLuint vao, GLuint index, GLuint binding) = nullptr;
+    void (APIENTRYP VertexArrayBindingDivisor)(GLuint vao, GLuint binding, GLuint divisor) = nullptr;
+    void (APIENTRYP EnableVertexArrayAttrib)(GLuint vao, GLuint index) = nullptr;
+    void (APIENTRYP ProgramUniform1i)(GLuint program, GLint location, GLint v0) = nullptr;
+    void (APIENTRYP ProgramUniform1ui)(GLuint program, GLint location, GLuint v0) = nullptr;
+    void (APIENTRYP ProgramUniform1f)(GLuint program, GLint location, GLfloat v0) = nullptr;
+    void (APIENTRYP ProgramUniform1fv)(GLuint program, GLint location, GLsizei count, const GLfloat *value) = nullptr;
+    void (APIENTRYP ProgramUniform2fv)(GLuint program, GLint location, GLsizei count, const GLfloat *value) = nullptr;
+    void (APIENTRYP ProgramUniform3fv)(GLuint program, GLint location, GLsizei count, const GLfloat *value) = nullptr;
+    void (APIENTRYP ProgramUniform4fv)(GLuint program, GLint location, GLsizei count, const GLfloat *value) = nullptr;
+    void (APIENTRYP ProgramUniformMatrix2fv)(GLuint program, GLint location, GLsizei count, GLboolean transpose,
+                                             const GLfloat *value) = nullptr;
+    void (APIENTRYP ProgramUniformMatrix3fv)(GLuint program, GLint location, GLsizei count, GLboolean transpose,
+                                             const GLfloat *value) = nullptr;
+    void (APIENTRYP ProgramUniformMatrix4fv)(GLuint program, GLint location, GLsizei count, GLboolean transpose,
+                                             const GLfloat *value) = nullptr;
+};
+
+inline GLExtFunctions& glExtFunctions()
+{
+    static GLExtFunctions functions;
+    return functions;
+}
+
+#ifndef glDispatchCompute
+#define glDispatchCompute glExtFunctions().DispatchCompute
+#endif
+#ifndef glMemoryBarrier
+#define glMemoryBarrier glExtFunctions().MemoryBarrier
+#endif
+#ifndef glMultiDrawElementsIndirect
+#define glMultiDrawElementsIndirect glExtFunctions().MultiDrawElementsIndirect
+#endif
+#ifndef glBufferStorage
+#define glBufferStorage glExtFunctions().BufferStorage
+#endif
+#ifndef glTexBufferRange
+#define glTexBufferRange glExtFunctions().TexBufferRange
+#endif
+#ifndef glCreateBuffers
+#define glCreateBuffers glExtFunctions().CreateBuffers
+#define glNamedBufferData glExtFunctions().NamedBufferData
+#define glNamedBufferSubData glExtFunctions().NamedBufferSubData
+#define glNamedBufferStorage glExtFunctions().NamedBufferStorage
+#define glMapNamedBufferRange glExtFunctions().MapNamedBufferRange
+#define glUnmapNamedBuffer glExtFunctions().UnmapNamedBuffer
+#define glCreateTextures glExtFunctions().CreateTextures
+#define glTextureStorage2D glExtFunctions().TextureStorage2D
+#define glTextureSubImage2D glExtFunctions().TextureSubImage2D
+#define glTextureParameteri glExtFunctions().TextureParameteri
+#define glGenerateTextureMipmap glExtFunctions().GenerateTextureMipmap
+#define glTextureBuffer glExtFunctions().TextureBuffer
+#define glTextureBufferRange glExtFunctions().TextureBufferRange
+#define glBindTextureUnit glExtFunctions().BindTextureUnit
+#define glCreateVertexArrays glExtFunctions().CreateVertexArrays
+#define glVertexArrayVertexBuffer glExtFunctions().VertexArrayVertexBuffer
+#define glVertexArrayElementBuffer glExtFunctions().VertexArrayElementBuffer
+#define glVertexArrayAttribFormat glExtFunctions().VertexArrayAttribFormat
+#define glVertexArrayAttribIFormat glExtFunctions().VertexArrayAttribIFormat
+#define glVertexArrayAttribBinding glExtFunctions().VertexArrayAttribBinding
+#define glVertexArrayBindingDivisor glExtFunctions().VertexArrayBindingDivisor
+#define glEnableVertexArrayAttrib glExtFunctions().EnableVertexArrayAttrib
+#define glProgramUniform1i glExtFunctions().ProgramUniform1i
+#define glProgramUniform1ui glExtFunctions().ProgramUniform1ui
+#define glProgramUniform1f glExtFunctions().ProgramUniform1f
+#define glProgramUniform1fv glExtFunctions().ProgramUniform1fv
+#define glProgramUniform2fv glExtFunctions().ProgramUniform2fv
+#define glProgramUniform3fv glExtFunctions().ProgramUniform3fv
+#define glProgramUniform4fv glExtFunctions().ProgramUniform4fv
+#define glProgramUniformMatrix2fv glExtFunctions().ProgramUniformMatrix2fv
+#define glProgramUniformMatrix3fv glExtFunctions().ProgramUniformMatrix3fv
+#define glProgramUniformMatrix4fv glExtFunctions().ProgramUniformMatrix4fv
+#endif
+
+// What the current context can do beyond 3.3 core. load() has to run once after gladLoadGLLoader,
+// with the same loader.
+struct GLCapabilities {
+    int major = 3;
+    int minor = 3;
+    std::string renderer;
+    // compute shaders, shader storage buffers and multi draw indirect (4.3 core)
+    bool gpuDriven = false;
+    // immutable buffer storage, persistently mapped (4.4 core or GL_ARB_buffer_storage)
+    bool bufferStorage = false;
+    // direct state access and separate program uniforms (4.5 core)
+    bool directStateAccess = false;
+    // texture buffers over part of a buffer (4.3 core or GL_ARB_texture_buffer_range); the offset has to
+    // be a multiple of textureBufferOffsetAlignment
+    bool textureBufferRange = false;
+    int textureBufferOffsetAlignment = 256;
+    // texels a texture buffer can address; 3.3 only guarantees 65536
+    int maxTextureBufferSize = 65536;
+
+    bool versionAtLeast(int wantMajor, int wantMinor) const
+    {
+        return major > wantMajor || (major == wantMajor && minor >= wantMinor);
+    }
+
+    static GLCapabilities& get()
+    {
+        static GLCapabilities caps;
+        return caps;
+    }
+
+    static void load(GLADloadproc loader)
+    {
+        GLCapabilities &caps = get();
+        glGetIntegerv(GL_MAJOR_VERSION, &caps.major);
+        glGetIntegerv(GL_MINOR_VERSION, &caps.minor);
+        const GLubyte *name = glGetString(GL_RENDERER);
+        caps.renderer = name ? (const char*)name : "";
+
+        GLExtFunctions &f = glExtFunctions();
+        if (caps.versionAtLeast(4, 3)) {
+            f.DispatchCompute = (void (APIENTRYP)(GLuint, GLuint, GLuint))loader("glDispatchCompute");
+            f.MemoryBarrier = (void (APIENTRYP)(GLbitfield))loader("glMemoryBarrier");
+            f.MultiDrawElementsIndirect = (void (APIENTRYP)(GLenum, GLenum, const void*, GLsizei, GLsizei))
+                    loader("glMultiDrawElementsIndirect");
+        }
+        caps.gpuDriven = f.DispatchCompute && f.MemoryBarrier && f.MultiDrawElementsIndirect;
+
+        bool arbBufferStorage = false, arbTextureBufferRange = false;
+        GLint extensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+        for (GLint i = 0; i < extensions; i++) {
+            const GLubyte *extension = glGetStringi(GL_EXTENSIONS, (GLuint)i);
+            if (!extension)
+                continue;
+            std::string name((const char*)extension);
+            arbBufferStorage = arbBufferStorage || name == "GL_ARB_buffer_storage";
+            arbTextureBufferRange = arbTextureBufferRange || name == "GL_ARB_texture_buffer_range";
+        }
+        if (caps.versionAtLeast(4, 4) || arbBufferStorage)
+            f.BufferStorage = (void (APIENTRYP)(GLenum, GLsizeiptr, const void*, GLbitfield))loader("glBufferStorage");
+        caps.bufferStorage = f.BufferStorage != nullptr;
+
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &caps.maxTextureBufferSize);
+        if (caps.versionAtLeast(4, 3) || arbTextureBufferRange)
+            loadFunction(loader, f.TexBufferRange, "glTexBufferRange");
+        caps.textureBufferRange = f.TexBufferRange != nullptr;
+        if (caps.textureBufferRange)
+            glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &caps.textureBufferOffsetAlignment);
+
+        if (caps.versionAtLeast(4, 5)) {
+            loadFunction(loader, f.CreateBuffers, "glCreateBuffers");
+            loadFunction(loader, f.NamedBufferData, "glNamedBufferData");
+            loadFunction(loader, f.NamedBufferSubData, "glNamedBufferSubData");
+            loadFunction(loader, f.NamedBufferStorage, "glNamedBufferStorage");
+            loadFunction(loader, f.MapNamedBufferRange, "glMapNamedBufferRange");
+            loadFunction(loader, f.UnmapNamedBuffer, "glUnmapNamedBuffer");
+            loadFunction(loader, f.CreateTextures, "glCreateTextures");
+            loadFunction(loader, f.TextureStorage2D, "glTextureStorage2D");
+            loadFunction(loader, f.TextureSubImage2D, "glTextureSubImage2D");
+            loadFunction(loader, f.TextureParameteri, "glTextureParameteri");
+            loadFunction(loader, f.GenerateTextureMipmap, "glGenerateTextureMipmap");
+            loadFunction(loader, f.TextureBuffer, "glTextureBuffer");
+            loadFunction(loader, f.TextureBufferRange, "glTextureBufferRange");
+            loadFunction(loader, f.BindTextureUnit, "glBindTextureUnit");
+            loadFunction(loader, f.CreateVertexArrays, "glCreateVertexArrays");
+            loadFunction(loader, f.VertexArrayVertexBuffer, "glVertexArrayVertexBuffer");
+            loadFunction(loader, f.VertexArrayElementBuffer, "glVertexArrayElementBuffer");
+            loadFunction(loader, f.VertexArrayAttribFormat, "glVertexArrayAttribFormat");
+            loadFunction(loader, f.VertexArrayAttribIFormat, "glVertexArrayAttribIFormat");
+            loadFunction(loader, f.VertexArrayAttribBinding, "glVertexArrayAttribBinding");
+            loadFunction(loader, f.VertexArrayBindingDivisor, "glVertexArrayBindingDivisor");
+            loadFunction(loader, f.EnableVertexArrayAttrib, "glEnableVertexArrayAttrib");
+            loadFunction(loader, f.ProgramUniform1i, "glProgramUniform1i");
+            loadFunction(loader, f.ProgramUniform1ui, "glProgramUniform1ui");
+            loadFunction(loader, f.ProgramUniform1f, "glProgramUniform1f");
+            loadFunction(loader, f.ProgramUniform1fv, "glProgramUniform1fv");
+            loadFunction(loader, f.ProgramUniform2fv, "glProgramUniform2fv");
+            loadFunction(loader, f.ProgramUniform3fv, "glProgramUniform3fv");
+            loadFunction(loader, f.ProgramUniform4fv, "glProgramUniform4fv");
+            loadFunction(loader, f.ProgramUniformMatrix2fv, "glProgramUniformMatrix2fv");
+            loadFunction(loader, f.ProgramUniformMatrix3fv, "glProgramUniformMatrix3fv");
+            loadFunction(loader, f.ProgramUniformMatrix4fv, "glProgramUniformMatrix4fv");
+        }
+        caps.directStateAccess = f.CreateBuffers && f.NamedBufferData && f.NamedBufferSubData && f.NamedBufferStorage &&
+                f.MapNamedBufferRange && f.UnmapNamedBuffer && f.CreateTextures && f.TextureStorage2D &&
+                f.TextureSubImage2D && f.TextureParameteri && f.GenerateTextureMipmap && f.TextureBuffer &&
+                f.TextureBufferRange && f.BindTextureUnit && f.CreateVertexArrays && f.VertexArrayVertexBuffer &&
+                f.VertexArrayElementBuffer &&
+                f.VertexArrayAttribFormat && f.VertexArrayAttribIFormat && f.VertexArrayAttribBinding &&
+                f.VertexArrayBindingDivisor && f.EnableVertexArrayAttrib && f.ProgramUniform1i && f.ProgramUniform1ui &&
+                f.ProgramUniform1f && f.ProgramUniform1fv && f.ProgramUniform2fv && f.ProgramUniform3fv &&
+                f.ProgramUniform4fv && f.ProgramUniformMatrix2fv && f.ProgramUniformMatrix3fv && f.ProgramUniformMatrix4fv;
+    }
+
+private:
+    template <typename Function>
+    static void loadFunction(GLADloadproc loader, Function &function, const char *name)
+    {
+        function = (Function)loader(name);
+    }
+};
+
+#endif
@@ -0,0 +1,384 @@
+#ifndef GLTF_LOADER_H
+#define GLTF_LOADER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/gl_backend.h>
+#include <learnopengl/json.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_data.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+const uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+
+// A .glb file kept mapped for as long as its buffer views are needed. Only the embedded BIN buffer
+// is supported, external .bin buffers belong to the plain .gltf variant.
+class GlbFile
+{
+public:
+    JsonValue json;
+    const unsigned char *bin = nullptr;
+    size_t binSize = 0;
+
+    bool open(const std::string &path)
+    {
+        file = FileSystem::read(path);
+        if (!file.valid() || file.size() < 20)
+            return fail(path, "file too small");
+        uint32_t header[3];
+        std::memcpy(header, file.data(), sizeof(header));
+        if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > file.size())
+            return fail(path, "not a glTF 2.0 binary");
+        size_t offset = 12, length = header[2];
+        bool haveJson = false;
+        while (offset + 8 <= length) {
+            uint32_t chunk[2];
+            std::memcpy(chunk, file.data() + offset, sizeof(chunk));
+            offset += 8;
+            if (offset + chunk[0] > length)
+                return fail(path, "chunk exceeds file");
+            const char *data = file.chars() + offset;
+            if (chunk[1] == GLB_CHUNK_JSON && !haveJson) {
+                std::string error;
+                if (!JsonValue::parse(data, data + chunk[0], json, error))
+                    return fail(path, ("invalid JSON: " + error).c_str());
+                haveJson = true;
+            } else if (chunk[1] == GLB_CHUNK_BIN && !bin) {
+                bin = file.data() + offset;
+                binSize = chunk[0];
+            }
+            offset += (chunk[0] + 3) & ~3u;
+        }
+        if (!haveJson)
+            return fail(path, "missing JSON chunk");
+        return true;
+    }
+
+private:
+    AssetData file;
+
+    static bool fail(const std::string &path, const char *message)
+    {
+        std::cout << "ERROR::GLB::" << message << " in " << path << std::endl;
+        return false;
+    }
+};
+
+// A validated accessor: every element lies inside its buffer view, which lies inside the BIN chunk.
+struct GltfAccessor {
+    const unsigned char *data = nullptr; // first element
+    size_t count = 0;
+    size_t stride = 0;
+    GLenum componentType = 0;
+    int components = 0;
+    bool normalized = false;
+    int bufferView = -1;
+    size_t viewOffset = 0;   // byte offset of the first element inside its buffer view
+    bool aligned = false;    // offset and stride satisfy GL's alignment rules for direct use
+};
+
+namespace gltf_detail {
+
+    inline size_t componentSize(GLenum type)
+    {
+        switch (type) {
+            case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+            case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+            case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+            default: return 0;
+        }
+    }
+
+    inline int componentCount(const std::string &type)
+    {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        if (type == "MAT4") return 16;
+        return 0;
+    }
+
+    inline bool resolveAccessor(const GlbFile &glb, int index, GltfAccessor &out, std::string &error)
+    {
+        const JsonValue &accessor = glb.json["accessors"][(size_t)index];
+        if (index < 0 || !accessor.isObject()) {
+            error = "accessor " + std::to_string(index) + " does not exist";
+            return false;
+        }
+        if (accessor.has("sparse")) {
+            error = "sparse accessors are not supported";
+            return false;
+        }
+        out.componentType = (GLenum)accessor["componentType"].integer();
+        out.components = componentCount(accessor["type"].string());
+        out.normalized = accessor["normalized"].boolean();
+        out.count = (size_t)accessor["count"].number();
+        out.bufferView = accessor["bufferView"].integer(-1);
+        size_t elementSize = componentSize(out.componentType) * (size_t)out.components;
+        if (elementSize == 0 || out.count == 0) {
+            error = "accessor " + std::to_string(index) + " has an invalid type";
+            return false;
+        }
+        const JsonValue &view = glb.json["bufferViews"][(size_t)out.bufferView];
+        if (!view.isObject() || view["buffer"].integer(-1) != 0 || !glb.bin) {
+            error = "accessor " + std::to_string(index) + " needs a buffer view into the GLB BIN chunk";
+            return false;
+        }
+        size_t viewStart = (size_t)view["byteOffset"].number(0);
+        size_t viewLength = (size_t)view["byteLength"].number(0);
+        out.stride = (size_t)view["byteStride"].number(0);
+        if (out.stride == 0)
+            out.stride = elementSize;
+        out.viewOffset = (size_t)accessor["byteOffset"].number(0);
+        if (viewStart + viewLength > glb.binSize || out.stride < elementSize
+            || out.viewOffset + out.stride * (out.count - 1) + elementSize > viewLength) {
+            error = "accessor " + std::to_string(index) + " reads outside of its buffer";
+            return false;
+        }
+        out.data = glb.bin + viewStart + out.viewOffset;
+        size_t alignment = componentSize(out.componentType);
+        out.aligned = (viewStart + out.viewOffset) % alignment == 0 && (out.stride % 4 == 0 || out.stride == elementSize);
+        return true;
+    }
+
+    // reads component c of element i as float, applying the glTF normalization rules
+    inline float readComponent(const GltfAccessor &a, size_t i, int c)
+    {
+        const unsigned char *p = a.data + i * a.stride + (size_t)c * componentSize(a.componentType);
+        switch (a.componentType) {
+            case GL_FLOAT: { float v; std::memcpy(&v, p, 4); return v; }
+            case GL_UNSIGNED_BYTE: return a.normalized ? *p / 255.0f : (float)*p;
+            case GL_BYTE: { float v = (float)(int8_t)*p; return a.normalized ? std::max(v / 127.0f, -1.0f) : v; }
+            case GL_UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, p, 2); return a.normalized ? v / 65535.0f : (float)v; }
+            case GL_SHORT: { int16_t v; std::memcpy(&v, p, 2); return a.normalized ? std::max(v / 32767.0f, -1.0f) : (float)v; }
+            case GL_UNSIGNED_INT: { uint32_t v; std::memcpy(&v, p, 4); return (float)v; }
+            default: return 0.0f;
+        }
+    }
+
+    inline unsigned int readIndex(const GltfAccessor &a, size_t i)
+    {
+        const unsigned char *p = a.data + i * a.stride;
+        switch (a.componentType) {
+            case GL_UNSIGNED_BYTE: return *p;
+            case GL_UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, p, 2); return v; }
+            case GL_UNSIGNED_INT: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+            default: return 0;
+        }
+    }
+
+    // Scatters one accessor into a member of the interleaved Vertex array. Float data takes the SSE path:
+    // an unaligned 4 float load per element, stored as 16 bytes (vec3) or 8 bytes (vec2). The 16 byte store
+    // spills into the following member, so members must be written in declaration order.
+    inline void scatter(const GltfAccessor &a, std::vector<Vertex> &vertices, size_t memberOffset, int width)
+    {
+        unsigned char *base = reinterpret_cast<unsigned char*>(vertices.data()) + memberOffset;
+        size_t i = 0;
+#ifdef __SSE2__
+        if (a.componentType == GL_FLOAT && a.components >= width) {
+            // a 16 byte load of the last elements could read past the end of the accessor
+            size_t safe = a.count;
+            while (safe > 0 && (safe - 1) * a.stride + 16 > a.stride * (a.count - 1) + a.components * 4)
+                safe--;
+            // the 16 byte store of the last vertex would spill past the end of the array
+            size_t safeStore = memberOffset + 16 <= sizeof(Vertex) ? vertices.size() : vertices.size() - 1;
+            safe = std::min(safe, safeStore);
+            for (; i < safe; i++) {
+                __m128 v = _mm_loadu_ps(reinterpret_cast<const float*>(a.data + i * a.stride));
+                unsigned char *dst = base + i * sizeof(Vertex);
+                if (width == 2)
+                    _mm_storel_pd(reinterpret_cast<double*>(dst), _mm_castps_pd(v));
+                else
+                    _mm_storeu_ps(reinterpret_cast<float*>(dst), v);
+            }
+        }
+#endif
+        for (; i < a.count; i++) {
+            float *dst = reinterpret_cast<float*>(base + i * sizeof(Vertex));
+            for (int c = 0; c < width; c++)
+                dst[c] = c < a.components ? readComponent(a, i, c) : 0.0f;
+        }
+    }
+}
+
+// A node's transform relative to its parent: its matrix (column-major, as glm stores it) if it has
+// one, otherwise translation * rotation * scale, each defaulting to the identity.
+inline glm::mat4 gltfNodeTransform(const JsonValue &node)
+{
+    glm::mat4 local(1.0f);
+    const JsonValue &matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        for (int column = 0; column < 4; column++)
+            for (int row = 0; row < 4; row++)
+                local[column][row] = (float)matrix[(size_t)(column * 4 + row)].number();
+        return local;
+    }
+    auto component = [](const JsonValue &array, size_t i, float fallback) { return (float)array[i].number(fallback); };
+    const JsonValue &t = node["translation"], &r = node["rotation"], &s = node["scale"];
+    float x = component(r, 0, 0.0f), y = component(r, 1, 0.0f), z = component(r, 2, 0.0f), w = component(r, 3, 1.0f);
+    glm::vec3 scale(component(s, 0, 1.0f), component(s, 1, 1.0f), component(s, 2, 1.0f));
+    // the rotation matrix of the unit quaternion (x, y, z, w), one column at a time, then scaled
+    local[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f) * scale.x;
+    local[1] = glm::vec4(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f) * scale.y;
+    local[2] = glm::vec4(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f) * scale.z;
+    local[3] = glm::vec4(component(t, 0, 0.0f), component(t, 1, 0.0f), component(t, 2, 0.0f), 1.0f);
+    return local;
+}
+
+// Loads the triangle primitives of a .glb into meshes. When an attribute layout can be consumed by GL
+// as is, its buffer view is uploaded straight from the mapped file and the VAO points into it; otherwise
+// (unaligned data, missing normals, forceRepack) the attributes are repacked into the interleaved Vertex.
+// textureForImage(imageIndex, type) returns the GL texture for a glTF image. sourceMeshes, if given, gets
+// the glTF mesh each returned Mesh is a primitive of, which is what the file's nodes refer to.
+inline std::vector<Mesh> loadGlbMeshes(const GlbFile &glb, const std::function<Texture(int, const std::string&)> &textureForImage,
+                                       bool forceRepack = false, std::vector<int> *sourceMeshes = nullptr)
+{
+    using namespace gltf_detail;
+    std::vector<Mesh> meshes;
+    std::map<int, unsigned int> viewBuffers; // buffer view -> GL buffer, shared between primitives
+    std::string error;
+
+    auto uploadView = [&](int viewIndex) {
+        auto it = viewBuffers.find(viewIndex);
+        if (it != viewBuffers.end())
+            return it->second;
+        const JsonValue &view = glb.json["bufferViews"][(size_t)viewIndex];
+        unsigned int buffer = GLBackend::createBuffer();
+        GLBackend::bufferData(buffer, (GLsizeiptr)view["byteLength"].number(), glb.bin + (size_t)view["byteOffset"].number(0),
+                              GL_STATIC_DRAW);
+        viewBuffers[viewIndex] = buffer;
+        return buffer;
+    };
+
+    auto materialTextures = [&](int materialIndex) {
+        std::vector<Texture> textures;
+        const JsonValue &material = glb.json["materials"][(size_t)materialIndex];
+        auto add = [&](const JsonValue &info, const char *type) {
+            int source = glb.json["textures"][(size_t)info["index"].integer(-1)]["source"].integer(-1);
+            if (source >= 0)
+                textures.push_back(textureForImage(source, type));
+        };
+        const JsonValue &pbr = material["pbrMetallicRoughness"];
+        add(pbr["baseColorTexture"], "texture_diffuse");
+        const JsonValue &specular = material["extensions"]["KHR_materials_specular"]["specularTexture"];
+        add(specular.isObject() ? specular : pbr["metallicRoughnessTexture"], "texture_specular");
+        add(material["normalTexture"], "texture_normal");
+        return textures;
+    };
+
+    const JsonValue &gltfMeshes = glb.json["meshes"];
+    for (size_t m = 0; m < gltfMeshes.size(); m++) {
+        const JsonValue &primitives = gltfMeshes[m]["primitives"];
+        for (size_t p = 0; p < primitives.size(); p++) {
+            const JsonValue &primitive = primitives[p];
+            if (primitive["mode"].integer(4) != 4) // GL_TRIANGLES only
+                continue;
+            const JsonValue &attributes = primitive["attributes"];
+            GltfAccessor position, normal, texCoord, tangent, index;
+            if (!resolveAccessor(glb, attributes["POSITION"].integer(-1), position, error)
+                || position.components != 3) {
+                std::cout << "ERROR::GLB::mesh " << m << " primitive " << p << ": " << error << std::endl;
+                continue;
+            }
+            bool hasNormal = attributes.has("NORMAL") && resolveAccessor(glb, attributes["NORMAL"].integer(), normal, error);
+            bool hasTexCoord = attributes.has("TEXCOORD_0") && resolveAccessor(glb, attributes["TEXCOORD_0"].integer(), texCoord, error);
+            bool hasTangent = attributes.has("TANGENT") && resolveAccessor(glb, attributes["TANGENT"].integer(), tangent, error);
+            bool hasIndices = primitive.has("indices") && resolveAccessor(glb, primitive["indices"].integer(), index, error);
+            if ((hasNormal && normal.count != position.count) || (hasTexCoord && texCoord.count != position.count)
+                || (hasTangent && tangent.count != position.count) || (primitive.has("indices") && !hasIndices)
+                || (hasIndices && (index.components != 1 || index.componentType == GL_FLOAT || index.stride != componentSize(index.componentType)))) {
+                std::cout << "ERROR::GLB::mesh " << m << " primitive " << p << " has inconsistent accessors " << error << std::endl;
+                continue;
+            }
+            std::vector<Texture> textures = materialTextures(primitive["material"].integer(-1));
+
+            bool direct = !forceRepack && hasNormal && hasIndices && position.aligned && normal.aligned
+                          && (!hasTexCoord || texCoord.aligned) && (!hasTangent || tangent.aligned) && index.aligned;
+            if (direct) {
+                // zero copy: the file's buffer views become GL buffers and the VAO describes their layout
+                unsigned int VAO = GLBackend::createVertexArray();
+                std::vector<unsigned int> buffers;
+                auto attribute = [&](GLuint location, const GltfAccessor &a) {
+                    buffers.push_back(uploadView(a.bufferView));
+                    GLBackend::vertexAttribute(VAO, location, a.components, a.componentType, buffers.back(),
+                                               (GLsizei)a.stride, a.viewOffset, 0, a.normalized ? GL_TRUE : GL_FALSE);
+                };
+                attribute(0, position);
+                attribute(1, normal);
+                if (hasTexCoord)
+                    attribute(2, texCoord);
+                if (hasTangent)
+                    attribute(3, tangent);
+                // absent attributes read the current generic value, (0,0,0,1) unless something changed it
+                buffers.push_back(uploadView(index.bufferView));
+                GLBackend::elementBuffer(VAO, buffers.back());
+                meshes.push_back(Mesh(VAO, std::move(buffers), (unsigned int)index.count, index.componentType,
+                                      index.viewOffset, std::move(textures)));
+                if (sourceMeshes)
+                    sourceMeshes->push_back((int)m);
+                continue;
+            }
+
+            // repack into the interleaved Vertex layout Mesh::setupMesh expects
+            MeshData data;
+            data.vertices.resize(position.count);
+            std::memset(static_cast<void*>(data.vertices.data()), 0, data.vertices.size() * sizeof(Vertex));
+            scatter(position, data.vertices, offsetof(Vertex, Position), 3);
+            if (hasNormal)
+                scatter(normal, data.vertices, offsetof(Vertex, Normal), 3);
+            if (hasTexCoord)
+                scatter(texCoord, data.vertices, offsetof(Vertex, TexCoords), 2);
+            else
+                for (Vertex &v : data.vertices)
+                    v.TexCoords = glm::vec2(0.0f, 0.0f); // overwritten by the 16 byte normal store
+            if (hasIndices) {
+                data.indices.resize(index.count);
+                for (size_t i = 0; i < index.count; i++)
+                    data.indices[i] = readIndex(index, i);
+            } else {
+                data.indices.resize(position.count);
+                for (size_t i = 0; i < position.count; i++)
+                    data.indices[i] = (unsigned int)i;
+            }
+            for (unsigned int &i : data.indices)
+                if (i >= position.count)
+                    i = 0;
+            std::vector<int> positionIndex(position.count);
+            for (size_t i = 0; i < position.count; i++)
+                positionIndex[i] = (int)i;
+            generateTangentSpace(data, positionIndex, !hasNormal);
+            if (hasTangent) {
+                // the file's tangents win over generated ones; bitangent = cross(N, T) * handedness
+                scatter(tangent, data.vertices, offsetof(Vertex, Tangent), 3);
+                for (size_t i = 0; i < data.vertices.size(); i++) {
+                    Vertex &v = data.vertices[i];
+                    float w = tangent.components > 3 ? readComponent(tangent, i, 3) : 1.0f;
+                    v.Bitangent = glm::cross(v.Normal, v.Tangent) * w;
+                }
+            }
+            meshes.push_back(Mesh(std::move(data.vertices), std::move(data.indices), std::move(textures)));
+            if (sourceMeshes)
+                sourceMeshes->push_back((int)m);
+        }
+    }
+    return meshes;
+}
+
+#endif
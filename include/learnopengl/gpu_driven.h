@@ -0,0 +1,155 @@
+#ifndef GPU_DRIVEN_H
+#define GPU_DRIVEN_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/gl_backend.h>
+#include <learnopengl/shader_m.h>
+#include <learnopengl/frustum.h>
+#include <learnopengl/affine_math.h>
+
+#include <algorithm>
+#include <vector>
+
+// std430 layout shared with gpu_cull.cs and the *_indirect vertex shaders
+struct GpuInstance {
+    glm::mat4 model;
+    NormalMatrix normalMatrix; // of model, see affineNormalMatrix
+    glm::vec4 bounds; // world space bounding sphere, xyz center and w radius
+    glm::vec4 params; // free for the vertex shader
+};
+
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// One level of detail: an index range of the shared geometry and the camera distance up to which it is used.
+struct GpuLod {
+    GLuint indexCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    float maxDistance;
+};
+
+// GL 4.3 path for large numbers of instances of one mesh. A compute shader frustum culls every instance,
+// picks its level of detail and appends it to that level's DrawElementsIndirectCommand; a single
+// glMultiDrawElementsIndirect then draws all levels, so the CPU cost no longer depends on the instance count.
+// The surviving instance ids reach the vertex shader as an instanced attribute (location 3), offset by
+// baseInstance, which works without ARB_shader_draw_parameters.
+class GpuDrivenRenderer
+{
+public:
+    static const unsigned int MAX_LODS = 4;
+
+    GpuDrivenRenderer() : cullShader("resources/shaders/gpu_cull.cs") {}
+
+    ~GpuDrivenRenderer()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &instanceBuffer);
+        glDeleteBuffers(1, &commandBuffer);
+        glDeleteBuffers(1, &visibleBuffer);
+        glDeleteProgram(cullShader.ID);
+    }
+
+    // vbo holds interleaved position/normal/texcoord floats (the layout used by every mesh in main.cpp),
+    // ebo unsigned int indices that the lods index into
+    void setGeometry(unsigned int vbo, unsigned int ebo, const std::vector<GpuLod> &levels)
+    {
+        lods.assign(levels.begin(), levels.begin() + std::min<size_t>(levels.size(), MAX_LODS));
+        if (!VAO) {
+            VAO = GLBackend::createVertexArray();
+            instanceBuffer = GLBackend::createBuffer();
+            commandBuffer = GLBackend::createBuffer();
+            visibleBuffer = GLBackend::createBuffer();
+        }
+        GLBackend::vertexAttribute(VAO, 0, 3, GL_FLOAT, vbo, 8 * sizeof(float), 0);
+        GLBackend::vertexAttribute(VAO, 1, 3, GL_FLOAT, vbo, 8 * sizeof(float), 3 * sizeof(float));
+        GLBackend::vertexAttribute(VAO, 2, 2, GL_FLOAT, vbo, 8 * sizeof(float), 6 * sizeof(float));
+        GLBackend::vertexAttributeI(VAO, 3, 1, GL_UNSIGNED_INT, visibleBuffer, sizeof(GLuint), 0, 1);
+        GLBackend::elementBuffer(VAO, ebo);
+    }
+
+    // uploads the instances once; every lod gets room for all of them in the visible list
+    void setInstances(const std::vector<GpuInstance> &instances)
+    {
+        count = (unsigned int)instances.size();
+        GLBackend::bufferData(instanceBuffer, instances.size() * sizeof(GpuInstance), instances.data(), GL_STATIC_DRAW);
+        GLBackend::bufferData(visibleBuffer, (size_t)count * lods.size() * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+
+        commands.resize(lods.size());
+        for (size_t i = 0; i < lods.size(); i++)
+            commands[i] = DrawElementsIndirectCommand{lods[i].indexCount, 0, lods[i].firstIndex, lods[i].baseVertex,
+                                                      (GLuint)(i * count)};
+        GLBackend::bufferData(commandBuffer, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_DRAW);
+    }
+
+    void cull(const glm::mat4 &viewProjection, const glm::vec3 &cameraPos)
+    {
+        if (count == 0)
+            return;
+        // reset the instance counts from the CPU side template
+        GLBackend::bufferSubData(commandBuffer, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+
+        Frustum frustum = Frustum::fromMatrix(viewProjection);
+        cullShader.use();
+        GLBackend::uniform4fv(cullShader.ID, glGetUniformLocation(cullShader.ID, "frustumPlanes"), 6, &frustum.planes[0][0]);
+        cullShader.setVec3("cameraPos", cameraPos);
+        GLBackend::uniform1ui(cullShader.ID, glGetUniformLocation(cullShader.ID, "instanceCount"), count);
+        GLBackend::uniform1ui(cullShader.ID, glGetUniformLocation(cullShader.ID, "lodCount"), (GLuint)lods.size());
+        float distances[MAX_LODS] = {0.0f};
+        for (size_t i = 0; i < lods.size(); i++)
+            distances[i] = lods[i].maxDistance;
+        GLBackend::uniform1fv(cullShader.ID, glGetUniformLocation(cullShader.ID, "lodDistance"), MAX_LODS, distances);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visibleBuffer);
+        glDispatchCompute((count + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // the caller has the draw program bound, with its frame uniforms and material set
+    void draw()
+    {
+        if (count == 0)
+            return;
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)commands.size(), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    // reads the instance counts back, which waits for the GPU; only for statistics
+    std::vector<GLuint> visibleCounts()
+    {
+        std::vector<DrawElementsIndirectCommand> result(commands.size());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, result.size() * sizeof(DrawElementsIndirectCommand), result.data());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        std::vector<GLuint> counts;
+        for (const DrawElementsIndirectCommand &c : result)
+            counts.push_back(c.instanceCount);
+        return counts;
+    }
+
+    unsigned int instanceCount() const { return count; }
+
+private:
+    Shader cullShader;
+    unsigned int VAO = 0;
+    unsigned int instanceBuffer = 0, commandBuffer = 0, visibleBuffer = 0;
+    unsigned int count = 0;
+    std::vector<GpuLod> lods;
+    std::vector<DrawElementsIndirectCommand> commands;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+// Averages the results of one query target over the frames it is issued in, e.g. GL_SAMPLES_PASSED.
+// Results are read a few frames later, and only once available, so counting never stalls the pipeline.
+// Queries of the same target cannot nest.
+class GpuCounter
+{
+public:
+    explicit GpuCounter(GLenum target) : target(target)
+    {
+        glGenQueries(LATENCY, queries);
+    }
+
+    ~GpuCounter()
+    {
+        glDeleteQueries(LATENCY, queries);
+    }
+
+    GpuCounter(const GpuCounter&) = delete;
+    GpuCounter& operator=(const GpuCounter&) = delete;
+
+    void begin()
+    {
+        GLuint query = queries[frame % LATENCY];
+        if (issued[frame % LATENCY]) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 value = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &value);
+                total += (double)value;
+                samples++;
+            }
+        }
+        glBeginQuery(target, query);
+    }
+
+    void end()
+    {
+        glEndQuery(target);
+        issued[frame % LATENCY] = true;
+        frame++;
+    }
+
+    // mean of the results collected since the last reset
+    double average() const { return samples ? total / samples : 0.0; }
+    unsigned int resultCount() const { return samples; }
+
+    void reset()
+    {
+        total = 0.0;
+        samples = 0;
+    }
+
+private:
+    static const int LATENCY = 4;
+    GLenum target;
+    GLuint queries[LATENCY];
+    bool issued[LATENCY] = {false, false, false, false};
+    unsigned long frame = 0;
+    double total = 0.0;
+    unsigned int samples = 0;
+};
+
+// GPU time of a stretch of commands with GL_TIME_ELAPSED queries (3.3 core).
+class GpuTimer : public GpuCounter
+{
+public:
+    GpuTimer() : GpuCounter(GL_TIME_ELAPSED) {}
+
+    double averageMs() const { return average() / 1e6; }
+};
+
+#endif
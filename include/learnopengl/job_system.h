@@ -0,0 +1,447 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A unit of work for the JobSystem. unfinished counts the job itself and its children; when it drops to
+// zero the job is finished, which releases its dependents and counts down its parent. waitingFor counts
+// the dependencies still running, plus one until the job is submitted; the job is queued when it drops
+// to zero. Past MAX_DEPENDENTS the last slot holds a relay: an empty job, never submitted, that waits
+// for this one alone and holds the dependents that did not fit.
+struct Job {
+    static const int MAX_DEPENDENTS = 8;
+    static const size_t PAYLOAD = 64;
+
+    void (*function)(Job&, unsigned int worker) = nullptr;
+    Job *parent = nullptr;
+    const char *name = nullptr;
+    std::atomic<int> unfinished{0};
+    std::atomic<int> waitingFor{0};
+    std::atomic<bool> done{true};
+    Job *dependents[MAX_DEPENDENTS];
+    int dependentCount = 0;
+    bool relay = false;
+    alignas(16) unsigned char payload[PAYLOAD];
+};
+
+// Chase-Lev work-stealing deque of a fixed size. The owning worker pushes and pops at the bottom, like a
+// stack, so it works depth first on what it just spawned; other workers steal from the top, the oldest
+// and usually largest pieces of work. Only a pop of the last job and steals race, on one CAS of top.
+class JobDeque
+{
+public:
+    static const int64_t CAPACITY = 4096;
+
+    // owner; false when full
+    bool push(Job *job)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY)
+            return false;
+        buffer[b & (CAPACITY - 1)].store(job, std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    // owner
+    Job* pop()
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_release);
+            return nullptr;
+        }
+        Job *job = buffer[b & (CAPACITY - 1)].load(std::memory_order_acquire);
+        if (t == b) {
+            // the last one, which a thief may be taking at the same time
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = nullptr;
+            bottom.store(b + 1, std::memory_order_release);
+        }
+        return job;
+    }
+
+    // any other thread
+    Job* steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+        Job *job = buffer[t & (CAPACITY - 1)].load(std::memory_order_acquire);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return job;
+    }
+
+private:
+    // top and bottom on cache lines of their own; padded rather than aligned, deques live in a vector
+    char padTop[64];
+    std::atomic<int64_t> top{0};
+    char padBottom[64];
+    std::atomic<int64_t> bottom{0};
+    char padBuffer[64];
+    std::atomic<Job*> buffer[CAPACITY];
+};
+
+// one executed job, in seconds since the frame began; depth > 0 for jobs run while another one waits
+struct JobSpan {
+    const char *name;
+    float start, end;
+    int depth;
+};
+
+// Work stealing over persistent threads, one deque each. The thread that creates the system takes part
+// as worker 0, so everything is submitted from it or from inside jobs; a system of one worker runs every
+// job on it. Waiting never blocks: a worker waiting for a job runs other jobs until it is done, which
+// makes jobs that spawn and wait for children (parallelFor inside a job) safe. Idle workers spin a while,
+// then sleep until something is queued.
+//
+// Jobs come from a ring of MAX_JOBS per worker and a finished job's slot is taken again, so a handle is
+// only good until its job has finished and been waited for. Captures of job functions have to fit
+// Job::PAYLOAD and be trivially destructible: references, pointers and small values. The worker index
+// lives in a thread_local, so a system is only used from the thread that created it and from its own
+// jobs.
+//
+// The trace records every job with its worker, for per worker utilization in report() and for a
+// chrome://tracing file of the last frame in writeTrace().
+class JobSystem
+{
+public:
+    static const unsigned int MAX_JOBS = 4096;
+    static const unsigned int NO_WORKER = ~0u;
+
+    explicit JobSystem(unsigned int threads = 0)
+    {
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads == 0)
+            threads = 1;
+        workers = std::vector<Worker>(threads);
+        for (unsigned int i = 0; i < threads; i++)
+            workers[i].random = 0x9e3779b9u * (i + 1);
+        currentWorker() = 0;
+        frameStart = lastReport = std::chrono::steady_clock::now();
+        for (unsigned int i = 1; i < threads; i++)
+            threads_.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread &t : threads_)
+            t.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int threadCount() const { return (unsigned int)workers.size(); }
+
+    // a job calling fn(worker), not queued until submit()
+    template <typename F>
+    Job* create(const char *name, F fn)
+    {
+        return createChild(nullptr, name, fn);
+    }
+
+    // the same, but parent is not finished before this job is; parent must not be finished yet
+    template <typename F>
+    Job* createChild(Job *parent, const char *name, F fn)
+    {
+        static_assert(sizeof(F) <= Job::PAYLOAD, "job captures too large");
+        static_assert(std::is_trivially_destructible<F>::value, "job captures must be trivially destructible");
+        Job *job = allocate();
+        job->function = [](Job &self, unsigned int worker) { (*reinterpret_cast<F*>(self.payload))(worker); };
+        new (job->payload) F(fn);
+        job->name = name;
+        job->parent = parent;
+        if (parent)
+            parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    // after does not start before before has finished; both not submitted yet. Any number of jobs can
+    // depend on one, the ones past MAX_DEPENDENTS go through relays
+    void addDependency(Job *before, Job *after)
+    {
+        while (before->dependentCount == Job::MAX_DEPENDENTS) {
+            Job *&last = before->dependents[Job::MAX_DEPENDENTS - 1];
+            if (!last->relay) {
+                // takes over last, whose count already includes before; its own count of one is before
+                Job *relay = create("dependents", [](unsigned int) {});
+                relay->relay = true;
+                relay->dependents[relay->dependentCount++] = last;
+                last = relay;
+            }
+            before = last;
+        }
+        after->waitingFor.fetch_add(1, std::memory_order_relaxed);
+        before->dependents[before->dependentCount++] = after;
+    }
+
+    // queues job once its dependencies have finished
+    void submit(Job *job)
+    {
+        release(job, currentWorker());
+    }
+
+    // runs other jobs until job has finished
+    void wait(const Job *job)
+    {
+        unsigned int worker = currentWorker();
+        while (!job->done.load(std::memory_order_acquire))
+            if (!runOne(worker))
+                std::this_thread::yield();
+    }
+
+    // calls fn(begin, end, worker) for ranges of at most grain indices covering [0, count), in parallel,
+    // and returns once all are done
+    template <typename F>
+    void parallelFor(size_t count, size_t grain, const F &fn)
+    {
+        unsigned int worker = currentWorker();
+        grain = std::max<size_t>(grain, 1);
+        if (workers.size() == 1 || count <= grain || worker == NO_WORKER) {
+            if (count)
+                fn((size_t)0, count, worker == NO_WORKER ? 0 : worker);
+            return;
+        }
+        Job *root = create("parallel for", [](unsigned int) {});
+        const F *body = &fn;
+        for (size_t begin = 0; begin < count; begin += grain) {
+            size_t end = std::min(count, begin + grain);
+            submit(createChild(root, "parallel for range", [body, begin, end](unsigned int worker) {
+                (*body)(begin, end, worker);
+            }));
+        }
+        submit(root);
+        wait(root);
+    }
+
+    // calls fn(task, worker) for every task in [0, tasks) and returns once all are done
+    void run(unsigned int tasks, const std::function<void(unsigned int, unsigned int)> &fn)
+    {
+        parallelFor(tasks, 1, [&fn](size_t begin, size_t end, unsigned int worker) {
+            for (size_t task = begin; task < end; task++)
+                fn((unsigned int)task, worker);
+        });
+    }
+
+    // starts this frame's trace; only between frames, with no job in flight
+    void beginFrame()
+    {
+        frameStart = std::chrono::steady_clock::now();
+        for (Worker &w : workers)
+            w.spans.clear();
+    }
+
+    // jobs per frame, how many were stolen and each worker's share of the time spent in jobs since the
+    // last report; no job may be in flight
+    void report(std::ostream &out, unsigned int frames)
+    {
+        auto now = std::chrono::steady_clock::now();
+        double wall = std::chrono::duration<double>(now - lastReport).count();
+        unsigned long executed = 0, stolen = 0;
+        for (const Worker &w : workers) {
+            executed += w.executed;
+            stolen += w.stolen;
+        }
+        out << "jobs: " << (frames ? (double)executed / frames : (double)executed) << " per frame on " << workers.size()
+            << " workers, " << (executed ? 100.0 * stolen / executed : 0.0) << "% stolen, busy";
+        for (size_t i = 0; i < workers.size(); i++) {
+            Worker &w = workers[i];
+            out << " " << i << ": " << (wall > 0.0 ? 100.0 * w.busy / wall : 0.0) << "%";
+            w.executed = w.stolen = 0;
+            w.busy = 0.0;
+        }
+        out << std::endl;
+        lastReport = now;
+    }
+
+    // the jobs of the frame since beginFrame as chrome://tracing JSON, one row per worker
+    void writeTrace(const char *path) const
+    {
+        std::ofstream file(path);
+        if (!file) {
+            std::cout << "ERROR::JOB_SYSTEM::TRACE_NOT_WRITTEN: " << path << std::endl;
+            return;
+        }
+        file << "{\"traceEvents\":[";
+        bool first = true;
+        for (size_t i = 0; i < workers.size(); i++)
+            for (const JobSpan &span : workers[i].spans) {
+                file << (first ? "" : ",") << "\n{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << i
+                     << ",\"ts\":" << span.start * 1e6 << ",\"dur\":" << (span.end - span.start) * 1e6 << "}";
+                first = false;
+            }
+        file << "\n]}" << std::endl;
+        std::cout << "job trace written to " << path << std::endl;
+    }
+
+private:
+    struct Worker {
+        JobDeque deque;
+        std::vector<Job> jobs = std::vector<Job>(MAX_JOBS);
+        unsigned int nextJob = 0;
+        uint32_t random = 0;
+        int depth = 0;
+        // trace, only touched by this worker while jobs run
+        std::vector<JobSpan> spans;
+        unsigned long executed = 0, stolen = 0;
+        double busy = 0.0;
+    };
+
+    std::vector<Worker> workers;
+    std::vector<std::thread> threads_;
+    std::atomic<int> queued{0};
+    std::atomic<int> sleeping{0};
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool quit = false;
+    std::chrono::steady_clock::time_point frameStart, lastReport;
+
+    static unsigned int& currentWorker()
+    {
+        static thread_local unsigned int worker = NO_WORKER;
+        return worker;
+    }
+
+    Job* allocate()
+    {
+        unsigned int worker = currentWorker();
+        Worker &w = workers[worker == NO_WORKER ? 0 : worker];
+        // slots still in use are skipped: a parent waiting for more children than the ring holds keeps its
+        // slot while the children cycle through the others. Only with every slot busy is there a wait.
+        Job *job = nullptr;
+        for (unsigned int tries = 0; !job; tries++) {
+            Job *slot = &w.jobs[w.nextJob++ % MAX_JOBS];
+            if (slot->done.load(std::memory_order_acquire))
+                job = slot;
+            else if (tries >= MAX_JOBS && !runOne(worker))
+                std::this_thread::yield();
+        }
+        job->done.store(false, std::memory_order_relaxed);
+        job->unfinished.store(1, std::memory_order_relaxed);
+        job->waitingFor.store(1, std::memory_order_relaxed);
+        job->dependentCount = 0;
+        job->relay = false;
+        return job;
+    }
+
+    void release(Job *job, unsigned int worker)
+    {
+        if (job->waitingFor.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        if (worker == NO_WORKER || !workers[worker].deque.push(job)) {
+            execute(job, worker == NO_WORKER ? 0 : worker);
+            return;
+        }
+        queued.fetch_add(1);
+        if (sleeping.load() > 0) {
+            { std::lock_guard<std::mutex> lock(mutex); }
+            wake.notify_one();
+        }
+    }
+
+    void finish(Job *job, unsigned int worker)
+    {
+        if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        // everything the slot holds is read before done lets allocate() reuse it
+        Job *parent = job->parent;
+        for (int i = 0; i < job->dependentCount; i++)
+            release(job->dependents[i], worker);
+        job->done.store(true, std::memory_order_release);
+        if (parent)
+            finish(parent, worker);
+    }
+
+    void execute(Job *job, unsigned int worker)
+    {
+        Worker &w = workers[worker];
+        auto start = std::chrono::steady_clock::now();
+        w.depth++;
+        job->function(*job, worker);
+        w.depth--;
+        auto end = std::chrono::steady_clock::now();
+        w.executed++;
+        if (w.depth == 0)
+            w.busy += std::chrono::duration<double>(end - start).count();
+        w.spans.push_back({job->name, std::chrono::duration<float>(start - frameStart).count(),
+                           std::chrono::duration<float>(end - frameStart).count(), w.depth});
+        finish(job, worker);
+    }
+
+    // one job from this worker's deque or stolen from another; false if there was none
+    bool runOne(unsigned int worker)
+    {
+        if (worker == NO_WORKER)
+            return false;
+        Worker &w = workers[worker];
+        Job *job = w.deque.pop();
+        if (!job && workers.size() > 1) {
+            // xorshift for the first victim, so thieves spread out
+            w.random ^= w.random << 13;
+            w.random ^= w.random >> 17;
+            w.random ^= w.random << 5;
+            size_t count = workers.size();
+            for (size_t i = 0, victim = w.random % count; i < count && !job; i++, victim = (victim + 1) % count)
+                if (victim != worker) {
+                    job = workers[victim].deque.steal();
+                    if (job)
+                        w.stolen++;
+                }
+        }
+        if (!job)
+            return false;
+        queued.fetch_sub(1);
+        execute(job, worker);
+        return true;
+    }
+
+    void workerLoop(unsigned int worker)
+    {
+        currentWorker() = worker;
+        for (;;) {
+            if (runOne(worker))
+                continue;
+            bool found = false;
+            for (int spin = 0; spin < 256 && !found; spin++) {
+                std::this_thread::yield();
+                found = queued.load() > 0;
+            }
+            if (found)
+                continue;
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping.fetch_add(1);
+            wake.wait(lock, [this] { return quit || queued.load() > 0; });
+            sleeping.fetch_sub(1);
+            if (quit)
+                return;
+        }
+    }
+};
+
+#endif
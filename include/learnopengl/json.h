@@ -0,0 +1,293 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Minimal JSON DOM, enough for glTF headers. Lookups on missing keys or wrong types return a shared
+// null value, so chained access like json["a"][0]["b"].number(-1) never throws.
+class JsonValue
+{
+public:
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    JsonValue() : type(NUL), num(0.0), flag(false) {}
+
+    Type getType() const { return type; }
+    bool isNull() const { return type == NUL; }
+    bool isObject() const { return type == OBJECT; }
+    bool isArray() const { return type == ARRAY; }
+    bool isNumber() const { return type == NUMBER; }
+    bool isString() const { return type == STRING; }
+
+    double number(double fallback = 0.0) const { return type == NUMBER ? num : fallback; }
+    int integer(int fallback = 0) const { return type == NUMBER ? (int)num : fallback; }
+    bool boolean(bool fallback = false) const { return type == BOOLEAN ? flag : fallback; }
+    const std::string& string() const { return type == STRING ? str : nullValue().str; }
+
+    size_t size() const { return type == ARRAY ? items.size() : type == OBJECT ? members.size() : 0; }
+    bool has(const std::string &key) const { return type == OBJECT && members.count(key) != 0; }
+
+    const JsonValue& operator[](size_t index) const
+    {
+        return type == ARRAY && index < items.size() ? items[index] : nullValue();
+    }
+    const JsonValue& operator[](const std::string &key) const
+    {
+        if (type != OBJECT)
+            return nullValue();
+        auto it = members.find(key);
+        return it == members.end() ? nullValue() : it->second;
+    }
+    const JsonValue& operator[](const char *key) const { return (*this)[std::string(key)]; }
+
+    const std::map<std::string, JsonValue>& object() const { return members; }
+
+    // returns false and leaves a message in error on malformed input
+    static bool parse(const char *begin, const char *end, JsonValue &out, std::string &error)
+    {
+        Parser parser{begin, end, error, 0};
+        parser.skip();
+        if (!parser.value(out))
+            return false;
+        parser.skip();
+        if (parser.p != end) {
+            error = "trailing characters";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    Type type;
+    double num;
+    bool flag;
+    std::string str;
+    std::vector<JsonValue> items;
+    std::map<std::string, JsonValue> members;
+
+    static const JsonValue& nullValue()
+    {
+        static const JsonValue null;
+        return null;
+    }
+
+    struct Parser {
+        const char *p;
+        const char *end;
+        std::string &error;
+        int depth;
+
+        void skip()
+        {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+                p++;
+        }
+
+        bool fail(const char *message)
+        {
+            error = message;
+            return false;
+        }
+
+        bool literal(const char *word)
+        {
+            size_t n = std::char_traits<char>::length(word);
+            if ((size_t)(end - p) < n || std::char_traits<char>::compare(p, word, n) != 0)
+                return fail("invalid literal");
+            p += n;
+            return true;
+        }
+
+        static void appendUtf8(std::string &s, unsigned cp)
+        {
+            if (cp < 0x80) {
+                s += (char)cp;
+            } else if (cp < 0x800) {
+                s += (char)(0xC0 | (cp >> 6));
+                s += (char)(0x80 | (cp & 0x3F));
+            } else if (cp < 0x10000) {
+                s += (char)(0xE0 | (cp >> 12));
+                s += (char)(0x80 | ((cp >> 6) & 0x3F));
+                s += (char)(0x80 | (cp & 0x3F));
+            } else {
+                s += (char)(0xF0 | (cp >> 18));
+                s += (char)(0x80 | ((cp >> 12) & 0x3F));
+                s += (char)(0x80 | ((cp >> 6) & 0x3F));
+                s += (char)(0x80 | (cp & 0x3F));
+            }
+        }
+
+        bool hex4(unsigned &cp)
+        {
+            if (end - p < 4)
+                return fail("truncated escape");
+            cp = 0;
+            for (int i = 0; i < 4; i++, p++) {
+                char c = *p;
+                cp <<= 4;
+                if (c >= '0' && c <= '9') cp |= (unsigned)(c - '0');
+                else if (c >= 'a' && c <= 'f') cp |= (unsigned)(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F') cp |= (unsigned)(c - 'A' + 10);
+                else return fail("invalid escape");
+            }
+            return true;
+        }
+
+        bool string(std::string &out)
+        {
+            p++; // opening quote
+            while (p < end && *p != '"') {
+                if (*p != '\\') {
+                    out += *p++;
+                    continue;
+                }
+                if (++p >= end)
+                    return fail("truncated string");
+                char c = *p++;
+                switch (c) {
+                    case '"': out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/': out += '/'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u': {
+                        unsigned cp;
+                        if (!hex4(cp))
+                            return false;
+                        if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                            unsigned low;
+                            p += 2;
+                            if (!hex4(low))
+                                return false;
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        appendUtf8(out, cp);
+                        break;
+                    }
+                    default: return fail("invalid escape");
+                }
+            }
+            if (p >= end)
+                return fail("unterminated string");
+            p++;
+            return true;
+        }
+
+        bool value(JsonValue &out)
+        {
+            if (p >= end)
+                return fail("unexpected end of input");
+            if (++depth > 128)
+                return fail("nesting too deep");
+            bool ok = true;
+            switch (*p) {
+                case '{': {
+                    out.type = OBJECT;
+                    p++;
+                    skip();
+                    if (p < end && *p == '}') {
+                        p++;
+                        break;
+                    }
+                    while (ok) {
+                        skip();
+                        if (p >= end || *p != '"')
+                            return fail("expected key");
+                        std::string key;
+                        if (!string(key))
+                            return false;
+                        skip();
+                        if (p >= end || *p != ':')
+                            return fail("expected ':'");
+                        p++;
+                        skip();
+                        ok = value(out.members[key]);
+                        skip();
+                        if (ok && p < end && *p == ',') {
+                            p++;
+                            continue;
+                        }
+                        if (ok && p < end && *p == '}') {
+                            p++;
+                            break;
+                        }
+                        if (ok)
+                            return fail("expected ',' or '}'");
+                    }
+                    break;
+                }
+                case '[': {
+                    out.type = ARRAY;
+                    p++;
+                    skip();
+                    if (p < end && *p == ']') {
+                        p++;
+                        break;
+                    }
+                    while (ok) {
+                        skip();
+                        out.items.emplace_back();
+                        ok = value(out.items.back());
+                        skip();
+                        if (ok && p < end && *p == ',') {
+                            p++;
+                            continue;
+                        }
+                        if (ok && p < end && *p == ']') {
+                            p++;
+                            break;
+                        }
+                        if (ok)
+                            return fail("expected ',' or ']'");
+                    }
+                    break;
+                }
+                case '"':
+                    out.type = STRING;
+                    ok = string(out.str);
+                    break;
+                case 't':
+                    out.type = BOOLEAN;
+                    out.flag = true;
+                    ok = literal("true");
+                    break;
+                case 'f':
+                    out.type = BOOLEAN;
+                    ok = literal("false");
+                    break;
+                case 'n':
+                    ok = literal("null");
+                    break;
+                default: {
+                    // strtod needs a terminated buffer; numbers are short so copy the token
+                    const char *q = p;
+                    while (q < end && (std::strchr("+-0123456789.eE", *q) != nullptr))
+                        q++;
+                    if (q == p || q - p > 64)
+                        return fail("invalid number");
+                    char buffer[65];
+                    std::memcpy(buffer, p, (size_t)(q - p));
+                    buffer[q - p] = '\0';
+                    char *parsedEnd;
+                    out.type = NUMBER;
+                    out.num = std::strtod(buffer, &parsedEnd);
+                    if (parsedEnd != buffer + (q - p))
+                        return fail("invalid number");
+                    p = q;
+                }
+            }
+            depth--;
+            return ok;
+        }
+    };
+};
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/job_system.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// The light model of pyramid.fs, with the range from LearnOpenGL's deferred shading chapter: the
+// distance at which the attenuated brightness drops under 5/256.
+struct PointLight {
+    glm::vec3 position;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float constant = 1.0f;
+    float linear = 0.09f;
+    float quadratic = 0.032f;
+
+    float radius() const
+    {
+        float brightness = std::max({diffuse.x, diffuse.y, diffuse.z, specular.x, specular.y, specular.z, ambient.x, ambient.y, ambient.z});
+        if (quadratic <= 0.0f)
+            return linear > 0.0f ? (256.0f / 5.0f * brightness - constant) / linear : 1e30f;
+        return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * (constant - (256.0f / 5.0f) * brightness))) / (2.0f * quadratic);
+    }
+};
+
+struct LightClusterStats {
+    unsigned int lights = 0;
+    unsigned int references = 0; // light indices over all clusters
+    unsigned int maxPerCluster = 0;
+    double assignMs = 0.0;
+};
+
+// Assigns point lights to the clusters (froxels) of the view frustum: X * Y screen tiles times Z slices
+// that grow exponentially with depth. Each slice is a task on the job system; it keeps the lights whose
+// depth range reaches into the slice and tests their spheres against the view space boxes of the slice's
+// clusters, four lights at a time with SSE2. The result is, per cluster, an (offset, count) pair into one
+// list of light indices. No GL here; ClusteredLighting uploads it.
+class LightClusters
+{
+public:
+    static const int X = 16;
+    static const int Y = 9;
+    static const int Z = 24;
+    static const int COUNT = X * Y * Z;
+
+    LightClusterStats stats;
+    std::vector<uint32_t> grid;    // offset, count per cluster
+    std::vector<uint32_t> indices; // light indices, grouped per cluster
+
+    LightClusters() : grid(COUNT * 2, 0), boxMin(COUNT), boxMax(COUNT), slices(Z) {}
+
+    // recomputes the cluster boxes; cheap enough to call every frame, skipped if nothing changed
+    void setProjection(float fovy, float aspect, float zNear, float zFar)
+    {
+        if (fovy == this->fovy && aspect == this->aspect && zNear == this->zNear && zFar == this->zFar)
+            return;
+        this->fovy = fovy;
+        this->aspect = aspect;
+        this->zNear = zNear;
+        this->zFar = zFar;
+        float tanY = std::tan(fovy * 0.5f), tanX = tanY * aspect;
+        for (int z = 0; z < Z; z++) {
+            float d0 = sliceDepth(z), d1 = sliceDepth(z + 1);
+            for (int y = 0; y < Y; y++)
+                for (int x = 0; x < X; x++) {
+                    float nx0 = -1.0f + 2.0f * x / X, nx1 = -1.0f + 2.0f * (x + 1) / X;
+                    float ny0 = -1.0f + 2.0f * y / Y, ny1 = -1.0f + 2.0f * (y + 1) / Y;
+                    // the tile's side planes pass through the eye, so the extremes are at the near or far depth
+                    glm::vec3 lo(1e30f), hi(-1e30f);
+                    for (float d : {d0, d1})
+                        for (float nx : {nx0, nx1})
+                            for (float ny : {ny0, ny1}) {
+                                glm::vec3 p(nx * tanX * d, ny * tanY * d, -d);
+                                lo = glm::min(lo, p);
+                                hi = glm::max(hi, p);
+                            }
+                    int index = (z * Y + y) * X + x;
+                    boxMin[index] = lo;
+                    boxMax[index] = hi;
+                }
+        }
+    }
+
+    // slice = floor(log(depth) * scale - bias), which is what the shader computes per fragment
+    float sliceScale() const { return Z / std::log(zFar / zNear); }
+    float sliceBias() const { return Z * std::log(zNear) / std::log(zFar / zNear); }
+
+    void assign(const std::vector<PointLight> &lights, const glm::mat4 &view, JobSystem &jobs)
+    {
+        auto start = std::chrono::steady_clock::now();
+        size_t n = lights.size();
+        viewX.resize(n);
+        viewY.resize(n);
+        viewZ.resize(n);
+        radius.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            glm::vec3 p = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+            viewX[i] = p.x;
+            viewY[i] = p.y;
+            viewZ[i] = p.z;
+            radius[i] = lights[i].radius();
+        }
+
+        jobs.run(Z, [&](unsigned int z, unsigned int) { assignSlice((int)z); });
+
+        indices.clear();
+        stats = LightClusterStats();
+        stats.lights = (unsigned int)n;
+        for (int z = 0; z < Z; z++) {
+            Slice &slice = slices[z];
+            for (int c = 0; c < X * Y; c++) {
+                int cluster = z * X * Y + c;
+                uint32_t count = slice.counts[c];
+                grid[cluster * 2] = (uint32_t)indices.size() + slice.offsets[c];
+                grid[cluster * 2 + 1] = count;
+                stats.maxPerCluster = std::max(stats.maxPerCluster, count);
+            }
+            indices.insert(indices.end(), slice.indices.begin(), slice.indices.end());
+        }
+        stats.references = (unsigned int)indices.size();
+        stats.assignMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    struct Slice {
+        std::vector<float> x, y, z, r; // candidate lights, SoA, padded to a multiple of 4
+        std::vector<uint32_t> ids;
+        std::vector<uint32_t> indices; // light indices of this slice's clusters, in cluster order
+        uint32_t offsets[X * Y];
+        uint32_t counts[X * Y];
+    };
+
+    float fovy = 0.0f, aspect = 0.0f, zNear = 0.0f, zFar = 0.0f;
+    std::vector<glm::vec3> boxMin, boxMax;
+    std::vector<float> viewX, viewY, viewZ, radius;
+    std::vector<Slice> slices;
+
+    float sliceDepth(int z) const
+    {
+        return zNear * std::pow(zFar / zNear, (float)z / Z);
+    }
+
+    void assignSlice(int z)
+    {
+        Slice &slice = slices[z];
+        slice.x.clear();
+        slice.y.clear();
+        slice.z.clear();
+        slice.r.clear();
+        slice.ids.clear();
+        slice.indices.clear();
+        float d0 = sliceDepth(z), d1 = sliceDepth(z + 1);
+        for (size_t i = 0; i < viewZ.size(); i++) {
+            float depth = -viewZ[i];
+            if (depth + radius[i] < d0 || depth - radius[i] > d1)
+                continue;
+            slice.x.push_back(viewX[i]);
+            slice.y.push_back(viewY[i]);
+            slice.z.push_back(viewZ[i]);
+            slice.r.push_back(radius[i]);
+            slice.ids.push_back((uint32_t)i);
+        }
+        // padding lanes sit far away with no radius, so they never pass
+        while (slice.x.size() % 4) {
+            slice.x.push_back(1e30f);
+            slice.y.push_back(1e30f);
+            slice.z.push_back(1e30f);
+            slice.r.push_back(0.0f);
+        }
+        size_t candidates = slice.ids.size();
+
+        for (int c = 0; c < X * Y; c++) {
+            int cluster = z * X * Y + c;
+            slice.offsets[c] = (uint32_t)slice.indices.size();
+            const glm::vec3 &lo = boxMin[cluster], &hi = boxMax[cluster];
+#ifdef __SSE2__
+            const __m128 zero = _mm_setzero_ps();
+            __m128 loX = _mm_set1_ps(lo.x), loY = _mm_set1_ps(lo.y), loZ = _mm_set1_ps(lo.z);
+            __m128 hiX = _mm_set1_ps(hi.x), hiY = _mm_set1_ps(hi.y), hiZ = _mm_set1_ps(hi.z);
+            for (size_t i = 0; i < slice.x.size(); i += 4) {
+                __m128 px = _mm_loadu_ps(&slice.x[i]), py = _mm_loadu_ps(&slice.y[i]), pz = _mm_loadu_ps(&slice.z[i]);
+                __m128 r = _mm_loadu_ps(&slice.r[i]);
+                // distance from the sphere center to the box, per axis
+                __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(loX, px), _mm_sub_ps(px, hiX)), zero);
+                __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(loY, py), _mm_sub_ps(py, hiY)), zero);
+                __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(loZ, pz), _mm_sub_ps(pz, hiZ)), zero);
+                __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                int mask = _mm_movemask_ps(_mm_cmple_ps(d2, _mm_mul_ps(r, r)));
+                while (mask) {
+                    int lane = __builtin_ctz((unsigned)mask);
+                    mask &= mask - 1;
+                    if (i + lane < candidates)
+                        slice.indices.push_back(slice.ids[i + lane]);
+                }
+            }
+#else
+            for (size_t i = 0; i < candidates; i++) {
+                float dx = std::max(std::max(lo.x - slice.x[i], slice.x[i] - hi.x), 0.0f);
+                float dy = std::max(std::max(lo.y - slice.y[i], slice.y[i] - hi.y), 0.0f);
+                float dz = std::max(std::max(lo.z - slice.z[i], slice.z[i] - hi.z), 0.0f);
+                if (dx * dx + dy * dy + dz * dz <= slice.r[i] * slice.r[i])
+                    slice.indices.push_back(slice.ids[i]);
+            }
+#endif
+            slice.counts[c] = (uint32_t)slice.indices.size() - slice.offsets[c];
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,335 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// files smaller than this are read() into a heap buffer instead of being mapped; a mapping costs
+// at least one page plus the mmap/munmap syscalls, which is more than a copy for tiny shader sources
+const size_t MAPPED_FILE_MIN_SIZE = 16 * 1024;
+
+// Collects per-asset I/O timings so the startup cost of loading assets can be inspected.
+// bytesCopied counts bytes that went through an intermediate user space buffer before reaching their consumer.
+class AssetIoStats
+{
+public:
+    struct Entry {
+        std::string path;
+        double seconds;
+        size_t bytes;
+        size_t bytesCopied;
+        const char *backend;
+    };
+
+    static AssetIoStats& instance()
+    {
+        static AssetIoStats stats;
+        return stats;
+    }
+
+    void record(const std::string &path, double seconds, size_t bytes, size_t bytesCopied, const char *backend)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back(Entry{path, seconds, bytes, bytesCopied, backend});
+    }
+
+    // bytes that had to be copied after the initial read, e.g. when a consumer needs a std::string
+    void addCopied(const std::string &path, size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+            if (it->path == path) {
+                it->bytesCopied += bytes;
+                return;
+            }
+        }
+    }
+
+    void report(std::ostream &out) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        double totalSeconds = 0.0;
+        size_t totalBytes = 0, totalCopied = 0;
+        out << "asset I/O (" << entries.size() << " files)\n";
+        for (const Entry &e : entries) {
+            out << "  " << std::setw(8) << e.backend << " "
+                << std::setw(10) << e.bytes << " B  "
+                << std::setw(10) << e.bytesCopied << " B copied  "
+                << std::fixed << std::setprecision(3) << e.seconds * 1000.0 << " ms  " << e.path << "\n";
+            totalSeconds += e.seconds;
+            totalBytes += e.bytes;
+            totalCopied += e.bytesCopied;
+        }
+        out << "  total " << totalBytes << " B, " << totalCopied << " B copied, "
+            << std::fixed << std::setprecision(3) << totalSeconds * 1000.0 << " ms" << std::endl;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::vector<Entry> entries;
+};
+
+// Read-only memory mapping of a whole file. Move-only, unmaps on destruction.
+class MappedFile
+{
+public:
+    MappedFile() : ptr(nullptr), length(0) {}
+    explicit MappedFile(const std::string &path) : ptr(nullptr), length(0) { open(path); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile &&other) noexcept : ptr(other.ptr), length(other.length)
+    {
+        other.ptr = nullptr;
+        other.length = 0;
+    }
+    MappedFile& operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other) {
+            close();
+            std::swap(ptr, other.ptr);
+            std::swap(length, other.length);
+        }
+        return *this;
+    }
+
+    bool open(const std::string &path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ptr = p;
+                length = (size_t)st.st_size;
+                madvise(ptr, length, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+        return ptr != nullptr;
+    }
+
+    void close()
+    {
+        if (ptr)
+            munmap(ptr, length);
+        ptr = nullptr;
+        length = 0;
+    }
+
+    const unsigned char* data() const { return static_cast<const unsigned char*>(ptr); }
+    size_t size() const { return length; }
+    bool valid() const { return ptr != nullptr; }
+
+private:
+    void *ptr;
+    size_t length;
+};
+
+// Contents of an asset, either mapped straight from the page cache or read into a heap buffer.
+// Consumers only ever see data()/size() and don't care which backend produced the bytes. An empty file
+// is valid with size() 0; data() may be null then, chars() is "".
+class AssetData
+{
+public:
+    AssetData() : view(nullptr), length(0), loaded(false) {}
+    AssetData(AssetData&&) = default;
+    AssetData& operator=(AssetData&&) = default;
+
+    static AssetData fromMapping(MappedFile &&file)
+    {
+        AssetData d;
+        d.mapping.reset(new MappedFile(std::move(file)));
+        d.view = d.mapping->data();
+        d.length = d.mapping->size();
+        d.loaded = true;
+        return d;
+    }
+
+    static AssetData fromBuffer(std::vector<unsigned char> &&buffer)
+    {
+        AssetData d;
+        d.buffer = std::move(buffer);
+        d.view = d.buffer.data();
+        d.length = d.buffer.size();
+        d.loaded = true;
+        return d;
+    }
+
+    // non-owning view, the caller keeps the memory alive (e.g. a mounted pack file)
+    static AssetData fromView(const unsigned char *data, size_t size)
+    {
+        AssetData d;
+        d.view = data;
+        d.length = size;
+        d.loaded = true;
+        return d;
+    }
+
+    const unsigned char* data() const { return view; }
+    const char* chars() const { return view ? reinterpret_cast<const char*>(view) : ""; }
+    size_t size() const { return length; }
+    bool valid() const { return loaded; }
+    std::string str() const { return length ? std::string(chars(), length) : std::string(); }
+
+private:
+    std::unique_ptr<MappedFile> mapping;
+    std::vector<unsigned char> buffer;
+    const unsigned char *view;
+    size_t length;
+    bool loaded; // opened and read in full, even if that was zero bytes
+};
+
+namespace asset_io_detail {
+    inline double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    inline bool readWhole(int fd, unsigned char *dst, size_t size, size_t offset = 0)
+    {
+        while (offset < size) {
+            ssize_t n = pread(fd, dst + offset, size - offset, (off_t)offset);
+            if (n <= 0)
+                return false;
+            offset += (size_t)n;
+        }
+        return true;
+    }
+}
+
+// loads a single asset: large files are mapped, small ones are read with one pread
+inline AssetData readAsset(const std::string &path)
+{
+    auto start = std::chrono::steady_clock::now();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cout << "ERROR::ASSET_IO::CANNOT_OPEN " << path << std::endl;
+        return AssetData();
+    }
+    struct stat st;
+    size_t size = fstat(fd, &st) == 0 ? (size_t)st.st_size : 0;
+    if (size >= MAPPED_FILE_MIN_SIZE) {
+        ::close(fd);
+        MappedFile file(path);
+        if (file.valid()) {
+            AssetIoStats::instance().record(path, asset_io_detail::secondsSince(start), file.size(), 0, "mmap");
+            return AssetData::fromMapping(std::move(file));
+        }
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return AssetData();
+    }
+    std::vector<unsigned char> buffer(size);
+    bool ok = asset_io_detail::readWhole(fd, buffer.data(), size);
+    ::close(fd);
+    if (!ok) {
+        std::cout << "ERROR::ASSET_IO::READ_FAILED " << path << std::endl;
+        return AssetData();
+    }
+    AssetIoStats::instance().record(path, asset_io_detail::secondsSince(start), size, size, "pread");
+    return AssetData::fromBuffer(std::move(buffer));
+}
+
+// Reads many small files at once. With liburing all reads are queued on one ring and submitted with a
+// single syscall, otherwise it degrades to a pread per file. Results are returned in request order.
+inline std::vector<AssetData> readAssetsBatched(const std::vector<std::string> &paths)
+{
+    std::vector<AssetData> result(paths.size());
+    std::vector<std::vector<unsigned char>> buffers(paths.size());
+    std::vector<int> fds(paths.size(), -1);
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        fds[i] = ::open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fds[i] >= 0 && fstat(fds[i], &st) == 0) {
+            buffers[i].resize((size_t)st.st_size);
+            continue;
+        }
+        std::cout << "ERROR::ASSET_IO::CANNOT_OPEN " << paths[i] << std::endl;
+        if (fds[i] >= 0)
+            ::close(fds[i]);
+        fds[i] = -1;
+    }
+
+    std::vector<bool> done(paths.size(), false);
+    const char *backend = "pread";
+#ifdef HAVE_LIBURING
+    const unsigned queueDepth = 64;
+    struct io_uring ring;
+    if (io_uring_queue_init(queueDepth, &ring, 0) == 0) {
+        backend = "io_uring";
+        for (size_t first = 0; first < paths.size(); first += queueDepth) {
+            size_t last = std::min(paths.size(), first + queueDepth);
+            unsigned queued = 0;
+            for (size_t i = first; i < last; i++) {
+                // empty files need no read, the loop below accepts them as they are
+                if (fds[i] < 0 || buffers[i].empty())
+                    continue;
+                struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+                io_uring_prep_read(sqe, fds[i], buffers[i].data(), (unsigned)buffers[i].size(), 0);
+                io_uring_sqe_set_data(sqe, (void*)i);
+                queued++;
+            }
+            io_uring_submit(&ring);
+            for (unsigned n = 0; n < queued; n++) {
+                struct io_uring_cqe *cqe;
+                if (io_uring_wait_cqe(&ring, &cqe) != 0)
+                    break;
+                size_t i = (size_t)io_uring_cqe_get_data(cqe);
+                // short reads are finished synchronously below
+                if (cqe->res >= 0)
+                    done[i] = asset_io_detail::readWhole(fds[i], buffers[i].data(), buffers[i].size(), (size_t)cqe->res);
+                io_uring_cqe_seen(&ring, cqe);
+            }
+        }
+        io_uring_queue_exit(&ring);
+    }
+#endif
+    double perFile = paths.empty() ? 0.0 : asset_io_detail::secondsSince(start) / paths.size();
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (fds[i] < 0)
+            continue;
+        auto fileStart = std::chrono::steady_clock::now();
+        if (!done[i])
+            done[i] = asset_io_detail::readWhole(fds[i], buffers[i].data(), buffers[i].size());
+        ::close(fds[i]);
+        if (!done[i]) {
+            std::cout << "ERROR::ASSET_IO::READ_FAILED " << paths[i] << std::endl;
+            continue;
+        }
+        size_t size = buffers[i].size();
+        AssetIoStats::instance().record(paths[i], perFile + asset_io_detail::secondsSince(fileStart), size, size, backend);
+        result[i] = AssetData::fromBuffer(std::move(buffers[i]));
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef MAPPED_IO_SYSTEM_H
+#define MAPPED_IO_SYSTEM_H
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include <learnopengl/filesystem.h>
+
+#include <cstring>
+#include <string>
+
+// Assimp stream that serves reads out of an AssetData instead of going through stdio.
+class MappedIOStream : public Assimp::IOStream
+{
+public:
+    MappedIOStream(const std::string &path, AssetData &&data) : path(path), asset(std::move(data)), position(0), copied(0) {}
+    // Assimp copies everything it reads into its own buffers, account for that once the stream is done
+    ~MappedIOStream() override { AssetIoStats::instance().addCopied(path, copied); }
+
+    size_t Read(void *buffer, size_t size, size_t count) override
+    {
+        if (size == 0 || position >= asset.size())
+            return 0;
+        size_t available = (asset.size() - position) / size;
+        if (count > available)
+            count = available;
+        std::memcpy(buffer, asset.data() + position, size * count);
+        position += size * count;
+        copied += size * count;
+        return count;
+    }
+
+    size_t Write(const void*, size_t, size_t) override { return 0; }
+
+    aiReturn Seek(size_t offset, aiOrigin origin) override
+    {
+        size_t target;
+        switch (origin) {
+            case aiOrigin_SET: target = offset; break;
+            case aiOrigin_CUR: target = position + offset; break;
+            case aiOrigin_END: target = asset.size() - offset; break;
+            default: return aiReturn_FAILURE;
+        }
+        if (target > asset.size())
+            return aiReturn_FAILURE;
+        position = target;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t Tell() const override { return position; }
+    size_t FileSize() const override { return asset.size(); }
+    void Flush() override {}
+
+private:
+    std::string path;
+    AssetData asset;
+    size_t position;
+    size_t copied;
+};
+
+// IOSystem handed to Assimp::Importer so model files and their .mtl/texture side files are resolved
+// through the VFS (pack or mapped loose file) and accounted for in AssetIoStats like every other asset.
+class MappedIOSystem : public Assimp::IOSystem
+{
+public:
+    bool Exists(const char *file) const override
+    {
+        return FileSystem::exists(file);
+    }
+
+    char getOsSeparator() const override { return '/'; }
+
+    Assimp::IOStream* Open(const char *file, const char *mode = "rb") override
+    {
+        if (std::strchr(mode, 'w') || std::strchr(mode, 'a'))
+            return nullptr;
+        AssetData data = FileSystem::read(file);
+        if (!data.valid())
+            return nullptr;
+        return new MappedIOStream(file, std::move(data));
+    }
+
+    void Close(Assimp::IOStream *stream) override { delete stream; }
+};
+
+#endif
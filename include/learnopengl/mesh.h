@@ -7,8 +7,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <learnopengl/gl_backend.h>
 
+#include <cstddef>
 #include <string>
+#include <utility>
 #include <vector>
 using namespace std;
 
@@ -25,6 +28,20 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// everything but the position, the second stream of VERTEX_STORAGE_SPLIT
+struct VertexAttributes {
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+    glm::vec3 Tangent;
+    glm::vec3 Bitangent;
+};
+
+// how setupMesh lays out the vertex buffers
+enum VertexStorage {
+    VERTEX_STORAGE_INTERLEAVED, // one buffer, every attribute in a sizeof(Vertex) stride
+    VERTEX_STORAGE_SPLIT        // positions tightly packed in their own buffer, VertexAttributes in a second one,
+                                // so depth only passes fetch 12 bytes per vertex instead of 56
+};
 
 
 struct Texture {
@@ -41,18 +58,39 @@ public:
     vector<Texture>      textures;
 
     unsigned int VAO;
+    // position only, for depth and shadow passes; with VERTEX_STORAGE_SPLIT it reads the position stream alone
+    unsigned int depthVAO;
+    VertexStorage storage;
     std::string glslIdentifierPrefix;
+    // what glDrawElements is called with; set from indices unless the mesh was built from GL buffers
+    unsigned int indexCount;
+    GLenum indexType;
+    size_t indexOffset;
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures,
+         VertexStorage storage = VERTEX_STORAGE_INTERLEAVED)
+        : storage(storage)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
+        indexCount = this->indices.size();
+        indexType = GL_UNSIGNED_INT;
+        indexOffset = 0;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
     }
 
+    // constructor for geometry that already lives in GL buffers (e.g. uploaded straight from a glTF
+    // buffer view); the CPU side vertices/indices stay empty
+    Mesh(unsigned int VAO, vector<unsigned int> buffers, unsigned int indexCount, GLenum indexType, size_t indexOffset, vector<Texture> textures)
+        : VAO(VAO), depthVAO(VAO), storage(VERTEX_STORAGE_SPLIT), indexCount(indexCount), indexType(indexType),
+          indexOffset(indexOffset), VBO(0), attributeVBO(0), EBO(0), ownedBuffers(std::move(buffers))
+    {
+        this->textures = std::move(textures);
+    }
+
     // render the mesh
     void Draw(Shader &shader)
     {
@@ -63,7 +101,6 @@ public:
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -78,62 +115,82 @@ public:
 
             // now set the sampler to the correct texture unit
             glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            // and finally bind the texture to its unit
+            GLBackend::bindTexture(i, GL_TEXTURE_2D, textures[i].id);
         }
 
 
 
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, indexCount, indexType, (void*)indexOffset);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+        GLBackend::resetActiveTexture();
     }
 
 private:
     // render data
-    unsigned int VBO, EBO;
+    unsigned int VBO, attributeVBO, EBO;
+    vector<unsigned int> ownedBuffers;
 
     // initializes all the buffer objects/arrays
     void setupMesh()
     {
         // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        VAO = GLBackend::createVertexArray();
+        depthVAO = GLBackend::createVertexArray();
+        VBO = GLBackend::createBuffer();
+        EBO = GLBackend::createBuffer();
+        attributeVBO = 0;
 
-        glBindVertexArray(VAO);
         // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        size_t positionStride = sizeof(Vertex), attributeStride = sizeof(Vertex), attributeBase = 0;
+        if (storage == VERTEX_STORAGE_SPLIT)
+        {
+            vector<glm::vec3> positions(vertices.size());
+            vector<VertexAttributes> attributes(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++)
+            {
+                positions[i] = vertices[i].Position;
+                attributes[i] = {vertices[i].Normal, vertices[i].TexCoords, vertices[i].Tangent, vertices[i].Bitangent};
+            }
+            GLBackend::bufferData(VBO, positions.size() * sizeof(glm::vec3), &positions[0], GL_STATIC_DRAW);
+            attributeVBO = GLBackend::createBuffer();
+            GLBackend::bufferData(attributeVBO, attributes.size() * sizeof(VertexAttributes), &attributes[0], GL_STATIC_DRAW);
+            positionStride = sizeof(glm::vec3);
+            attributeStride = sizeof(VertexAttributes);
+            // VertexAttributes is Vertex without the leading position
+            attributeBase = offsetof(Vertex, Normal);
+        }
+        else
+        {
+            // A great thing about structs is that their memory layout is sequential for all its items.
+            // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+            // again translates to 3/2 floats which translates to a byte array.
+            GLBackend::bufferData(VBO, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        GLBackend::bufferData(EBO, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
+        GLuint attributes = attributeVBO ? attributeVBO : VBO;
         // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        GLBackend::vertexAttribute(VAO, 0, 3, GL_FLOAT, VBO, (GLsizei)positionStride, 0);
         // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        GLBackend::vertexAttribute(VAO, 1, 3, GL_FLOAT, attributes, (GLsizei)attributeStride, offsetof(Vertex, Normal) - attributeBase);
         // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        GLBackend::vertexAttribute(VAO, 2, 2, GL_FLOAT, attributes, (GLsizei)attributeStride, offsetof(Vertex, TexCoords) - attributeBase);
         // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        GLBackend::vertexAttribute(VAO, 3, 3, GL_FLOAT, attributes, (GLsizei)attributeStride, offsetof(Vertex, Tangent) - attributeBase);
         // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        GLBackend::vertexAttribute(VAO, 4, 3, GL_FLOAT, attributes, (GLsizei)attributeStride, offsetof(Vertex, Bitangent) - attributeBase);
+        GLBackend::elementBuffer(VAO, EBO);
 
-        glBindVertexArray(0);
+        // depth only: the position stream and the indices
+        GLBackend::vertexAttribute(depthVAO, 0, 3, GL_FLOAT, VBO, (GLsizei)positionStride, 0);
+        GLBackend::elementBuffer(depthVAO, EBO);
     }
 };
 #endif
\ No newline at end of file
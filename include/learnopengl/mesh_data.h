@@ -0,0 +1,76 @@
+#ifndef MESH_DATA_H
+#define MESH_DATA_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+// CPU side result of loading a model file, one entry per material. Texture paths are relative to the
+// model directory, exactly like the strings Assimp reports for a material.
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::string material;
+    std::vector<std::pair<std::string, std::string>> textures; // (type, path), e.g. ("texture_diffuse", "a.png")
+};
+
+// smooth normals (when the file has none) plus tangents and bitangents, matching the
+// aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace flags used by the Assimp path.
+// positionIndex[i] names the source position of vertex i, vertices sharing one are smoothed together.
+inline void generateTangentSpace(MeshData &mesh, const std::vector<int> &positionIndex, bool generateNormals)
+{
+    std::vector<Vertex> &vertices = mesh.vertices;
+    std::vector<glm::vec3> smooth;
+    if (generateNormals) {
+        int maxPosition = 0;
+        for (int p : positionIndex)
+            maxPosition = std::max(maxPosition, p);
+        smooth.assign((size_t)maxPosition + 1, glm::vec3(0.0f));
+    }
+    for (Vertex &v : vertices) {
+        v.Tangent = glm::vec3(0.0f);
+        v.Bitangent = glm::vec3(0.0f);
+    }
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        unsigned int a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+        glm::vec3 e1 = vertices[b].Position - vertices[a].Position;
+        glm::vec3 e2 = vertices[c].Position - vertices[a].Position;
+        if (generateNormals) {
+            glm::vec3 n = glm::cross(e1, e2); // area weighted
+            smooth[positionIndex[a]] += n;
+            smooth[positionIndex[b]] += n;
+            smooth[positionIndex[c]] += n;
+        }
+        glm::vec2 d1 = vertices[b].TexCoords - vertices[a].TexCoords;
+        glm::vec2 d2 = vertices[c].TexCoords - vertices[a].TexCoords;
+        float det = d1.x * d2.y - d2.x * d1.y;
+        if (std::fabs(det) < 1e-12f)
+            continue;
+        float r = 1.0f / det;
+        glm::vec3 tangent = (e1 * d2.y - e2 * d1.y) * r;
+        glm::vec3 bitangent = (e2 * d1.x - e1 * d2.x) * r;
+        for (unsigned int k : {a, b, c}) {
+            vertices[k].Tangent += tangent;
+            vertices[k].Bitangent += bitangent;
+        }
+    }
+    for (size_t i = 0; i < vertices.size(); i++) {
+        Vertex &v = vertices[i];
+        if (generateNormals) {
+            glm::vec3 n = smooth[positionIndex[i]];
+            float len = glm::length(n);
+            v.Normal = len > 0.0f ? n / len : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+        float tl = glm::length(v.Tangent), bl = glm::length(v.Bitangent);
+        if (tl > 0.0f) v.Tangent = v.Tangent / tl;
+        if (bl > 0.0f) v.Bitangent = v.Bitangent / bl;
+    }
+}
+
+#endif
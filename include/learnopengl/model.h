@@ -12,7 +12,15 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
-
+#include <learnopengl/gl_backend.h>
+#include <learnopengl/filesystem.h>
+#include <learnopengl/cooked_texture.h>
+#include <learnopengl/obj_loader.h>
+#include <learnopengl/gltf_loader.h>
+#include <learnopengl/mapped_io_system.h>
+#include <learnopengl/scene_graph.h>
+
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -22,7 +30,14 @@
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromImage(const TextureImage &image, bool gamma = false);
 
+// which importer reads a model file; chosen per file when the Model is constructed
+enum ModelLoader {
+    MODEL_LOADER_ASSIMP,
+    MODEL_LOADER_NATIVE_OBJ, // obj_loader.h, multi-threaded and without an intermediate aiScene
+    MODEL_LOADER_GLB         // gltf_loader.h, buffer views uploaded straight from the mapped file
+};
 
 
 class Model
@@ -33,18 +48,25 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // vertex buffer layout of the meshes built from CPU data (glb meshes keep the file's buffer views)
+    VertexStorage vertexStorage;
+    // the file's node hierarchy with each node's transform relative to its parent, and the node every
+    // mesh hangs off; readers without a hierarchy give a single identity root. Meshes are drawn through
+    // the RenderQueue, each with the model matrix times nodes.world(meshNodes[i]) as its draw constants
+    SceneGraph nodes;
+    vector<int> meshNodes;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
-    {
-        loadModel(path);
-    }
-
-    // draws the model, and thus all its meshes
-    void Draw(Shader &shader)
+    Model(string const &path, bool gamma = false, ModelLoader loader = MODEL_LOADER_ASSIMP,
+          VertexStorage storage = VERTEX_STORAGE_INTERLEAVED)
+        : gammaCorrection(gamma), vertexStorage(storage)
     {
-        for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+        if (loader == MODEL_LOADER_NATIVE_OBJ)
+            loadObjModel(path);
+        else if (loader == MODEL_LOADER_GLB)
+            loadGlbModel(path);
+        else
+            loadModel(path);
     }
 
     void SetShaderTextureNamePrefix(std::string prefix) {
@@ -58,6 +80,7 @@ private:
     {
         // read file via ASSIMP
         Assimp::Importer importer;
+        importer.SetIOHandler(new MappedIOSystem()); // the importer takes ownership
         const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
@@ -68,12 +91,177 @@ private:
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
+        // the hierarchy breadth-first, so every level of it is contiguous in the scene graph
+        std::map<const aiNode*, int> nodeIndices;
+        vector<const aiNode*> queue(1, scene->mRootNode);
+        for (size_t i = 0; i < queue.size(); i++)
+        {
+            const aiNode *node = queue[i];
+            int parent = node->mParent ? nodeIndices[node->mParent] : SceneGraph::NO_PARENT;
+            nodeIndices[node] = nodes.add(parent, toGlm(node->mTransformation), node->mName.C_Str());
+            for (unsigned int j = 0; j < node->mNumChildren; j++)
+                queue.push_back(node->mChildren[j]);
+        }
+        nodes.update();
+
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        processNode(scene->mRootNode, scene, nodeIndices);
+    }
+
+    // Assimp's matrices are row-major, glm's column-major
+    static glm::mat4 toGlm(const aiMatrix4x4 &m)
+    {
+        glm::mat4 result;
+        for (int row = 0; row < 4; row++)
+            for (int column = 0; column < 4; column++)
+                result[column][row] = m[row][column];
+        return result;
+    }
+
+    // readers that only deliver meshes put them all at the origin
+    void addRootNode()
+    {
+        nodes.add(SceneGraph::NO_PARENT, glm::mat4(1.0f));
+        nodes.update();
+        meshNodes.assign(meshes.size(), 0);
+    }
+
+    // loads an .obj through the native reader, skipping Assimp entirely
+    void loadObjModel(string const &path)
+    {
+        vector<MeshData> data = loadObj(path);
+        if (data.empty())
+        {
+            cout << "ERROR::OBJ:: no meshes in " << path << endl;
+            return;
+        }
+        directory = path.substr(0, path.find_last_of('/'));
+        for (MeshData &mesh : data)
+        {
+            vector<Texture> textures;
+            for (const auto &texture : mesh.textures)
+                textures.push_back(loadTexture(texture.second, texture.first));
+            meshes.push_back(Mesh(std::move(mesh.vertices), std::move(mesh.indices), std::move(textures), vertexStorage));
+        }
+        addRootNode();
+    }
+
+    // loads a binary glTF; embedded images are decoded out of the mapped BIN chunk
+    void loadGlbModel(string const &path)
+    {
+        GlbFile glb;
+        if (!glb.open(path))
+            return;
+        directory = path.substr(0, path.find_last_of('/'));
+        std::map<int, Texture> images;
+        auto textureForImage = [&](int imageIndex, const string &typeName) {
+            auto found = images.find(imageIndex);
+            if (found != images.end())
+            {
+                Texture texture = found->second;
+                texture.type = typeName;
+                return texture;
+            }
+            const JsonValue &image = glb.json["images"][(size_t)imageIndex];
+            Texture texture;
+            if (image.has("bufferView"))
+            {
+                const JsonValue &view = glb.json["bufferViews"][(size_t)image["bufferView"].integer()];
+                size_t offset = (size_t)view["byteOffset"].number(0), length = (size_t)view["byteLength"].number(0);
+                TextureImage decoded;
+                if (offset + length <= glb.binSize && decoded.decode(AssetData::fromView(glb.bin + offset, length)))
+                    texture.id = TextureFromImage(decoded, gammaCorrection);
+                else
+                {
+                    cout << "ERROR::GLB:: cannot decode image " << imageIndex << " in " << path << endl;
+                    texture.id = GLBackend::createTexture(GL_TEXTURE_2D);
+                }
+                texture.type = typeName;
+                texture.path = path + "#image" + std::to_string(imageIndex);
+            }
+            else
+            {
+                texture = loadTexture(image["uri"].string(), typeName);
+            }
+            images[imageIndex] = texture;
+            return texture;
+        };
+        vector<int> sourceMeshes;
+        vector<Mesh> loaded = loadGlbMeshes(glb, textureForImage, false, &sourceMeshes);
+        loadGlbNodes(glb, loaded, sourceMeshes);
+    }
+
+    // the node tree of the file's scene, added breadth first like Assimp's; a node with a mesh gets that
+    // mesh's primitives, as copies sharing the GL objects when several nodes use one mesh. Meshes no
+    // node uses are not part of the scene. A file without nodes puts every mesh at the origin.
+    void loadGlbNodes(const GlbFile &glb, vector<Mesh> &loaded, const vector<int> &sourceMeshes)
+    {
+        const JsonValue &gltfNodes = glb.json["nodes"];
+        const JsonValue &scene = glb.json["scenes"][(size_t)glb.json["scene"].integer(0)];
+        vector<std::pair<int, int>> queue; // glTF node and the scene graph node of its parent
+        if (scene.has("nodes"))
+        {
+            for (size_t i = 0; i < scene["nodes"].size(); i++)
+                queue.push_back({scene["nodes"][i].integer(-1), SceneGraph::NO_PARENT});
+        }
+        else
+        {
+            // no scene: every node that is nobody's child is a root
+            vector<bool> child(gltfNodes.size(), false);
+            for (size_t i = 0; i < gltfNodes.size(); i++)
+                for (size_t c = 0; c < gltfNodes[i]["children"].size(); c++)
+                {
+                    int index = gltfNodes[i]["children"][c].integer(-1);
+                    if (index >= 0 && index < (int)child.size())
+                        child[index] = true;
+                }
+            for (size_t i = 0; i < gltfNodes.size(); i++)
+                if (!child[i])
+                    queue.push_back({(int)i, SceneGraph::NO_PARENT});
+        }
+
+        vector<vector<size_t>> primitives;
+        for (size_t i = 0; i < loaded.size(); i++)
+        {
+            if (sourceMeshes[i] >= (int)primitives.size())
+                primitives.resize(sourceMeshes[i] + 1);
+            primitives[sourceMeshes[i]].push_back(i);
+        }
+        vector<bool> visited(gltfNodes.size(), false);
+        for (size_t q = 0; q < queue.size(); q++)
+        {
+            int index = queue[q].first;
+            if (index < 0 || index >= (int)gltfNodes.size() || visited[index])
+            {
+                cout << "ERROR::GLB:: node " << index << " does not exist or is not part of a tree" << endl;
+                continue;
+            }
+            visited[index] = true;
+            const JsonValue &node = gltfNodes[(size_t)index];
+            int graphNode = nodes.add(queue[q].second, gltfNodeTransform(node), node["name"].string());
+            int mesh = node["mesh"].integer(-1);
+            if (mesh >= 0 && mesh < (int)primitives.size())
+                for (size_t i : primitives[mesh])
+                {
+                    meshes.push_back(loaded[i]);
+                    meshNodes.push_back(graphNode);
+                }
+            const JsonValue &children = node["children"];
+            for (size_t c = 0; c < children.size(); c++)
+                queue.push_back({children[c].integer(-1), graphNode});
+        }
+        if (nodes.size() == 0)
+        {
+            for (Mesh &mesh : loaded)
+                meshes.push_back(std::move(mesh));
+            addRootNode();
+            return;
+        }
+        nodes.update();
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    void processNode(aiNode *node, const aiScene *scene, std::map<const aiNode*, int> &nodeIndices)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -82,11 +270,12 @@ private:
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
             meshes.push_back(processMesh(mesh, scene));
+            meshNodes.push_back(nodeIndices[node]);
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, nodeIndices);
         }
 
     }
@@ -179,7 +368,7 @@ private:
 
 
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return Mesh(std::move(vertices), std::move(indices), std::move(textures), vertexStorage);
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -191,28 +380,31 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            textures.push_back(loadTexture(str.C_Str(), typeName));
+        }
+        return textures;
+    }
+
+    // loads a texture relative to the model directory unless an earlier material already did
+    Texture loadTexture(const string &path, const string &typeName)
+    {
+        // check if texture was loaded before and if so, skip loading a new texture
+        for(unsigned int j = 0; j < textures_loaded.size(); j++)
+        {
+            if(textures_loaded[j].path == path)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                Texture texture = textures_loaded[j];
                 texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+                return texture; // a texture with the same filepath has already been loaded (optimization)
             }
         }
-        return textures;
+        // if texture hasn't been loaded already, load it
+        Texture texture;
+        texture.id = TextureFromFile(path.c_str(), this->directory);
+        texture.type = typeName;
+        texture.path = path;
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        return texture;
     }
 };
 
@@ -222,37 +414,48 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
+    // cooked textures are uploaded as is, anything else is decoded straight out of the mapping
+    AssetData file = FileSystem::read(filename);
+    TextureImage image;
+    if (!image.decode(file))
     {
         std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        return GLBackend::createTexture(GL_TEXTURE_2D);
     }
+    return TextureFromImage(image, gamma);
+}
+
+// uploads decoded pixels, shared by file textures and images embedded in model files
+unsigned int TextureFromImage(const TextureImage &image, bool gamma)
+{
+    unsigned int textureID = GLBackend::createTexture(GL_TEXTURE_2D);
+
+    // immutable storage needs a sized internal format and the whole mip chain up front
+    GLenum format, internalFormat;
+    if (image.components == 1) {
+        format = GL_RED;
+        internalFormat = GL_R8;
+    } else if (image.components == 2) {
+        format = GL_RG;
+        internalFormat = GL_RG8;
+    } else if (image.components == 3) {
+        format = GL_RGB;
+        internalFormat = GL_RGB8;
+    } else {
+        format = GL_RGBA;
+        internalFormat = GL_RGBA8;
+    }
+    GLsizei levels = 1;
+    while ((std::max(image.width, image.height) >> levels) > 0)
+        levels++;
+
+    GLBackend::textureStorage2D(textureID, levels, internalFormat, image.width, image.height, format, GL_UNSIGNED_BYTE, image.pixels);
+    GLBackend::generateMipmap(textureID, GL_TEXTURE_2D);
+
+    GLBackend::textureParameter(textureID, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    GLBackend::textureParameter(textureID, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    GLBackend::textureParameter(textureID, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    GLBackend::textureParameter(textureID, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     return textureID;
 }
@@ -0,0 +1,420 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/cooked_mesh.h>
+#include <learnopengl/filesystem.h>
+#include <learnopengl/mesh_data.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct ObjMaterial {
+    std::vector<std::pair<std::string, std::string>> textures;
+};
+
+namespace obj_detail {
+
+    // files are split into chunks of at least this size, smaller files are parsed on the calling thread
+    const size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+    inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+
+    inline const char* skipSpaces(const char *p, const char *end)
+    {
+        while (p < end && isSpace(*p))
+            p++;
+        return p;
+    }
+
+    inline const char* skipLine(const char *p, const char *end)
+    {
+        const void *nl = std::memchr(p, '\n', (size_t)(end - p));
+        return nl ? static_cast<const char*>(nl) + 1 : end;
+    }
+
+    // Decimal float parser for the subset of syntax OBJ exporters emit: [sign] digits [. digits] [e [sign] digits].
+    // Mantissa digits are accumulated in an integer and scaled once, avoiding strtof's locale handling.
+    inline const char* parseFloat(const char *p, const char *end, float &out)
+    {
+        static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                         1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        p = skipSpaces(p, end);
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        uint64_t mantissa = 0;
+        int exponent = 0, digits = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                if (mantissa) digits++;
+            } else {
+                exponent++;
+            }
+        }
+        if (p < end && *p == '.') {
+            for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                    if (mantissa) digits++;
+                    exponent--;
+                }
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            const char *q = p + 1;
+            bool negativeExponent = false;
+            if (q < end && (*q == '-' || *q == '+'))
+                negativeExponent = *q++ == '-';
+            if (q < end && *q >= '0' && *q <= '9') {
+                int e = 0;
+                for (; q < end && *q >= '0' && *q <= '9'; q++)
+                    e = std::min(e * 10 + (*q - '0'), 1000);
+                exponent += negativeExponent ? -e : e;
+                p = q;
+            }
+        }
+        double value = (double)mantissa;
+        while (exponent > 22) { value *= 1e22; exponent -= 22; }
+        while (exponent < -22) { value /= 1e22; exponent += 22; }
+        value = exponent >= 0 ? value * powers[exponent] : value / powers[-exponent];
+        out = (float)(negative ? -value : value);
+        return p;
+    }
+
+    inline const char* parseInt(const char *p, const char *end, int &out)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        int value = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            value = value * 10 + (*p - '0');
+        out = negative ? -value : value;
+        return p;
+    }
+
+    // one polygon corner; indices are 0 based, -1 when absent. Negative (relative) OBJ indices are
+    // resolved against the chunk's own element count and flagged, the chunk base is added after the merge.
+    struct Corner {
+        int v, vt, vn;
+        uint8_t relative; // bit 0: v, bit 1: vt, bit 2: vn
+    };
+
+    struct Chunk {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texCoords;
+        std::vector<glm::vec3> normals;
+        std::vector<Corner> corners; // triangles, fan-triangulated from the file's polygons
+        std::vector<std::pair<size_t, std::string>> materialSwitches; // (first corner, material)
+        std::vector<std::string> materialLibraries;
+    };
+
+    inline int resolveIndex(int raw, size_t count, uint8_t flag, uint8_t &relative)
+    {
+        if (raw > 0)
+            return raw - 1;
+        if (raw < 0) {
+            relative |= flag;
+            return (int)count + raw;
+        }
+        return -1;
+    }
+
+    inline void parseChunk(const char *p, const char *end, Chunk &chunk)
+    {
+        // the face being read; kept across faces so it only allocates for the largest polygon
+        std::vector<Corner> polygon;
+        while (p < end) {
+            p = skipSpaces(p, end);
+            if (p >= end)
+                break;
+            char c = *p;
+            if (c == 'v' && p + 1 < end) {
+                char kind = p[1];
+                if (isSpace(kind)) {
+                    glm::vec3 v;
+                    p = parseFloat(p + 2, end, v.x);
+                    p = parseFloat(p, end, v.y);
+                    p = parseFloat(p, end, v.z);
+                    chunk.positions.push_back(v);
+                } else if (kind == 't') {
+                    glm::vec2 t;
+                    p = parseFloat(p + 2, end, t.x);
+                    p = parseFloat(p, end, t.y);
+                    chunk.texCoords.push_back(t);
+                } else if (kind == 'n') {
+                    glm::vec3 n;
+                    p = parseFloat(p + 2, end, n.x);
+                    p = parseFloat(p, end, n.y);
+                    p = parseFloat(p, end, n.z);
+                    chunk.normals.push_back(n);
+                }
+            } else if (c == 'f' && p + 1 < end && isSpace(p[1])) {
+                p += 2;
+                polygon.clear();
+                while (true) {
+                    p = skipSpaces(p, end);
+                    if (p >= end || *p == '\n' || *p == '\r' || *p == '#')
+                        break;
+                    Corner corner;
+                    corner.relative = 0;
+                    int raw = 0;
+                    p = parseInt(p, end, raw);
+                    corner.v = resolveIndex(raw, chunk.positions.size(), 1, corner.relative);
+                    corner.vt = corner.vn = -1;
+                    if (p < end && *p == '/') {
+                        p++;
+                        if (p < end && *p != '/') {
+                            p = parseInt(p, end, raw);
+                            corner.vt = resolveIndex(raw, chunk.texCoords.size(), 2, corner.relative);
+                        }
+                        if (p < end && *p == '/') {
+                            p = parseInt(p + 1, end, raw);
+                            corner.vn = resolveIndex(raw, chunk.normals.size(), 4, corner.relative);
+                        }
+                    }
+                    // skip anything unexpected so a malformed token can't stall the loop
+                    while (p < end && !isSpace(*p) && *p != '\n' && *p != '\r')
+                        p++;
+                    polygon.push_back(corner);
+                }
+                for (size_t i = 2; i < polygon.size(); i++) {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i - 1]);
+                    chunk.corners.push_back(polygon[i]);
+                }
+            } else if (c == 'u' && end - p > 7 && std::memcmp(p, "usemtl", 6) == 0 && isSpace(p[6])) {
+                const char *name = skipSpaces(p + 7, end);
+                const char *nameEnd = name;
+                while (nameEnd < end && *nameEnd != '\n' && *nameEnd != '\r')
+                    nameEnd++;
+                while (nameEnd > name && isSpace(nameEnd[-1]))
+                    nameEnd--;
+                chunk.materialSwitches.emplace_back(chunk.corners.size(), std::string(name, nameEnd));
+                p = nameEnd;
+            } else if (c == 'm' && end - p > 7 && std::memcmp(p, "mtllib", 6) == 0 && isSpace(p[6])) {
+                const char *name = skipSpaces(p + 7, end);
+                const char *nameEnd = name;
+                while (nameEnd < end && *nameEnd != '\n' && *nameEnd != '\r')
+                    nameEnd++;
+                while (nameEnd > name && isSpace(nameEnd[-1]))
+                    nameEnd--;
+                chunk.materialLibraries.emplace_back(name, nameEnd);
+                p = nameEnd;
+            }
+            p = skipLine(p, end);
+        }
+    }
+
+    struct CornerKey {
+        int v, vt, vn;
+        bool operator==(const CornerKey &o) const { return v == o.v && vt == o.vt && vn == o.vn; }
+    };
+
+    struct CornerKeyHash {
+        size_t operator()(const CornerKey &k) const
+        {
+            uint64_t h = (uint64_t)(uint32_t)k.v * 0x9E3779B97F4A7C15ull;
+            h ^= (uint64_t)(uint32_t)k.vt * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+            h ^= (uint64_t)(uint32_t)k.vn * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+            return (size_t)h;
+        }
+    };
+}
+
+// Parses a .mtl file into texture references using the same sampler names Model uses for Assimp materials.
+inline std::unordered_map<std::string, ObjMaterial> parseObjMaterials(const AssetData &file)
+{
+    std::unordered_map<std::string, ObjMaterial> materials;
+    if (!file.valid())
+        return materials;
+    const char *p = file.chars(), *end = p + file.size();
+    ObjMaterial *current = nullptr;
+    while (p < end) {
+        const char *lineEnd = p;
+        while (lineEnd < end && *lineEnd != '\n' && *lineEnd != '\r')
+            lineEnd++;
+        const char *key = obj_detail::skipSpaces(p, lineEnd);
+        const char *keyEnd = key;
+        while (keyEnd < lineEnd && !obj_detail::isSpace(*keyEnd))
+            keyEnd++;
+        std::string keyword(key, keyEnd);
+        const char *valueEnd = lineEnd;
+        while (valueEnd > keyEnd && obj_detail::isSpace(valueEnd[-1]))
+            valueEnd--;
+        // texture options ("-bm 0.5 file.png") precede the file name, which is the last token
+        const char *value = valueEnd;
+        while (value > keyEnd && !obj_detail::isSpace(value[-1]))
+            value--;
+        if (keyword == "newmtl") {
+            current = &materials[std::string(obj_detail::skipSpaces(keyEnd, valueEnd), valueEnd)];
+        } else if (current && value < valueEnd) {
+            // Assimp maps map_Kd/map_Ks/map_Bump/map_Ka to DIFFUSE/SPECULAR/HEIGHT/AMBIENT, which Model
+            // names texture_diffuse/texture_specular/texture_normal/texture_height
+            const char *type = nullptr;
+            if (keyword == "map_Kd") type = "texture_diffuse";
+            else if (keyword == "map_Ks") type = "texture_specular";
+            else if (keyword == "map_Bump" || keyword == "map_bump" || keyword == "bump") type = "texture_normal";
+            else if (keyword == "map_Ka") type = "texture_height";
+            if (type)
+                current->textures.emplace_back(type, std::string(value, valueEnd));
+        }
+        p = lineEnd < end ? lineEnd + 1 : end;
+    }
+    return materials;
+}
+
+inline std::unordered_map<std::string, ObjMaterial> loadObjMaterials(const std::string &path)
+{
+    return parseObjMaterials(FileSystem::read(path));
+}
+
+// Native OBJ reader: the file is split into line aligned chunks that are parsed on separate threads,
+// vertex/texcoord/normal triplets are merged through a hash map and the result is grouped per material.
+// UVs are flipped and tangents generated to match what the Assimp path produces.
+// file holds the contents of path, material libraries next to it are read through read.
+inline std::vector<MeshData> parseObj(const AssetData &file, const std::string &path, unsigned threads,
+                                      const std::function<AssetData(const std::string&)> &read)
+{
+    std::vector<MeshData> result;
+    const char *begin = file.chars(), *end = begin + file.size();
+
+    // 1. split at line boundaries and parse every chunk independently
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threads, file.size() / obj_detail::MIN_CHUNK_SIZE));
+    std::vector<const char*> bounds(chunkCount + 1, end);
+    bounds[0] = begin;
+    for (size_t i = 1; i < chunkCount; i++) {
+        const char *split = std::max(bounds[i - 1], begin + file.size() * i / chunkCount);
+        bounds[i] = obj_detail::skipLine(split, end);
+    }
+    std::vector<obj_detail::Chunk> chunks(chunkCount);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunkCount; i++)
+        workers.emplace_back(obj_detail::parseChunk, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+    obj_detail::parseChunk(bounds[0], bounds[1], chunks[0]);
+    for (std::thread &t : workers)
+        t.join();
+
+    // 2. concatenate attribute arrays and turn chunk relative indices into global ones
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> texCoords;
+    size_t totalPositions = 0, totalTexCoords = 0, totalNormals = 0;
+    for (const obj_detail::Chunk &c : chunks) {
+        totalPositions += c.positions.size();
+        totalTexCoords += c.texCoords.size();
+        totalNormals += c.normals.size();
+    }
+    positions.reserve(totalPositions);
+    texCoords.reserve(totalTexCoords);
+    normals.reserve(totalNormals);
+    for (obj_detail::Chunk &c : chunks) {
+        int baseV = (int)positions.size(), baseVt = (int)texCoords.size(), baseVn = (int)normals.size();
+        for (obj_detail::Corner &corner : c.corners) {
+            if (corner.relative & 1) corner.v += baseV;
+            if (corner.relative & 2) corner.vt += baseVt;
+            if (corner.relative & 4) corner.vn += baseVn;
+        }
+        positions.insert(positions.end(), c.positions.begin(), c.positions.end());
+        texCoords.insert(texCoords.end(), c.texCoords.begin(), c.texCoords.end());
+        normals.insert(normals.end(), c.normals.begin(), c.normals.end());
+    }
+
+    // 3. materials
+    std::string directory = path.substr(0, path.find_last_of('/'));
+    std::unordered_map<std::string, ObjMaterial> materials;
+    for (const obj_detail::Chunk &c : chunks)
+        for (const std::string &library : c.materialLibraries) {
+            std::unordered_map<std::string, ObjMaterial> loaded = parseObjMaterials(read(directory + "/" + library));
+            materials.insert(loaded.begin(), loaded.end());
+        }
+
+    // 4. deduplicate corners per material; a material that continues across a chunk border keeps going
+    std::unordered_map<std::string, size_t> meshIndex;
+    std::vector<std::unordered_map<obj_detail::CornerKey, unsigned int, obj_detail::CornerKeyHash>> lookups;
+    std::vector<std::vector<int>> positionIndices;
+    std::vector<bool> hasNormals;
+    std::string material;
+    for (const obj_detail::Chunk &c : chunks) {
+        size_t nextSwitch = 0;
+        for (size_t i = 0; i + 2 < c.corners.size(); i += 3) {
+            while (nextSwitch < c.materialSwitches.size() && c.materialSwitches[nextSwitch].first <= i)
+                material = c.materialSwitches[nextSwitch++].second;
+            auto found = meshIndex.find(material);
+            size_t m;
+            if (found == meshIndex.end()) {
+                m = result.size();
+                meshIndex[material] = m;
+                result.emplace_back();
+                result.back().material = material;
+                auto mat = materials.find(material);
+                if (mat != materials.end())
+                    result.back().textures = mat->second.textures;
+                lookups.emplace_back();
+                lookups.back().reserve(c.corners.size() / 2);
+                positionIndices.emplace_back();
+                hasNormals.push_back(true);
+            } else {
+                m = found->second;
+            }
+            MeshData &mesh = result[m];
+            for (size_t k = i; k < i + 3; k++) {
+                const obj_detail::Corner &corner = c.corners[k];
+                if (corner.v < 0 || corner.v >= (int)positions.size())
+                    continue;
+                obj_detail::CornerKey key = {corner.v,
+                        corner.vt >= 0 && corner.vt < (int)texCoords.size() ? corner.vt : -1,
+                        corner.vn >= 0 && corner.vn < (int)normals.size() ? corner.vn : -1};
+                auto inserted = lookups[m].emplace(key, (unsigned int)mesh.vertices.size());
+                if (inserted.second) {
+                    Vertex vertex;
+                    vertex.Position = positions[key.v];
+                    vertex.Normal = key.vn >= 0 ? normals[key.vn] : glm::vec3(0.0f);
+                    // aiProcess_FlipUVs
+                    vertex.TexCoords = key.vt >= 0 ? glm::vec2(texCoords[key.vt].x, 1.0f - texCoords[key.vt].y) : glm::vec2(0.0f, 0.0f);
+                    mesh.vertices.push_back(vertex);
+                    positionIndices[m].push_back(key.v);
+                    if (key.vn < 0)
+                        hasNormals[m] = false;
+                }
+                mesh.indices.push_back(inserted.first->second);
+            }
+            // a corner referencing a missing vertex drops the whole triangle
+            if (mesh.indices.size() % 3)
+                mesh.indices.resize(mesh.indices.size() - mesh.indices.size() % 3);
+        }
+    }
+
+    for (size_t m = 0; m < result.size(); m++)
+        generateTangentSpace(result[m], positionIndices[m], !hasNormals[m]);
+    return result;
+}
+
+// an .obj through the file system; when asset_cooker has put the parsed meshes next to it, those are
+// taken instead of parsing
+inline std::vector<MeshData> loadObj(const std::string &path, unsigned threads = 0)
+{
+    std::vector<MeshData> result;
+    std::string cooked = path + COOKED_MESH_SUFFIX;
+    if (FileSystem::exists(cooked) && readCookedMeshes(FileSystem::read(cooked), result))
+        return result;
+    AssetData file = FileSystem::read(path);
+    if (!file.valid()) {
+        std::cout << "ERROR::OBJ::CANNOT_READ " << path << std::endl;
+        return result;
+    }
+    return parseObj(file, path, threads, [](const std::string &library) { return FileSystem::read(library); });
+}
+
+#endif
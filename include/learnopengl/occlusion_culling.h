@@ -0,0 +1,267 @@
+#ifndef OCCLUSION_CULLING_H
+#define OCCLUSION_CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/job_system.h>
+#include <learnopengl/frustum.h>
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Positions and triangle indices of something big enough to hide other objects: a wall, the terrain,
+// or a low poly stand-in for a model.
+struct OcclusionMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+
+    // interleaved float vertices with the position first, drawn as a plain triangle list
+    static OcclusionMesh fromVertices(const float *vertices, size_t vertexCount, size_t stride)
+    {
+        OcclusionMesh mesh;
+        for (size_t i = 0; i < vertexCount; i++) {
+            mesh.positions.push_back(glm::vec3(vertices[i * stride], vertices[i * stride + 1], vertices[i * stride + 2]));
+            mesh.indices.push_back((unsigned int)i);
+        }
+        return mesh;
+    }
+
+    static OcclusionMesh fromMesh(const Mesh &source)
+    {
+        OcclusionMesh mesh;
+        mesh.positions.reserve(source.vertices.size());
+        for (const Vertex &v : source.vertices)
+            mesh.positions.push_back(v.Position);
+        mesh.indices = source.indices;
+        return mesh;
+    }
+};
+
+struct OcclusionStats {
+    unsigned int occluderTriangles = 0;
+    unsigned int tested = 0;
+    unsigned int culled = 0;
+    double rasterMs = 0.0;
+};
+
+// Low resolution CPU depth buffer for occlusion culling. Each frame the occluders are rasterized with
+// half-space edge functions, four pixels at a time with SSE2, split into horizontal bands across the
+// job system. Occludees then test their screen space bounding rectangle against it: an object is hidden
+// only if every pixel under its rectangle is nearer than the object's nearest point, so the test errs
+// towards drawing. Depth is NDC z mapped to [0, 1], smaller is nearer.
+class SoftwareOcclusion
+{
+public:
+    static const int WIDTH = 256;
+    static const int HEIGHT = 192;
+
+    OcclusionStats stats;
+
+    explicit SoftwareOcclusion(JobSystem &jobs) : jobs(jobs), depth(WIDTH * HEIGHT, 1.0f) {}
+
+    void begin(const glm::mat4 &viewProjection)
+    {
+        this->viewProjection = viewProjection;
+        triangles.clear();
+        stats = OcclusionStats();
+    }
+
+    // clips to the near plane and sets up the triangles; call between begin and rasterize
+    void addOccluder(const OcclusionMesh &mesh, const glm::mat4 &model)
+    {
+        glm::mat4 mvp = viewProjection * model;
+        clip.resize(mesh.positions.size());
+        for (size_t i = 0; i < mesh.positions.size(); i++)
+            clip[i] = mvp * glm::vec4(mesh.positions[i], 1.0f);
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+            addClipTriangle(clip[mesh.indices[i]], clip[mesh.indices[i + 1]], clip[mesh.indices[i + 2]]);
+    }
+
+    void rasterize()
+    {
+        auto start = std::chrono::steady_clock::now();
+        stats.occluderTriangles = (unsigned int)triangles.size();
+        unsigned int bands = jobs.threadCount() * 2;
+        int bandHeight = (HEIGHT + (int)bands - 1) / (int)bands;
+        jobs.run(bands, [&](unsigned int band, unsigned int) {
+            int y0 = (int)band * bandHeight, y1 = std::min(HEIGHT, y0 + bandHeight);
+            if (y0 >= y1)
+                return;
+            std::fill(depth.begin() + y0 * WIDTH, depth.begin() + y1 * WIDTH, 1.0f);
+            for (const ScreenTriangle &t : triangles)
+                rasterizeTriangle(t, y0, y1);
+        });
+        stats.rasterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // world space box; thread safe once rasterize has returned
+    bool isVisible(const glm::vec3 &boxMin, const glm::vec3 &boxMax)
+    {
+        visibleTests++;
+        float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minZ = 1.0f;
+        for (int i = 0; i < 8; i++) {
+            glm::vec4 p = viewProjection * glm::vec4(i & 1 ? boxMax.x : boxMin.x, i & 2 ? boxMax.y : boxMin.y,
+                                                     i & 4 ? boxMax.z : boxMin.z, 1.0f);
+            if (p.w <= NEAR_W || p.z < -p.w)
+                return true; // touches the near plane, too close to judge
+            float x = (p.x / p.w * 0.5f + 0.5f) * WIDTH, y = (p.y / p.w * 0.5f + 0.5f) * HEIGHT;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            minZ = std::min(minZ, p.z / p.w * 0.5f + 0.5f);
+        }
+        int x0 = std::max(0, (int)std::floor(minX)), x1 = std::min(WIDTH - 1, (int)std::ceil(maxX));
+        int y0 = std::max(0, (int)std::floor(minY)), y1 = std::min(HEIGHT - 1, (int)std::ceil(maxY));
+        if (x0 > x1 || y0 > y1)
+            return true; // off screen, frustum culling's call
+        bool visible = false;
+        for (int y = y0; y <= y1 && !visible; y++) {
+            const float *row = &depth[y * WIDTH];
+            int x = x0;
+#ifdef __SSE2__
+            __m128 z = _mm_set1_ps(minZ);
+            for (; x + 3 <= x1; x += 4)
+                if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), z))) {
+                    visible = true;
+                    break;
+                }
+#endif
+            for (; x <= x1 && !visible; x++)
+                visible = row[x] >= minZ;
+        }
+        if (!visible)
+            culledTests++;
+        return visible;
+    }
+
+    // folds the counters of the isVisible calls since the last call into stats
+    void collectStats()
+    {
+        stats.tested = visibleTests.exchange(0);
+        stats.culled = culledTests.exchange(0);
+    }
+
+    bool isVisible(const BoundingBox &box) { return isVisible(box.min, box.max); }
+
+    const std::vector<float>& depthBuffer() const { return depth; }
+
+private:
+    static constexpr float NEAR_W = 1e-5f;
+
+    struct ScreenTriangle {
+        // edge i: a*x + b*y + c >= 0 inside, normalized so the three sum to 1 (barycentrics)
+        float a[3], b[3], c[3];
+        float z[3];
+        int minX, maxX, minY, maxY;
+    };
+
+    JobSystem &jobs;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    std::vector<float> depth;
+    std::vector<ScreenTriangle> triangles;
+    std::vector<glm::vec4> clip;
+    std::atomic<unsigned int> visibleTests{0}, culledTests{0};
+
+    void addClipTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c)
+    {
+        // Sutherland-Hodgman against z >= -w, which leaves at most a quad
+        glm::vec4 in[3] = {a, b, c}, out[4];
+        int n = 0;
+        for (int i = 0; i < 3; i++) {
+            const glm::vec4 &p = in[i], &q = in[(i + 1) % 3];
+            float dp = p.z + p.w, dq = q.z + q.w;
+            if (dp >= 0.0f)
+                out[n++] = p;
+            if ((dp >= 0.0f) != (dq >= 0.0f))
+                out[n++] = p + (q - p) * (dp / (dp - dq));
+        }
+        for (int i = 1; i + 1 < n; i++)
+            setup(out[0], out[i], out[i + 1]);
+    }
+
+    void setup(const glm::vec4 &c0, const glm::vec4 &c1, const glm::vec4 &c2)
+    {
+        const glm::vec4 *c[3] = {&c0, &c1, &c2};
+        float x[3], y[3], z[3];
+        for (int i = 0; i < 3; i++) {
+            float w = std::max(c[i]->w, NEAR_W);
+            x[i] = (c[i]->x / w * 0.5f + 0.5f) * WIDTH;
+            y[i] = (c[i]->y / w * 0.5f + 0.5f) * HEIGHT;
+            z[i] = c[i]->z / w * 0.5f + 0.5f;
+        }
+        float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (std::fabs(area) < 1e-8f)
+            return;
+        ScreenTriangle t;
+        // both windings are accepted; dividing by the signed area flips the edges of back facing ones
+        for (int i = 0; i < 3; i++) {
+            int j = (i + 1) % 3, k = (i + 2) % 3;
+            // edge opposite vertex i, positive on i's side
+            t.a[i] = (y[j] - y[k]) / area;
+            t.b[i] = (x[k] - x[j]) / area;
+            t.c[i] = (x[j] * y[k] - x[k] * y[j]) / area;
+            t.z[i] = z[i];
+        }
+        float minX = std::min({x[0], x[1], x[2]}), maxX = std::max({x[0], x[1], x[2]});
+        float minY = std::min({y[0], y[1], y[2]}), maxY = std::max({y[0], y[1], y[2]});
+        if (maxX < 0.0f || maxY < 0.0f || minX > WIDTH || minY > HEIGHT)
+            return;
+        t.minX = std::max(0, (int)std::floor(minX)) & ~3;
+        t.maxX = std::min(WIDTH - 1, (int)std::ceil(maxX));
+        t.minY = std::max(0, (int)std::floor(minY));
+        t.maxY = std::min(HEIGHT - 1, (int)std::ceil(maxY));
+        triangles.push_back(t);
+    }
+
+    void rasterizeTriangle(const ScreenTriangle &t, int bandY0, int bandY1)
+    {
+        int y0 = std::max(t.minY, bandY0), y1 = std::min(t.maxY, bandY1 - 1);
+#ifdef __SSE2__
+        const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 a0 = _mm_set1_ps(t.a[0]), a1 = _mm_set1_ps(t.a[1]), a2 = _mm_set1_ps(t.a[2]);
+        __m128 z0 = _mm_set1_ps(t.z[0]), z1 = _mm_set1_ps(t.z[1]), z2 = _mm_set1_ps(t.z[2]);
+#endif
+        for (int y = y0; y <= y1; y++) {
+            float py = y + 0.5f;
+            float r0 = t.b[0] * py + t.c[0], r1 = t.b[1] * py + t.c[1], r2 = t.b[2] * py + t.c[2];
+            float *row = &depth[y * WIDTH];
+#ifdef __SSE2__
+            __m128 row0 = _mm_set1_ps(r0), row1 = _mm_set1_ps(r1), row2 = _mm_set1_ps(r2);
+            for (int x = t.minX; x <= t.maxX; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), row0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), row1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), row2);
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                if (!_mm_movemask_ps(inside))
+                    continue;
+                __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e0, z0), _mm_mul_ps(e1, z1)), _mm_mul_ps(e2, z2));
+                __m128 old = _mm_load_ps(row + x);
+                __m128 nearer = _mm_and_ps(inside, _mm_cmplt_ps(z, old));
+                _mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(nearer, z), _mm_andnot_ps(nearer, old)));
+            }
+#else
+            for (int x = t.minX; x <= t.maxX; x++) {
+                float px = x + 0.5f;
+                float e0 = t.a[0] * px + r0, e1 = t.a[1] * px + r1, e2 = t.a[2] * px + r2;
+                if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f)
+                    continue;
+                float z = e0 * t.z[0] + e1 * t.z[1] + e2 * t.z[2];
+                row[x] = std::min(row[x], z);
+            }
+#endif
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef OCCLUSION_QUERIES_H
+#define OCCLUSION_QUERIES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <learnopengl/gl_backend.h>
+#include <learnopengl/frustum.h>
+
+#include <map>
+#include <vector>
+
+// Recycles query objects instead of creating and deleting them every frame.
+class QueryPool
+{
+public:
+    ~QueryPool()
+    {
+        if (!all.empty())
+            glDeleteQueries((GLsizei)all.size(), all.data());
+    }
+
+    GLuint acquire()
+    {
+        if (free.empty()) {
+            GLuint ids[16];
+            glGenQueries(16, ids);
+            all.insert(all.end(), ids, ids + 16);
+            free.insert(free.end(), ids, ids + 16);
+        }
+        GLuint id = free.back();
+        free.pop_back();
+        return id;
+    }
+
+    void release(GLuint id)
+    {
+        free.push_back(id);
+    }
+
+    size_t size() const { return all.size(); }
+
+private:
+    std::vector<GLuint> all, free;
+};
+
+struct OcclusionQueryStats {
+    unsigned int tracked = 0;
+    unsigned int hidden = 0;   // results that were ready and said no sample passed
+    unsigned int pending = 0;  // results that were not ready yet when the query was retired
+};
+
+// GPU occlusion queries for expensive objects, one frame behind. Every frame each tracked object's
+// bounding box is drawn with color and depth writes off inside a GL_ANY_SAMPLES_PASSED query, after the
+// opaque geometry. The next frame draws the object inside glBeginConditionalRender on that query with
+// GL_QUERY_NO_WAIT, so the GPU skips it if the box was hidden and the CPU never waits for a result.
+// Objects that stop asking for a condition give their queries back to the pool after a few frames.
+class OcclusionQueries
+{
+public:
+    OcclusionQueryStats stats;
+
+    OcclusionQueries() : boxShader("resources/shaders/occlusion_box.vs", "resources/shaders/occlusion_box.fs")
+    {
+        float corners[] = {
+                -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f, 0.5f, -0.5f,   -0.5f, 0.5f, -0.5f,
+                -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f, 0.5f,  0.5f,   -0.5f, 0.5f,  0.5f
+        };
+        unsigned char indices[] = {
+                0, 1, 2, 2, 3, 0,   4, 6, 5, 6, 4, 7,   0, 4, 5, 5, 1, 0,
+                3, 2, 6, 6, 7, 3,   0, 3, 7, 7, 4, 0,   1, 5, 6, 6, 2, 1
+        };
+        VAO = GLBackend::createVertexArray();
+        VBO = GLBackend::createBuffer();
+        EBO = GLBackend::createBuffer();
+        GLBackend::bufferData(VBO, sizeof(corners), corners, GL_STATIC_DRAW);
+        GLBackend::bufferData(EBO, sizeof(indices), indices, GL_STATIC_DRAW);
+        GLBackend::vertexAttribute(VAO, 0, 3, GL_FLOAT, VBO, 3 * sizeof(float), 0);
+        GLBackend::elementBuffer(VAO, EBO);
+    }
+
+    ~OcclusionQueries()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        glDeleteProgram(boxShader.ID);
+    }
+
+    OcclusionQueries(const OcclusionQueries&) = delete;
+    OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+
+    // The query to render key under this frame, or 0 to draw it unconditionally: on its first frame, and
+    // while the camera is inside the (slightly grown) box, since the near plane would clip the box away.
+    // Also registers bounds for this frame's issue().
+    GLuint condition(unsigned int key, const BoundingBox &bounds, const glm::vec3 &cameraPos)
+    {
+        Entry &entry = entries[key];
+        entry.bounds = bounds;
+        entry.lastFrame = frame;
+        bool inside = true;
+        for (int i = 0; i < 3; i++)
+            inside &= cameraPos[i] >= bounds.min[i] - 0.2f && cameraPos[i] <= bounds.max[i] + 0.2f;
+        return inside ? 0 : entry.previous;
+    }
+
+    // Draws the boxes of everything that asked for a condition this frame into fresh queries.
+    // Call after the opaque geometry, with its depth buffer still bound.
+    void issue(const glm::mat4 &viewProjection)
+    {
+        boxShader.use();
+        glBindVertexArray(VAO);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        for (auto &item : entries) {
+            Entry &entry = item.second;
+            if (entry.lastFrame != frame)
+                continue;
+            glm::vec3 center = (entry.bounds.min + entry.bounds.max) * 0.5f;
+            glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), center), entry.bounds.max - entry.bounds.min);
+            boxShader.setMat4("mvp", viewProjection * model);
+            entry.current = pool.acquire();
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, entry.current);
+            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, 0);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+        }
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glBindVertexArray(0);
+    }
+
+    // Retires last frame's queries (reading results only if they are already available, for the stats),
+    // promotes this frame's, and drops objects that have not been seen for a while.
+    void endFrame()
+    {
+        stats = OcclusionQueryStats();
+        for (auto it = entries.begin(); it != entries.end();) {
+            Entry &entry = it->second;
+            if (entry.previous) {
+                GLuint available = 0, passed = 1;
+                glGetQueryObjectuiv(entry.previous, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (available) {
+                    glGetQueryObjectuiv(entry.previous, GL_QUERY_RESULT, &passed);
+                    stats.hidden += passed == 0;
+                } else {
+                    stats.pending++;
+                }
+                pool.release(entry.previous);
+            }
+            entry.previous = entry.current;
+            entry.current = 0;
+            if (frame - entry.lastFrame > RETIRE_FRAMES) {
+                if (entry.previous)
+                    pool.release(entry.previous);
+                it = entries.erase(it);
+            } else {
+                stats.tracked++;
+                ++it;
+            }
+        }
+        frame++;
+    }
+
+    size_t poolSize() const { return pool.size(); }
+
+private:
+    static const unsigned int RETIRE_FRAMES = 3;
+
+    struct Entry {
+        BoundingBox bounds;
+        GLuint previous = 0; // issued last frame, used as this frame's condition
+        GLuint current = 0;  // issued this frame
+        unsigned long lastFrame = 0;
+    };
+
+    Shader boxShader;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    QueryPool pool;
+    std::map<unsigned int, Entry> entries;
+    unsigned long frame = 0;
+};
+
+#endif
@@ -0,0 +1,411 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/stream_buffer.h>
+#include <learnopengl/affine_math.h>
+#include <learnopengl/gl_backend.h>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Passes are the most significant part of the sort key, so everything of one pass is drawn before the next.
+// RENDER_PASS_DEPTH_PREPASS lays down depth only, for the opaque surfaces that are then shaded against
+// it. RENDER_PASS_DEFERRED holds the surfaces written to the G-buffer when deferred shading is on; they
+// are executed on their own, before the lighting pass, and the forward passes follow.
+enum RenderPass {
+    RENDER_PASS_DEPTH_PREPASS = 0,
+    RENDER_PASS_DEFERRED = 1,
+    RENDER_PASS_OPAQUE = 2,
+    RENDER_PASS_TRANSPARENT = 3
+};
+
+// Per draw shader constants, the std140 DrawConstants block of draw_constants.glsl. RenderQueue writes
+// one per packet into a StreamBuffer after sorting and binds it with glBindBufferRange at each draw.
+struct DrawConstants {
+    glm::mat4 model;
+    NormalMatrix normalMatrix;
+};
+
+const GLuint DRAW_CONSTANTS_BINDING = 0;
+
+// points a shader's DrawConstants block at DRAW_CONSTANTS_BINDING; shaders without one are left alone
+inline void bindDrawConstantsBlock(const Shader &shader)
+{
+    GLuint block = glGetUniformBlockIndex(shader.ID, "DrawConstants");
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(shader.ID, block, DRAW_CONSTANTS_BINDING);
+}
+
+// A shader plus the uniforms that are the same for every draw in a frame (camera, lights). perFrame runs
+// the first time the program is bound in a frame, not once per draw.
+struct RenderProgram {
+    uint16_t id = 0;
+    Shader *shader = nullptr;
+    std::function<void(Shader&)> perFrame;
+};
+
+// Textures bound to consecutive units starting at 0, plus uniforms that belong to the surface rather than
+// to the draw. Every material used with a program should set the same uniform names, since nothing resets them.
+struct RenderMaterial {
+    struct Sampler {
+        std::string name;
+        unsigned int texture;
+    };
+    uint16_t id = 0;
+    std::vector<Sampler> samplers;
+    std::vector<std::pair<std::string, glm::vec3>> vec3s;
+    std::vector<std::pair<std::string, float>> floats;
+
+    void apply(Shader &shader) const
+    {
+        for (unsigned int i = 0; i < samplers.size(); i++)
+        {
+            GLBackend::bindTexture((int)i, GL_TEXTURE_2D, samplers[i].texture);
+            shader.setInt(samplers[i].name, (int)i);
+        }
+        for (const auto &v : vec3s)
+            shader.setVec3(v.first, v.second);
+        for (const auto &f : floats)
+            shader.setFloat(f.first, f.second);
+    }
+};
+
+// A range of a VAO. indexType == 0 means glDrawArrays starting at first, otherwise
+// glDrawElementsBaseVertex with indexOffset in bytes and baseVertex added to every index. sharedMesh is the same triangles' id in a GeometryBuffer, -1 if they are
+// not in one. depthVao, if set, holds only the positions, for depth only passes.
+struct RenderGeometry {
+    unsigned int vao = 0;
+    GLenum mode = GL_TRIANGLES;
+    GLsizei count = 0;
+    GLint first = 0;
+    GLenum indexType = 0;
+    size_t indexOffset = 0;
+    GLint baseVertex = 0;
+    int sharedMesh = -1;
+    unsigned int depthVao = 0;
+
+    // the same range drawn from the position only VAO, if there is one
+    RenderGeometry depthOnly() const
+    {
+        RenderGeometry g = *this;
+        if (depthVao)
+            g.vao = depthVao;
+        return g;
+    }
+
+    static RenderGeometry arrays(unsigned int vao, GLint first, GLsizei count)
+    {
+        RenderGeometry g;
+        g.vao = vao;
+        g.first = first;
+        g.count = count;
+        return g;
+    }
+
+    static RenderGeometry elements(unsigned int vao, GLsizei count, GLenum indexType, size_t indexOffset = 0)
+    {
+        RenderGeometry g;
+        g.vao = vao;
+        g.count = count;
+        g.indexType = indexType;
+        g.indexOffset = indexOffset;
+        return g;
+    }
+
+    static RenderGeometry fromMesh(const Mesh &mesh)
+    {
+        RenderGeometry geometry = elements(mesh.VAO, (GLsizei)mesh.indexCount, mesh.indexType, mesh.indexOffset);
+        geometry.depthVao = mesh.depthVAO;
+        return geometry;
+    }
+};
+
+struct DrawPacket {
+    uint64_t key;
+    const RenderProgram *program;
+    const RenderMaterial *material;
+    RenderGeometry geometry;
+    glm::mat4 model; // per draw constants
+    GLuint condition; // occlusion query to render under, 0 for none
+    uint16_t tag;     // caller defined object class, not part of the key
+};
+
+struct RenderQueueStats {
+    unsigned int draws = 0;
+    unsigned int conditionalDraws = 0;
+    unsigned int programBinds = 0;
+    unsigned int materialBinds = 0;
+    unsigned int vaoBinds = 0;
+    unsigned int vertices = 0;
+};
+
+namespace render_queue_detail {
+    // floats >= 0 keep their order when compared as unsigned integers
+    inline uint32_t depthBits(float depth)
+    {
+        if (!(depth > 0.0f))
+            return 0;
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return bits;
+    }
+}
+
+inline uint64_t makeDrawKey(RenderPass pass, uint16_t program, uint16_t material, float depth)
+{
+    uint64_t d = render_queue_detail::depthBits(depth);
+    uint64_t p = (uint64_t)(program & 0xFFF), m = material;
+    if (pass == RENDER_PASS_TRANSPARENT)
+        return ((uint64_t)pass << 60) | ((~d & 0xFFFFFFFFull) << 28) | (p << 16) | m;
+    return ((uint64_t)pass << 60) | (p << 48) | (m << 32) | d;
+}
+
+// Draw packets recorded for one frame. Recording makes no GL calls, so any thread can fill its own list;
+// the lists are handed to a RenderQueue on the GL thread for sorting and replay.
+class CommandList
+{
+public:
+    // view is used to compute the camera space depth of every submitted packet
+    void begin(const glm::mat4 &view)
+    {
+        this->view = view;
+        packets.clear();
+    }
+
+    // condition is an occlusion query the draw is conditionally rendered on (see OcclusionQueries),
+    // tag lets RenderQueue::execute pick out one class of objects
+    void submit(RenderPass pass, const RenderProgram &program, const RenderMaterial &material,
+                const RenderGeometry &geometry, const glm::mat4 &model, GLuint condition = 0, uint16_t tag = 0)
+    {
+        DrawPacket packet;
+        float depth = -(view * model[3]).z;
+        packet.key = makeDrawKey(pass, program.id, material.id, depth);
+        packet.program = &program;
+        packet.material = &material;
+        packet.geometry = geometry;
+        packet.model = model;
+        packet.condition = condition;
+        packet.tag = tag;
+        packets.push_back(packet);
+    }
+
+    size_t size() const { return packets.size(); }
+    const DrawPacket& operator[](size_t i) const { return packets[i]; }
+
+private:
+    glm::mat4 view = glm::mat4(1.0f);
+    std::vector<DrawPacket> packets;
+};
+
+// Collects the command lists of a frame, sorts their packets by key and submits them with redundant
+// state changes filtered out.
+//   opaque:      pass:4 | program:12 | material:16 | depth:32   (front to back inside a bucket)
+//   transparent: pass:4 | ~depth:32  | program:12 | material:16 (back to front, correctness first)
+class RenderQueue
+{
+public:
+    struct SortItem {
+        uint64_t key;
+        const DrawPacket *packet;
+    };
+
+    RenderQueueStats stats;
+
+    // constants is where the per draw constants of every frame go
+    explicit RenderQueue(StreamBuffer &constants) : constants(constants)
+    {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        constantsAlignment = (size_t)alignment;
+        constantsStride = (sizeof(DrawConstants) + constantsAlignment - 1) / constantsAlignment * constantsAlignment;
+    }
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    void begin(const glm::mat4 &view)
+    {
+        immediate.begin(view);
+        lists.clear();
+    }
+
+    // records into the queue's own list, for draws issued from the GL thread
+    void submit(RenderPass pass, const RenderProgram &program, const RenderMaterial &material,
+                const RenderGeometry &geometry, const glm::mat4 &model, GLuint condition = 0, uint16_t tag = 0)
+    {
+        immediate.submit(pass, program, material, geometry, model, condition, tag);
+    }
+
+    // list has to stay alive and unchanged until execute
+    void add(const CommandList &list)
+    {
+        lists.push_back(&list);
+    }
+
+    // LSD radix sort over the keys, 8 bits per pass; passes where every key has the same byte are skipped,
+    // which with few programs/materials is most of the upper ones. Then the draw constants are written
+    // in sorted order, so they have to be in the stream buffer's frame.
+    void sort()
+    {
+        stats = RenderQueueStats();
+        initialized.clear();
+        items.clear();
+        gather(immediate);
+        for (const CommandList *list : lists)
+            gather(*list);
+        size_t n = items.size();
+        scratch.resize(n);
+        for (int shift = 0; shift < 64; shift += 8) {
+            size_t histogram[256] = {0};
+            for (size_t i = 0; i < n; i++)
+                histogram[(items[i].key >> shift) & 0xFF]++;
+            if (n == 0 || histogram[(items[0].key >> shift) & 0xFF] == n)
+                continue;
+            size_t sum = 0;
+            for (size_t &h : histogram) {
+                size_t count = h;
+                h = sum;
+                sum += count;
+            }
+            for (size_t i = 0; i < n; i++)
+                scratch[histogram[(items[i].key >> shift) & 0xFF]++] = items[i];
+            items.swap(scratch);
+        }
+        writeConstants();
+    }
+
+    void execute()
+    {
+        execute(items.data(), items.data() + items.size(), false, 0);
+    }
+
+    // only the packets of one pass; stats add up over the calls of a frame
+    void execute(RenderPass pass)
+    {
+        std::pair<const SortItem*, const SortItem*> packets = range(pass);
+        execute(packets.first, packets.second, false, 0);
+    }
+
+    // only the packets of one pass with the given tag, still in key order
+    void execute(RenderPass pass, uint16_t tag)
+    {
+        std::pair<const SortItem*, const SortItem*> packets = range(pass);
+        execute(packets.first, packets.second, true, tag);
+    }
+
+    // the sorted packets of one pass, for passes that draw them with their own state
+    std::pair<const SortItem*, const SortItem*> range(RenderPass pass) const
+    {
+        const SortItem *begin = items.data(), *end = items.data() + items.size();
+        while (begin != end && (begin->key >> 60) < (uint64_t)pass)
+            begin++;
+        const SortItem *last = begin;
+        while (last != end && (last->key >> 60) == (uint64_t)pass)
+            last++;
+        return std::make_pair(begin, last);
+    }
+
+    const std::vector<SortItem>& sorted() const { return items; }
+
+    // binds the constants of one of the sorted packets, for passes drawing them with their own shader
+    void bindConstants(const SortItem *item) const
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, DRAW_CONSTANTS_BINDING, constantsAllocation.buffer,
+                          constantsAllocation.offset + (item - items.data()) * constantsStride, sizeof(DrawConstants));
+    }
+
+private:
+    CommandList immediate;
+    std::vector<const CommandList*> lists;
+    std::vector<SortItem> items, scratch;
+    std::vector<const RenderProgram*> initialized; // programs whose perFrame ran this frame
+    StreamBuffer &constants;
+    StreamAllocation constantsAllocation;
+    size_t constantsAlignment = 256, constantsStride = 256;
+
+    void writeConstants()
+    {
+        constantsAllocation = StreamAllocation();
+        if (items.empty())
+            return;
+        constantsAllocation = constants.allocate(items.size() * constantsStride, constantsAlignment);
+        char *data = (char*)constantsAllocation.data;
+        for (size_t i = 0; i < items.size(); i++) {
+            DrawConstants draw;
+            draw.model = items[i].packet->model;
+            draw.normalMatrix = affineNormalMatrix(draw.model);
+            std::memcpy(data + i * constantsStride, &draw, sizeof(draw));
+        }
+        constants.commit(constantsAllocation);
+    }
+
+    void execute(const SortItem *begin, const SortItem *end, bool filter, uint16_t tag)
+    {
+        const RenderProgram *program = nullptr;
+        const RenderMaterial *material = nullptr;
+        unsigned int vao = 0;
+        for (const SortItem *item = begin; item != end; item++) {
+            const DrawPacket &packet = *item->packet;
+            if (filter && packet.tag != tag)
+                continue;
+            if (packet.program != program) {
+                program = packet.program;
+                program->shader->use();
+                material = nullptr;
+                stats.programBinds++;
+                bool first = true;
+                for (const RenderProgram *p : initialized)
+                    first &= p != program;
+                if (first) {
+                    initialized.push_back(program);
+                    bindDrawConstantsBlock(*program->shader);
+                    if (program->perFrame)
+                        program->perFrame(*program->shader);
+                }
+            }
+            if (packet.material != material) {
+                material = packet.material;
+                material->apply(*program->shader);
+                stats.materialBinds++;
+            }
+            if (packet.geometry.vao != vao) {
+                vao = packet.geometry.vao;
+                glBindVertexArray(vao);
+                stats.vaoBinds++;
+            }
+            bindConstants(item);
+            const RenderGeometry &g = packet.geometry;
+            if (packet.condition)
+                glBeginConditionalRender(packet.condition, GL_QUERY_NO_WAIT);
+            if (g.indexType)
+                glDrawElementsBaseVertex(g.mode, g.count, g.indexType, (void*)g.indexOffset, g.baseVertex);
+            else
+                glDrawArrays(g.mode, g.first, g.count);
+            if (packet.condition) {
+                glEndConditionalRender();
+                stats.conditionalDraws++;
+            }
+            stats.draws++;
+            stats.vertices += g.count;
+        }
+        glBindVertexArray(0);
+        GLBackend::resetActiveTexture();
+    }
+
+    void gather(const CommandList &list)
+    {
+        for (size_t i = 0; i < list.size(); i++)
+            items.push_back(SortItem{list[i].key, &list[i]});
+    }
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/job_system.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// A transform hierarchy in breadth-first order: a node's parent always comes before it and every depth
+// level is one contiguous range of the arrays. update() goes level by level, so each node reads a parent
+// world transform that is already final, and the nodes of one level do not depend on each other and
+// are split across the job system. World transforms are cached; setLocal() marks the node dirty and
+// update() recomputes only the dirty nodes and everything below them.
+class SceneGraph
+{
+public:
+    static const int NO_PARENT = -1;
+    // nodes per job when a level is updated in parallel
+    static const size_t GRAIN = 256;
+
+    // a node under parent (NO_PARENT for a root); nodes have to come level by level, as a breadth-first
+    // walk of the tree produces them. Returns its index, -1 if it would break the order.
+    int add(int parent, const glm::mat4 &local, const std::string &name = std::string())
+    {
+        if (parent < NO_PARENT || parent >= (int)size()) {
+            std::cout << "ERROR::SCENE_GRAPH::NO_SUCH_PARENT: " << name << std::endl;
+            return -1;
+        }
+        unsigned int depth = parent == NO_PARENT ? 0 : depths[parent] + 1;
+        if (!depths.empty() && depth < depths.back()) {
+            std::cout << "ERROR::SCENE_GRAPH::NOT_BREADTH_FIRST: " << name << std::endl;
+            return -1;
+        }
+        if (levels.empty())
+            levels.push_back(0);
+        if (depth == levelCount())
+            levels.push_back(size());
+        levels.back() = size() + 1;
+        parents.push_back(parent);
+        depths.push_back(depth);
+        locals.push_back(local);
+        worlds.push_back(local);
+        names.push_back(name);
+        dirty.push_back(1);
+        firstDirty = std::min(firstDirty, depth);
+        return (int)size() - 1;
+    }
+
+    size_t size() const { return parents.size(); }
+    // level l holds nodes [levelBegin(l), levelBegin(l + 1))
+    size_t levelCount() const { return levels.empty() ? 0 : levels.size() - 1; }
+    size_t levelBegin(size_t level) const { return levels[level]; }
+
+    int parent(int node) const { return parents[node]; }
+    const std::string& name(int node) const { return names[node]; }
+    const glm::mat4& local(int node) const { return locals[node]; }
+    // as of the last update()
+    const glm::mat4& world(int node) const { return worlds[node]; }
+
+    // first node called name, -1 if there is none
+    int find(const std::string &name) const
+    {
+        auto found = std::find(names.begin(), names.end(), name);
+        return found == names.end() ? -1 : (int)(found - names.begin());
+    }
+
+    void setLocal(int node, const glm::mat4 &local)
+    {
+        locals[node] = local;
+        dirty[node] = 1;
+        firstDirty = std::min(firstDirty, depths[node]);
+    }
+
+    // recomputes the world transforms of the dirty subtrees, each level split across jobs if given one;
+    // returns how many nodes were recomputed
+    size_t update(JobSystem *jobs = nullptr)
+    {
+        if (firstDirty == CLEAN)
+            return 0;
+        std::vector<size_t> counts(jobs ? jobs->threadCount() : 1, 0);
+        auto updateRange = [this, &counts](size_t begin, size_t end, unsigned int worker) {
+            size_t count = 0;
+            for (size_t i = begin; i < end; i++) {
+                int p = parents[i];
+                // a parent recomputed this update stays dirty until the end, which carries it down
+                if (!dirty[i] && (p == NO_PARENT || !dirty[p]))
+                    continue;
+                worlds[i] = p == NO_PARENT ? locals[i] : worlds[p] * locals[i];
+                dirty[i] = 1;
+                count++;
+            }
+            counts[worker] += count;
+        };
+        for (size_t level = firstDirty; level < levelCount(); level++) {
+            size_t begin = levels[level], end = levels[level + 1];
+            if (jobs)
+                jobs->parallelFor(end - begin, GRAIN, [&](size_t b, size_t e, unsigned int worker) {
+                    updateRange(begin + b, begin + e, worker);
+                });
+            else
+                updateRange(begin, end, 0);
+        }
+        std::fill(dirty.begin() + levels[firstDirty], dirty.end(), (unsigned char)0);
+        firstDirty = CLEAN;
+        size_t total = 0;
+        for (size_t count : counts)
+            total += count;
+        return total;
+    }
+
+private:
+    static const unsigned int CLEAN = ~0u;
+
+    std::vector<int> parents;
+    std::vector<unsigned int> depths;
+    std::vector<glm::mat4> locals, worlds;
+    std::vector<std::string> names;
+    std::vector<unsigned char> dirty;
+    std::vector<size_t> levels; // first node of each level, then the end
+    unsigned int firstDirty = CLEAN;
+};
+
+#endif
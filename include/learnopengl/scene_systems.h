@@ -0,0 +1,240 @@
+#ifndef SCENE_SYSTEMS_H
+#define SCENE_SYSTEMS_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/ecs.h>
+#include <learnopengl/frustum.h>
+#include <learnopengl/job_system.h>
+#include <learnopengl/light_clusters.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#ifdef __SSE2__
+#include <xmmintrin.h>
+#endif
+
+struct RenderGeometry;
+struct RenderMaterial;
+
+// The components of scene objects and the systems over them. Each system takes the chunks holding its
+// components and spreads them over the job system, whole chunks per job; inside a chunk it runs down the
+// component arrays, four entities at a time with SSE2 where the math allows.
+
+// position, then a turn about +y of yaw + spin * time radians, then a uniform scale; world is
+// translate * rotate * scale, written by updateTransforms
+struct Transform {
+    glm::mat4 world = glm::mat4(1.0f);
+    glm::vec3 position = glm::vec3(0.0f);
+    float scale = 1.0f;
+    float yaw = 0.0f;
+    float spin = 0.0f;
+};
+
+// a world space bounding sphere around the transform's position, kept there by updateTransforms
+struct Bounds {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+// what a visible entity submits: geometry and material for one class of objects, with an optional
+// cheaper geometry beyond the LOD distance. pulled are the same for vertex pulling. visible and far are
+// this frame's results of cullMeshes and selectLods.
+struct MeshRenderer {
+    const RenderGeometry *geometry = nullptr;
+    const RenderGeometry *pulled = nullptr;
+    const RenderGeometry *farGeometry = nullptr;
+    const RenderGeometry *farPulled = nullptr;
+    const RenderMaterial *material = nullptr;
+    uint16_t objectClass = 0;
+    bool visible = true;
+    bool far = false;
+};
+
+// a point light at the transform's position, attenuated like PointLight
+struct Light {
+    glm::vec3 ambient = glm::vec3(0.0f);
+    float constant = 1.0f;
+    glm::vec3 diffuse = glm::vec3(1.0f);
+    float linear = 0.09f;
+    glm::vec3 specular = glm::vec3(1.0f);
+    float quadratic = 0.032f;
+};
+
+namespace scene_detail {
+    // translate(position) * rotate(angle, +y) * scale(scale), with glm's rounding: its rotation puts
+    // c + (1 - c) on the diagonal for the axis
+    inline void composeYaw(glm::mat4 &world, const glm::vec3 &position, float scale, float c, float s)
+    {
+        world[0] = glm::vec4(c * scale, 0.0f, -s * scale, 0.0f);
+        world[1] = glm::vec4(0.0f, (c + (1.0f - c)) * scale, 0.0f, 0.0f);
+        world[2] = glm::vec4(s * scale, 0.0f, c * scale, 0.0f);
+        world[3] = glm::vec4(position, 1.0f);
+    }
+
+    // fn(chunk) for every chunk, in about four jobs per worker
+    template <typename F>
+    void forChunks(JobSystem &jobs, std::vector<Chunk*> &chunks, const F &fn)
+    {
+        size_t grain = std::max<size_t>(1, chunks.size() / (jobs.threadCount() * 4));
+        jobs.parallelFor(chunks.size(), grain, [&](size_t begin, size_t end, unsigned int) {
+            for (size_t i = begin; i < end; i++)
+                fn(*chunks[i]);
+        });
+    }
+}
+
+// world matrices at time and the bounds that go with them
+inline void updateTransforms(World &world, JobSystem &jobs, float time)
+{
+    std::vector<Chunk*> chunks;
+    world.chunks<Transform>(chunks);
+    scene_detail::forChunks(jobs, chunks, [time](Chunk &chunk) {
+        Transform *transforms = chunk.array<Transform>();
+        Bounds *bounds = chunk.array<Bounds>();
+        unsigned int count = chunk.count, i = 0;
+#ifdef __SSE2__
+        // the sines and cosines are the library's, so matrices match glm::rotate to the bit; the SIMD part
+        // assembles four matrices' columns at once
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), negate = _mm_set1_ps(-0.0f);
+        for (; i + 4 <= count; i += 4) {
+            alignas(16) float c[4], s[4], scale[4];
+            for (int k = 0; k < 4; k++) {
+                const Transform &t = transforms[i + k];
+                float angle = t.spin * time + t.yaw;
+                c[k] = std::cos(angle);
+                s[k] = std::sin(angle);
+                scale[k] = t.scale;
+            }
+            __m128 sc = _mm_load_ps(scale), vc = _mm_load_ps(c), vs = _mm_load_ps(s);
+            __m128 a = _mm_mul_ps(vc, sc);                                 // c * scale
+            __m128 b = _mm_mul_ps(_mm_xor_ps(vs, negate), sc);             // -s * scale
+            __m128 y = _mm_mul_ps(_mm_add_ps(vc, _mm_sub_ps(one, vc)), sc); // (c + (1 - c)) * scale
+            __m128 nb = _mm_xor_ps(b, negate);                             // s * scale
+            __m128 ab01 = _mm_unpacklo_ps(a, b), ab23 = _mm_unpackhi_ps(a, b);
+            __m128 ba01 = _mm_unpacklo_ps(nb, a), ba23 = _mm_unpackhi_ps(nb, a);
+            __m128 y01 = _mm_unpacklo_ps(zero, y), y23 = _mm_unpackhi_ps(zero, y);
+            __m128 column0[4] = {_mm_unpacklo_ps(ab01, zero), _mm_unpackhi_ps(ab01, zero),
+                                 _mm_unpacklo_ps(ab23, zero), _mm_unpackhi_ps(ab23, zero)};
+            __m128 column1[4] = {_mm_movelh_ps(y01, zero), _mm_movehl_ps(zero, y01),
+                                 _mm_movelh_ps(y23, zero), _mm_movehl_ps(zero, y23)};
+            __m128 column2[4] = {_mm_unpacklo_ps(ba01, zero), _mm_unpackhi_ps(ba01, zero),
+                                 _mm_unpacklo_ps(ba23, zero), _mm_unpackhi_ps(ba23, zero)};
+            for (int k = 0; k < 4; k++) {
+                Transform &t = transforms[i + k];
+                _mm_storeu_ps(&t.world[0][0], column0[k]);
+                _mm_storeu_ps(&t.world[1][0], column1[k]);
+                _mm_storeu_ps(&t.world[2][0], column2[k]);
+                t.world[3] = glm::vec4(t.position, 1.0f);
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            Transform &t = transforms[i];
+            float angle = t.spin * time + t.yaw;
+            scene_detail::composeYaw(t.world, t.position, t.scale, std::cos(angle), std::sin(angle));
+        }
+        if (bounds)
+            for (i = 0; i < count; i++)
+                bounds[i].center = transforms[i].position;
+    });
+}
+
+// MeshRenderer::visible for every entity with bounds: inside frustum, and not occluded(box), the box
+// around the sphere; occluded is called from the workers
+template <typename F>
+void cullMeshes(World &world, JobSystem &jobs, const Frustum &frustum, const F &occluded)
+{
+    std::vector<Chunk*> chunks;
+    world.chunks<MeshRenderer, Bounds>(chunks);
+    scene_detail::forChunks(jobs, chunks, [&](Chunk &chunk) {
+        MeshRenderer *meshes = chunk.array<MeshRenderer>();
+        const Bounds *bounds = chunk.array<Bounds>();
+        unsigned int count = chunk.count, i = 0;
+        auto finish = [&](unsigned int k, bool inside) {
+            BoundingBox box;
+            box.min = bounds[k].center - glm::vec3(bounds[k].radius);
+            box.max = bounds[k].center + glm::vec3(bounds[k].radius);
+            meshes[k].visible = inside && !occluded(box);
+        };
+#ifdef __SSE2__
+        // four spheres against one plane at a time, the same operations as Frustum::intersectsSphere
+        for (; i + 4 <= count; i += 4) {
+            __m128 x = _mm_loadu_ps(&bounds[i].center.x), y = _mm_loadu_ps(&bounds[i + 1].center.x);
+            __m128 z = _mm_loadu_ps(&bounds[i + 2].center.x), r = _mm_loadu_ps(&bounds[i + 3].center.x);
+            _MM_TRANSPOSE4_PS(x, y, z, r);
+            __m128 negativeRadius = _mm_xor_ps(r, _mm_set1_ps(-0.0f));
+            __m128 outside = _mm_setzero_ps();
+            for (const glm::vec4 &p : frustum.planes) {
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), x), _mm_mul_ps(_mm_set1_ps(p.y), y)),
+                                      _mm_mul_ps(_mm_set1_ps(p.z), z));
+                d = _mm_add_ps(d, _mm_set1_ps(p.w));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negativeRadius));
+            }
+            int mask = _mm_movemask_ps(outside);
+            for (unsigned int k = 0; k < 4; k++)
+                finish(i + k, !(mask & (1 << k)));
+        }
+#endif
+        for (; i < count; i++)
+            finish(i, frustum.intersectsSphere(bounds[i].center, bounds[i].radius));
+    });
+}
+
+// MeshRenderer::far for every entity with bounds and far geometry: whether its sphere lies beyond distance
+// from the camera
+inline void selectLods(World &world, JobSystem &jobs, const glm::vec3 &cameraPos, float distance)
+{
+    std::vector<Chunk*> chunks;
+    world.chunks<MeshRenderer, Bounds>(chunks);
+    scene_detail::forChunks(jobs, chunks, [&](Chunk &chunk) {
+        MeshRenderer *meshes = chunk.array<MeshRenderer>();
+        const Bounds *bounds = chunk.array<Bounds>();
+        unsigned int count = chunk.count, i = 0;
+#ifdef __SSE2__
+        const __m128 cx = _mm_set1_ps(cameraPos.x), cy = _mm_set1_ps(cameraPos.y), cz = _mm_set1_ps(cameraPos.z);
+        const __m128 limit = _mm_set1_ps(distance);
+        for (; i + 4 <= count; i += 4) {
+            __m128 x = _mm_loadu_ps(&bounds[i].center.x), y = _mm_loadu_ps(&bounds[i + 1].center.x);
+            __m128 z = _mm_loadu_ps(&bounds[i + 2].center.x), r = _mm_loadu_ps(&bounds[i + 3].center.x);
+            _MM_TRANSPOSE4_PS(x, y, z, r);
+            x = _mm_sub_ps(x, cx);
+            y = _mm_sub_ps(y, cy);
+            z = _mm_sub_ps(z, cz);
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+            int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_sub_ps(length, r), limit));
+            for (unsigned int k = 0; k < 4; k++)
+                meshes[i + k].far = meshes[i + k].farGeometry && (mask & (1 << k));
+        }
+#endif
+        for (; i < count; i++)
+            meshes[i].far = meshes[i].farGeometry &&
+                            glm::length(bounds[i].center - cameraPos) - bounds[i].radius > distance;
+    });
+}
+
+// appends a PointLight for every entity with a light
+inline void gatherLights(World &world, std::vector<PointLight> &lights)
+{
+    std::vector<Chunk*> chunks;
+    world.chunks<Transform, Light>(chunks);
+    for (Chunk *chunk : chunks) {
+        const Transform *transforms = chunk->array<Transform>();
+        const Light *sources = chunk->array<Light>();
+        for (unsigned int i = 0; i < chunk->count; i++) {
+            PointLight light;
+            light.position = transforms[i].position;
+            light.ambient = sources[i].ambient;
+            light.diffuse = sources[i].diffuse;
+            light.specular = sources[i].specular;
+            light.constant = sources[i].constant;
+            light.linear = sources[i].linear;
+            light.quadratic = sources[i].quadratic;
+            lights.push_back(light);
+        }
+    }
+}
+
+#endif
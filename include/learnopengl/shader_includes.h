@@ -0,0 +1,61 @@
+#ifndef SHADER_INCLUDES_H
+#define SHADER_INCLUDES_H
+
+#include <learnopengl/asset_pack.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+// Expands '#include "file"' lines in GLSL sources. Included paths are relative to the including file.
+// The cooker bakes the expansion into the pack; loose shaders are expanded at load time.
+// read(path, contents) returns false when a file can't be found; every visited file is appended to deps.
+template <typename ReadFn>
+bool expandShaderIncludes(const std::string &path, const std::string &source, ReadFn read, std::string &out,
+                          std::vector<std::string> &deps, std::set<std::string> &visited)
+{
+    if (!visited.insert(normalizeAssetPath(path)).second)
+        return true; // already expanded once, acts as an include guard
+    std::string directory = path.substr(0, path.find_last_of('/') + 1);
+    size_t pos = 0;
+    while (pos < source.size()) {
+        size_t end = source.find('\n', pos);
+        if (end == std::string::npos)
+            end = source.size();
+        std::string line = source.substr(pos, end - pos);
+        size_t directive = line.find_first_not_of(" \t");
+        if (directive != std::string::npos && line.compare(directive, 8, "#include") == 0) {
+            size_t open = line.find('"', directive);
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos) {
+                std::cout << "ERROR::SHADER::MALFORMED_INCLUDE " << path << ": " << line << std::endl;
+                return false;
+            }
+            std::string included = normalizeAssetPath(directory + line.substr(open + 1, close - open - 1));
+            std::string contents;
+            if (!read(included, contents)) {
+                std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << included << " from " << path << std::endl;
+                return false;
+            }
+            deps.push_back(included);
+            if (!expandShaderIncludes(included, contents, read, out, deps, visited))
+                return false;
+        } else {
+            out.append(line);
+            out += '\n';
+        }
+        pos = end + 1;
+    }
+    return true;
+}
+
+inline bool hasShaderIncludes(const char *source, size_t size)
+{
+    static const char directive[] = "#include";
+    for (size_t i = 0; i + sizeof(directive) - 1 <= size; i++)
+        if (std::memcmp(source + i, directive, sizeof(directive) - 1) == 0)
+            return true;
+    return false;
+}
+
+#endif
@@ -5,10 +5,14 @@
 #include <glm/glm.hpp>
 
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <set>
+#include <vector>
 #include <iostream>
 #include <common.h>
+#include <learnopengl/filesystem.h>
+#include <learnopengl/shader_includes.h>
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/gl_backend.h>
 class Shader
 {
 public:
@@ -17,53 +21,18 @@ public:
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
+        // 1. retrieve the vertex/fragment source code from filePath; both files are requested together so
+        // they go out as one batch (or come straight from the pack), and their buffers are handed to
+        // glShaderSource without a further copy
+        const char* paths[2] = {vertexPath, fragmentPath};
+        std::vector<AssetData> sources;
+        std::string expanded[2];
+        const char* code[2];
+        GLint length[2];
+        readSources(paths, 2, sources, expanded, code, length);
         // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        unsigned int vertex = compileStage(GL_VERTEX_SHADER, code[0], length[0], "VERTEX");
+        unsigned int fragment = compileStage(GL_FRAGMENT_SHADER, code[1], length[1], "FRAGMENT");
         // shader Program
         ID = glCreateProgram();
         glAttachShader(ID, vertex);
@@ -75,72 +44,125 @@ public:
         glDeleteShader(fragment);
 
     }
+    // compute program, needs a GL 4.3 context
+    // ------------------------------------------------------------------------
+    explicit Shader(const char* computePath)
+    {
+        std::vector<AssetData> sources;
+        std::string expanded[1];
+        const char* code[1];
+        GLint length[1];
+        readSources(&computePath, 1, sources, expanded, code, length);
+        unsigned int compute = compileStage(GL_COMPUTE_SHADER, code[0], length[0], "COMPUTE");
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(compute);
+    }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
     { 
         glUseProgram(ID); 
     }
-    // utility uniform functions
+    // utility uniform functions; with the DSA backend they work without use()
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        GLBackend::uniform1i(ID, glGetUniformLocation(ID, name.c_str()), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        GLBackend::uniform1i(ID, glGetUniformLocation(ID, name.c_str()), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        GLBackend::uniform1f(ID, glGetUniformLocation(ID, name.c_str()), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLBackend::uniform2fv(ID, glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        setVec2(name, glm::vec2(x, y)); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLBackend::uniform3fv(ID, glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        setVec3(name, glm::vec3(x, y, z)); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLBackend::uniform4fv(ID, glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) const
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        setVec4(name, glm::vec4(x, y, z, w)); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLBackend::uniformMatrix2fv(ID, glGetUniformLocation(ID, name.c_str()), &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLBackend::uniformMatrix3fv(ID, glGetUniformLocation(ID, name.c_str()), &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLBackend::uniformMatrix4fv(ID, glGetUniformLocation(ID, name.c_str()), &mat[0][0]);
     }
 
 private:
+    // reads all stages as one batch; cooked shaders already have their includes expanded, loose ones are
+    // expanded here into expanded[i]
+    // ------------------------------------------------------------------------
+    static void readSources(const char* const* paths, int count, std::vector<AssetData>& sources,
+                            std::string* expanded, const char** code, GLint* length)
+    {
+        sources = FileSystem::readBatch(std::vector<std::string>(paths, paths + count));
+        for (int i = 0; i < count; i++)
+        {
+            if (!sources[i].valid())
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << paths[i] << std::endl;
+            code[i] = sources[i].valid() ? sources[i].chars() : "";
+            length[i] = (GLint)sources[i].size();
+            if (sources[i].valid() && hasShaderIncludes(code[i], sources[i].size()))
+            {
+                std::vector<std::string> deps;
+                std::set<std::string> visited;
+                auto read = [](const std::string& path, std::string& contents) {
+                    AssetData data = FileSystem::read(path);
+                    contents = data.str();
+                    return data.valid();
+                };
+                expandShaderIncludes(paths[i], sources[i].str(), read, expanded[i], deps, visited);
+                code[i] = expanded[i].c_str();
+                length[i] = (GLint)expanded[i].size();
+            }
+        }
+    }
+    // ------------------------------------------------------------------------
+    unsigned int compileStage(GLenum type, const char* code, GLint length, const std::string& name)
+    {
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &code, &length);
+        glCompileShader(shader);
+        checkCompileErrors(shader, name);
+        return shader;
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,241 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/gl_backend.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// A piece of a StreamBuffer for this frame. buffer is the GL buffer it lives in, which changes when
+// the stream grows, so users bind or attach by it rather than by a name they kept.
+struct StreamAllocation {
+    GLuint buffer = 0;
+    size_t offset = 0;
+    size_t size = 0;
+    void *data = nullptr;
+};
+
+struct StreamBufferStats {
+    size_t bytes = 0;        // handed out this frame
+    unsigned int allocations = 0;
+    unsigned int waits = 0;  // frames whose region the GPU was still reading
+    double waitMs = 0.0;
+};
+
+// Ring buffer for data written by the CPU every frame (per draw constants, light lists, draw tables).
+// The buffer is split into FRAMES regions; a frame suballocates linearly from its region and fences it
+// at the end, and the region is only reused once that fence signals, so up to FRAMES frames are in
+// flight without the driver copying or orphaning anything.
+//   persistent: glBufferStorage mapped once, persistent and coherent; writes land in place
+//   fallback:   glBufferData storage, each allocation mapped with glMapBufferRange unsynchronized,
+//               the fences doing the synchronization the driver is told to skip
+// An allocation that does not fit grows the ring right away into a new buffer object. The old one is
+// kept for FRAMES more frames, as this frame's earlier allocations and the frames in flight use it.
+// Data read through texture buffers goes through allocateTexels() and attachTexture(). Where texture
+// buffer ranges exist the texture views just the allocation; otherwise it views the whole buffer, which
+// then has to stay within GL_MAX_TEXTURE_BUFFER_SIZE texels, so the ring is clamped to that at creation.
+class StreamBuffer
+{
+public:
+    static const unsigned int FRAMES = 3;
+
+    StreamBufferStats stats;
+
+    explicit StreamBuffer(size_t bytesPerFrame, bool allowPersistent = true)
+        : persistent(allowPersistent && GLCapabilities::get().bufferStorage)
+    {
+        size_t limit = wholeBufferTextureLimit();
+        if (limit && bytesPerFrame * FRAMES > limit) {
+            std::cout << "STREAM_BUFFER: clamped to " << limit / FRAMES << " bytes per frame, the texture buffer limit"
+                      << std::endl;
+            bytesPerFrame = limit / FRAMES;
+        }
+        create(bytesPerFrame);
+    }
+
+    ~StreamBuffer()
+    {
+        retire();
+        for (Retired &old : retired)
+            destroy(old);
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    bool isPersistent() const { return persistent; }
+    size_t capacity() const { return regionSize * FRAMES; }
+
+    // moves to the next region, waiting for the GPU to finish the frame that last used it
+    void beginFrame()
+    {
+        region = (region + 1) % FRAMES;
+        head = 0;
+        stats = StreamBufferStats();
+        for (size_t i = retired.size(); i-- > 0;) {
+            if (--retired[i].frames)
+                continue;
+            destroy(retired[i]);
+            retired.erase(retired.begin() + i);
+        }
+        GLsync &fence = fences[region];
+        if (!fence)
+            return;
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            auto start = std::chrono::steady_clock::now();
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                ;
+            stats.waits++;
+            stats.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    // after the last draw reading this frame's allocations
+    void endFrame()
+    {
+        if (fences[region])
+            glDeleteSync(fences[region]);
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // size bytes at an offset that is a multiple of alignment; write them, then commit before drawing
+    StreamAllocation allocate(size_t size, size_t alignment)
+    {
+        size_t offset = (head + alignment - 1) / alignment * alignment;
+        if (offset + size > regionSize) {
+            size_t grown = regionSize * 2;
+            while (grown < size + alignment)
+                grown *= 2;
+            size_t limit = wholeBufferTextureLimit();
+            if (limit && grown * FRAMES > limit && !exceededTextureLimit) {
+                std::cout << "ERROR::STREAM_BUFFER::EXCEEDS_TEXTURE_BUFFER_SIZE: " << grown * FRAMES << " bytes" << std::endl;
+                exceededTextureLimit = true;
+            }
+            retire();
+            create(grown);
+            offset = 0;
+        }
+        head = offset + size;
+        stats.bytes += size;
+        stats.allocations++;
+
+        StreamAllocation allocation;
+        allocation.buffer = buffer;
+        allocation.offset = region * regionSize + offset;
+        allocation.size = size;
+        if (persistent) {
+            allocation.data = mapped + allocation.offset;
+        } else {
+            allocation.data = GLBackend::mapBufferRange(buffer, allocation.offset, size,
+                                                        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        }
+        return allocation;
+    }
+
+    // allocate() for data read through a texture buffer whose texels are texelBytes
+    StreamAllocation allocateTexels(size_t size, size_t texelBytes)
+    {
+        const GLCapabilities &caps = GLCapabilities::get();
+        size_t alignment = texelBytes;
+        if (caps.textureBufferRange)
+            alignment = std::max(alignment, (size_t)caps.textureBufferOffsetAlignment);
+        return allocate(std::max(size, texelBytes), alignment);
+    }
+
+    // points texture at allocation (from allocateTexels) and returns the texel the allocation starts at.
+    // attached is the buffer texture last viewed whole, so the whole buffer view is only set up again
+    // after the stream grows.
+    static size_t attachTexture(GLuint texture, GLenum internalFormat, size_t texelBytes,
+                                const StreamAllocation &allocation, GLuint &attached)
+    {
+        if (GLCapabilities::get().textureBufferRange) {
+            GLBackend::textureBufferRange(texture, internalFormat, allocation.buffer, allocation.offset, allocation.size);
+            return 0;
+        }
+        if (attached != allocation.buffer) {
+            GLBackend::textureBuffer(texture, internalFormat, allocation.buffer);
+            attached = allocation.buffer;
+        }
+        return allocation.offset / texelBytes;
+    }
+
+    // makes the written bytes visible to the GPU; unmaps them on the fallback path
+    void commit(const StreamAllocation &allocation)
+    {
+        if (persistent)
+            return;
+        if (!GLBackend::unmapBuffer(allocation.buffer))
+            std::cout << "ERROR::STREAM_BUFFER::UNMAP_FAILED" << std::endl;
+    }
+
+private:
+    struct Retired {
+        GLuint buffer;
+        bool mapped;
+        unsigned int frames;
+    };
+
+    bool persistent;
+    GLuint buffer = 0;
+    char *mapped = nullptr;
+    size_t regionSize = 0;
+    unsigned int region = 0;
+    size_t head = 0;
+    GLsync fences[FRAMES] = {nullptr, nullptr, nullptr};
+    std::vector<Retired> retired;
+    bool exceededTextureLimit = false;
+
+    // bytes a whole buffer texture view can cover at 4 byte texels (R32UI), 0 when views are ranges
+    static size_t wholeBufferTextureLimit()
+    {
+        const GLCapabilities &caps = GLCapabilities::get();
+        return caps.textureBufferRange ? 0 : (size_t)caps.maxTextureBufferSize * 4;
+    }
+
+    void create(size_t bytesPerFrame)
+    {
+        regionSize = bytesPerFrame;
+        buffer = GLBackend::createBuffer();
+        if (persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            GLBackend::bufferStorage(buffer, capacity(), nullptr, flags);
+            mapped = (char*)GLBackend::mapBufferRange(buffer, 0, capacity(), flags);
+            if (!mapped)
+                std::cout << "ERROR::STREAM_BUFFER::MAP_FAILED" << std::endl;
+        } else {
+            GLBackend::bufferData(buffer, capacity(), nullptr, GL_STREAM_DRAW);
+        }
+    }
+
+    // the new buffer has nothing in flight, so the fences of the old one go with it
+    void retire()
+    {
+        if (!buffer)
+            return;
+        retired.push_back(Retired{buffer, mapped != nullptr, FRAMES});
+        buffer = 0;
+        mapped = nullptr;
+        for (GLsync &fence : fences) {
+            if (fence)
+                glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    static void destroy(const Retired &old)
+    {
+        if (old.mapped)
+            GLBackend::unmapBuffer(old.buffer);
+        glDeleteBuffers(1, &old.buffer);
+    }
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <learnopengl/job_system.h>
+
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+// The CPU stages of a frame and what each has to wait for. run() makes a job of every stage, so stages
+// without a path between them run at the same time on the job system; a stage can spread itself out
+// further with parallelFor. Stages only wait for ones added before them, which keeps the graph acyclic.
+class TaskGraph
+{
+public:
+    // returns the stage's handle for later stages' after lists
+    int add(const char *name, std::function<void()> fn, std::initializer_list<int> after = {})
+    {
+        tasks.push_back(Task{name, std::move(fn), std::vector<int>(after)});
+        return (int)tasks.size() - 1;
+    }
+
+    void clear() { tasks.clear(); }
+
+    // runs every stage and returns once all have finished; from a job system worker
+    void run(JobSystem &system)
+    {
+        Job *frame = system.create("task graph", [](unsigned int) {});
+        jobs.resize(tasks.size());
+        for (size_t i = 0; i < tasks.size(); i++) {
+            const Task *task = &tasks[i];
+            jobs[i] = system.createChild(frame, task->name, [task](unsigned int) { task->fn(); });
+            for (int before : task->after)
+                system.addDependency(jobs[before], jobs[i]);
+        }
+        for (Job *job : jobs)
+            system.submit(job);
+        system.submit(frame);
+        system.wait(frame);
+    }
+
+private:
+    struct Task {
+        const char *name;
+        std::function<void()> fn;
+        std::vector<int> after;
+    };
+
+    std::vector<Task> tasks;
+    std::vector<Job*> jobs;
+};
+
+#endif
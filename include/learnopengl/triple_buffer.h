@@ -0,0 +1,56 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Hands values from one producer thread to one consumer thread without locks. Of the three slots the
+// producer owns one (back), the consumer one (front), and the third is the last published value. Both
+// sides swap their slot with that one in a single atomic exchange, so neither ever waits on the other:
+// the producer can publish again before the consumer took the last value, which is then dropped, and the
+// consumer keeps its front until something newer is published.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // producer: fill back(), then publish() it; back() is a different slot afterwards, holding an older
+    // value that has to be overwritten
+    T& back() { return slots[backIndex]; }
+
+    void publish()
+    {
+        unsigned int previous = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+        backIndex = previous & INDEX;
+    }
+
+    // producer: whether the last published value has not been taken yet
+    bool pending() const { return (middle.load(std::memory_order_acquire) & FRESH) != 0; }
+
+    // consumer: makes the newest published value front(); false, with front() unchanged, if nothing was
+    // published since the last call
+    bool acquire()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        unsigned int previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & INDEX;
+        return true;
+    }
+
+    const T& front() const { return slots[frontIndex]; }
+
+private:
+    static const unsigned int INDEX = 3, FRESH = 4;
+
+    T slots[3];
+    // each side's slot index and the middle slot's index, FRESH while it holds a value the consumer has
+    // not seen, on cache lines of their own
+    alignas(64) unsigned int backIndex = 0;
+    alignas(64) unsigned int frontIndex = 1;
+    alignas(64) std::atomic<unsigned int> middle{2};
+};
+
+#endif
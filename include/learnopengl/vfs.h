@@ -0,0 +1,186 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/mapped_file.h>
+
+#include <sys/stat.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A source of assets mounted somewhere in the virtual tree. Paths passed in are normalized and
+// relative to the mount point.
+class VfsMount
+{
+public:
+    virtual ~VfsMount() {}
+    virtual bool exists(const std::string &path) const = 0;
+    virtual AssetData read(const std::string &path) const = 0;
+    // path on disk if the asset is a loose file, empty otherwise; used to batch directory reads
+    virtual std::string nativePath(const std::string &path) const { return std::string(); }
+};
+
+class DirectoryMount : public VfsMount
+{
+public:
+    explicit DirectoryMount(const std::string &root) : root(root) {}
+
+    bool exists(const std::string &path) const override
+    {
+        struct stat st;
+        return stat(nativePath(path).c_str(), &st) == 0 && S_ISREG(st.st_mode);
+    }
+
+    AssetData read(const std::string &path) const override
+    {
+        return readAsset(nativePath(path));
+    }
+
+    std::string nativePath(const std::string &path) const override
+    {
+        return root.empty() ? path : root + "/" + path;
+    }
+
+private:
+    std::string root;
+};
+
+class PackMount : public VfsMount
+{
+public:
+    bool open(const std::string &packPath) { return pack.open(packPath); }
+
+    bool exists(const std::string &path) const override { return pack.find(path) != nullptr; }
+    AssetData read(const std::string &path) const override { return pack.read(path); }
+
+private:
+    AssetPackReader pack;
+};
+
+// assets generated at runtime or embedded in the binary
+class MemoryMount : public VfsMount
+{
+public:
+    void add(const std::string &path, std::vector<unsigned char> data)
+    {
+        files[normalizeAssetPath(path)] = std::move(data);
+    }
+
+    bool exists(const std::string &path) const override { return files.count(path) != 0; }
+
+    AssetData read(const std::string &path) const override
+    {
+        auto it = files.find(path);
+        if (it == files.end())
+            return AssetData();
+        AssetIoStats::instance().record(path, 0.0, it->second.size(), 0, "memory");
+        return AssetData::fromView(it->second.data(), it->second.size());
+    }
+
+private:
+    std::unordered_map<std::string, std::vector<unsigned char>> files;
+};
+
+// Overlay of mounts. Lookups go from the most recently mounted source to the oldest, so a pack mounted
+// on top of the resource directory shadows the loose files it contains. Absolute paths bypass the VFS.
+class VirtualFileSystem
+{
+public:
+    void mount(const std::string &mountPoint, std::unique_ptr<VfsMount> source)
+    {
+        mounts.push_back(Mounted{normalizeAssetPath(mountPoint), std::move(source)});
+    }
+
+    void unmount(const std::string &mountPoint)
+    {
+        std::string point = normalizeAssetPath(mountPoint);
+        for (auto it = mounts.begin(); it != mounts.end(); ++it) {
+            if (it->point == point) {
+                mounts.erase(it);
+                return;
+            }
+        }
+    }
+
+    bool exists(const std::string &path) const
+    {
+        if (isAbsolute(path)) {
+            struct stat st;
+            return stat(path.c_str(), &st) == 0;
+        }
+        std::string relative;
+        return resolve(path, relative) != nullptr;
+    }
+
+    AssetData read(const std::string &path) const
+    {
+        if (isAbsolute(path))
+            return readAsset(path);
+        std::string relative;
+        const VfsMount *source = resolve(path, relative);
+        if (!source) {
+            std::cout << "ERROR::VFS::NOT_FOUND " << path << std::endl;
+            return AssetData();
+        }
+        return source->read(relative);
+    }
+
+    // packed assets are served straight from their mapping, loose files are read in one batch
+    std::vector<AssetData> readBatch(const std::vector<std::string> &paths) const
+    {
+        std::vector<AssetData> result(paths.size());
+        std::vector<std::string> loose;
+        std::vector<size_t> looseIndex;
+        for (size_t i = 0; i < paths.size(); i++) {
+            std::string relative;
+            const VfsMount *source = isAbsolute(paths[i]) ? nullptr : resolve(paths[i], relative);
+            std::string native = isAbsolute(paths[i]) ? paths[i] : source ? source->nativePath(relative) : std::string();
+            if (!native.empty()) {
+                loose.push_back(native);
+                looseIndex.push_back(i);
+            } else if (source) {
+                result[i] = source->read(relative);
+            } else {
+                std::cout << "ERROR::VFS::NOT_FOUND " << paths[i] << std::endl;
+            }
+        }
+        std::vector<AssetData> looseData = readAssetsBatched(loose);
+        for (size_t i = 0; i < looseData.size(); i++)
+            result[looseIndex[i]] = std::move(looseData[i]);
+        return result;
+    }
+
+private:
+    struct Mounted {
+        std::string point;
+        std::unique_ptr<VfsMount> source;
+    };
+    std::vector<Mounted> mounts;
+
+    static bool isAbsolute(const std::string &path) { return !path.empty() && path[0] == '/'; }
+
+    const VfsMount* resolve(const std::string &path, std::string &relative) const
+    {
+        std::string normalized = normalizeAssetPath(path);
+        for (auto it = mounts.rbegin(); it != mounts.rend(); ++it) {
+            const std::string &point = it->point;
+            if (!point.empty()) {
+                if (normalized.compare(0, point.size(), point) != 0
+                    || (normalized.size() > point.size() && normalized[point.size()] != '/'))
+                    continue;
+                relative = normalized.size() > point.size() ? normalized.substr(point.size() + 1) : std::string();
+            } else {
+                relative = normalized;
+            }
+            if (it->source->exists(relative))
+                return it->source.get();
+        }
+        return nullptr;
+    }
+};
+
+#endif
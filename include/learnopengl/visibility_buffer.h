@@ -0,0 +1,261 @@
+#ifndef VISIBILITY_BUFFER_H
+#define VISIBILITY_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/geometry_buffer.h>
+#include <learnopengl/frame_graph.h>
+#include <learnopengl/gpu_timer.h>
+#include <learnopengl/stream_buffer.h>
+#include <learnopengl/gl_backend.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+struct VisibilityStats {
+    unsigned int draws = 0;
+    unsigned int skipped = 0;   // packets (or parts of one) without a shared mesh or past MAX_DRAWS
+    unsigned int materials = 0; // resolve passes
+};
+
+// Visibility buffer rendering. The first pass draws the packets of one RenderQueue pass with a position
+// only shader that writes a single R32UI per pixel: (draw id + 1) << TRIANGLE_BITS | gl_PrimitiveID.
+// The resolve then runs one full-screen pass per material. Each pass skips the pixels of other
+// materials, and on its own pixels fetches the triangle from the GeometryBuffer by id. It rebuilds
+// perspective correct barycentrics (and their screen derivatives for texture filtering) and shades
+// the pixel once with the clustered lights. Depth is written next to the color, so forward passes can
+// follow. Per draw data is a texture buffer on the StreamBuffer, DRAW_TEXELS per draw from
+// drawTableBase: the model matrix, its normal matrix (3 texels), then firstIndex, baseVertex and material
+// slot as uint bits. That last texel is read through a second, RGBA32UI view of the same memory: as
+// floats the small integers would be denormals, which GLSL may flush to zero. The visibility pass
+// takes its model matrices from the queue's draw constants, and pulls the vertices of packets drawn
+// from the GeometryBuffer's pulling VAO with a shader of its own. The id and depth targets are frame graph
+// transients. A mesh of more than 1 << TRIANGLE_BITS triangles is drawn in parts of that many, each
+// with a draw id of its own.
+class VisibilityBuffer
+{
+public:
+    static const unsigned int TRIANGLE_BITS = 19;
+    static const unsigned int MAX_DRAWS = (1u << (32 - TRIANGLE_BITS)) - 1;
+    // indices of one draw; a packet with more is split, each part its own draw id
+    static const unsigned int PART_INDICES = 3u << TRIANGLE_BITS;
+    static const unsigned int BYTES_PER_PIXEL = 4 + 4;
+    static const unsigned int DRAW_TEXELS = 4 + 3 + 1;
+    // texture units of the resolve, above the material samplers and clear of ClusteredLighting
+    static const int TEXTURE_UNIT = 4;
+    static const int GEOMETRY_TEXTURE_UNIT = 11;
+
+    VisibilityStats stats;
+    GpuTimer visibilityTimer, resolveTimer;
+
+    VisibilityBuffer(const GeometryBuffer &geometry, StreamBuffer &stream)
+        : geometry(geometry), stream(stream),
+          visibilityShader("resources/shaders/visibility.vs", "resources/shaders/visibility.fs"),
+          pulledShader("resources/shaders/visibility_pulled.vs", "resources/shaders/visibility.fs"),
+          resolveShader("resources/shaders/deferred_lighting.vs", "resources/shaders/visibility_resolve.fs")
+    {
+        emptyVAO = GLBackend::createVertexArray();
+        drawTexture = GLBackend::createTexture(GL_TEXTURE_BUFFER);
+        drawRecordTexture = GLBackend::createTexture(GL_TEXTURE_BUFFER);
+        bindDrawConstantsBlock(visibilityShader);
+        bindDrawConstantsBlock(pulledShader);
+    }
+
+    ~VisibilityBuffer()
+    {
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteTextures(1, &drawTexture);
+        glDeleteTextures(1, &drawRecordTexture);
+        glDeleteProgram(visibilityShader.ID);
+        glDeleteProgram(pulledShader.ID);
+        glDeleteProgram(resolveShader.ID);
+    }
+
+    VisibilityBuffer(const VisibilityBuffer&) = delete;
+    VisibilityBuffer& operator=(const VisibilityBuffer&) = delete;
+
+    // the visibility pass over queue's packets of pass (their geometry needs a sharedMesh), and the
+    // resolve into color and depth. setLights sets the camera, dirLight and cluster uniforms, the same
+    // ones the forward shader takes.
+    void addPasses(FrameGraph &graph, const RenderQueue &queue, RenderPass pass, const glm::mat4 &projection,
+                   const glm::mat4 &view, int width, int height, FrameGraphHandle color, FrameGraphHandle depth,
+                   std::function<void(Shader&)> setLights)
+    {
+        this->width = width;
+        this->height = height;
+        FrameGraphHandle ids = graph.createTexture("visibility", TextureDesc(width, height, GL_R32UI));
+        FrameGraphHandle visibilityDepth = graph.createTexture("visibility depth", TextureDesc(width, height, GL_DEPTH24_STENCIL8));
+        graph.addPass("visibility", [&](FrameGraph::Builder &builder) {
+            builder.write(ids);
+            builder.write(visibilityDepth);
+        }, [this, &queue, pass, projection, view](const FrameGraph::Resources&) {
+            visibilityTimer.begin();
+            render(queue, pass, projection, view);
+            visibilityTimer.end();
+        });
+        graph.addPass("visibility resolve", [&](FrameGraph::Builder &builder) {
+            builder.read(ids);
+            builder.read(visibilityDepth);
+            builder.write(color);
+            builder.write(depth);
+        }, [this, ids, visibilityDepth, projection, view, setLights](const FrameGraph::Resources &resources) {
+            resolveTimer.begin();
+            resolve(resources.texture(ids), resources.texture(visibilityDepth), projection * view, setLights);
+            resolveTimer.end();
+        });
+    }
+
+    size_t memoryBytes() const { return (size_t)width * height * BYTES_PER_PIXEL; }
+
+private:
+    const GeometryBuffer &geometry;
+    StreamBuffer &stream;
+    Shader visibilityShader, pulledShader, resolveShader;
+    GLuint emptyVAO = 0;
+    GLuint drawTexture = 0, drawRecordTexture = 0; // the draw table as floats and as uints
+    GLuint drawAttached = 0, drawRecordAttached = 0; // stream buffer object each views whole
+    size_t drawBase = 0; // first texel of this frame's draw table
+    int width = 0, height = 0;
+    std::vector<glm::vec4> draws;
+    std::vector<const RenderMaterial*> materials;
+
+    // into the bound ids and depth targets
+    void render(const RenderQueue &queue, RenderPass pass, const glm::mat4 &projection, const glm::mat4 &view)
+    {
+        stats = VisibilityStats();
+        draws.clear();
+        materials.clear();
+
+        const GLuint empty[4] = {0, 0, 0, 0};
+        glClearBufferuiv(GL_COLOR, 0, empty);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        pulledShader.use();
+        geometry.bind(pulledShader, GEOMETRY_TEXTURE_UNIT);
+        for (Shader *shader : {&pulledShader, &visibilityShader}) {
+            shader->use();
+            shader->setMat4("projection", projection);
+            shader->setMat4("view", view);
+        }
+        Shader *shader = &visibilityShader;
+        unsigned int vao = 0;
+        std::pair<const RenderQueue::SortItem*, const RenderQueue::SortItem*> packets = queue.range(pass);
+        for (const RenderQueue::SortItem *item = packets.first; item != packets.second; item++) {
+            const DrawPacket &packet = *item->packet;
+            if (packet.geometry.sharedMesh < 0 || draws.size() / DRAW_TEXELS >= MAX_DRAWS) {
+                stats.skipped++;
+                continue;
+            }
+            if (packet.geometry.vao != vao) {
+                vao = packet.geometry.vao;
+                glBindVertexArray(vao);
+                Shader *wanted = vao == geometry.pullingVao() ? &pulledShader : &visibilityShader;
+                if (wanted != shader) {
+                    shader = wanted;
+                    shader->use();
+                }
+            }
+            queue.bindConstants(item);
+            unsigned int material = materialSlot(packet.material);
+            const RenderGeometry &g = packet.geometry;
+            if (packet.condition)
+                glBeginConditionalRender(packet.condition, GL_QUERY_NO_WAIT);
+            // gl_PrimitiveID has TRIANGLE_BITS, so denser meshes go as several draws of PART_INDICES
+            for (GLsizei part = 0; part < g.count; part += (GLsizei)PART_INDICES) {
+                if (draws.size() / DRAW_TEXELS >= MAX_DRAWS) {
+                    stats.skipped++;
+                    break;
+                }
+                unsigned int drawId = (unsigned int)(draws.size() / DRAW_TEXELS);
+                appendDraw(packet, material, (uint32_t)part);
+                shader->setInt("drawId", (int)drawId + 1);
+                GLsizei count = std::min(g.count - part, (GLsizei)PART_INDICES);
+                if (g.indexType)
+                    glDrawElementsBaseVertex(g.mode, count, g.indexType, (void*)(g.indexOffset + part * indexBytes(g.indexType)),
+                                             g.baseVertex);
+                else
+                    glDrawArrays(g.mode, g.first + part, count);
+                stats.draws++;
+            }
+            if (packet.condition)
+                glEndConditionalRender();
+        }
+        glBindVertexArray(0);
+
+        size_t bytes = draws.size() * sizeof(glm::vec4);
+        StreamAllocation allocation = stream.allocateTexels(bytes, sizeof(glm::vec4));
+        std::memcpy(allocation.data, draws.data(), bytes);
+        stream.commit(allocation);
+        drawBase = StreamBuffer::attachTexture(drawTexture, GL_RGBA32F, sizeof(glm::vec4), allocation, drawAttached);
+        StreamBuffer::attachTexture(drawRecordTexture, GL_RGBA32UI, sizeof(glm::vec4), allocation, drawRecordAttached);
+    }
+
+    // shades every covered pixel into the bound targets
+    void resolve(GLuint ids, GLuint depth, const glm::mat4 &viewProjection, const std::function<void(Shader&)> &setLights)
+    {
+        resolveShader.use();
+        setLights(resolveShader);
+        resolveShader.setMat4("viewProjection", viewProjection);
+        resolveShader.setVec2("screenSize", glm::vec2(width, height));
+        geometry.bind(resolveShader, GEOMETRY_TEXTURE_UNIT);
+        GLBackend::bindTexture(TEXTURE_UNIT, GL_TEXTURE_2D, ids);
+        resolveShader.setInt("visibility", TEXTURE_UNIT);
+        GLBackend::bindTexture(TEXTURE_UNIT + 1, GL_TEXTURE_2D, depth);
+        resolveShader.setInt("visibilityDepth", TEXTURE_UNIT + 1);
+        GLBackend::bindTexture(TEXTURE_UNIT + 2, GL_TEXTURE_BUFFER, drawTexture);
+        resolveShader.setInt("drawTable", TEXTURE_UNIT + 2);
+        GLBackend::bindTexture(TEXTURE_UNIT + 3, GL_TEXTURE_BUFFER, drawRecordTexture);
+        resolveShader.setInt("drawRecords", TEXTURE_UNIT + 3);
+        resolveShader.setInt("drawTableBase", (int)drawBase);
+
+        glDepthFunc(GL_ALWAYS);
+        glBindVertexArray(emptyVAO);
+        for (unsigned int slot = 0; slot < materials.size(); slot++) {
+            materials[slot]->apply(resolveShader);
+            resolveShader.setInt("materialSlot", (int)slot);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glBindVertexArray(0);
+        glDepthFunc(GL_LESS);
+        GLBackend::resetActiveTexture();
+        stats.materials = (unsigned int)materials.size();
+    }
+
+    unsigned int materialSlot(const RenderMaterial *material)
+    {
+        for (unsigned int i = 0; i < materials.size(); i++)
+            if (materials[i] == material)
+                return i;
+        materials.push_back(material);
+        return (unsigned int)materials.size() - 1;
+    }
+
+    static size_t indexBytes(GLenum type)
+    {
+        return type == GL_UNSIGNED_BYTE ? 1 : type == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+
+    // the draw of packet's indices from part on
+    void appendDraw(const DrawPacket &packet, unsigned int material, uint32_t part)
+    {
+        for (int column = 0; column < 4; column++)
+            draws.push_back(packet.model[column]);
+        NormalMatrix normal = affineNormalMatrix(packet.model);
+        draws.insert(draws.end(), normal.columns, normal.columns + 3);
+        const SharedMesh &mesh = geometry.mesh(packet.geometry.sharedMesh);
+        // arrays draws start at first, so their primitive ids are relative to it; pulled draws at their indexOffset
+        uint32_t firstIndex = mesh.firstIndex + (packet.geometry.indexType ? 0 : (uint32_t)packet.geometry.first);
+        if (packet.geometry.vao == geometry.pullingVao())
+            firstIndex = (uint32_t)(packet.geometry.indexOffset / sizeof(uint32_t));
+        uint32_t bits[4] = {firstIndex + part, mesh.baseVertex, material, 0};
+        glm::vec4 texel;
+        std::memcpy(&texel[0], bits, sizeof(bits));
+        draws.push_back(texel);
+    }
+};
+
+#endif
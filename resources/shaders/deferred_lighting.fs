@@ -0,0 +1,149 @@
+#version 330 core
+out vec4 FragColor;
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// what the G-buffer holds for one pixel
+struct Surface {
+    vec3 albedo;
+    float specular;
+    float shininess;
+};
+
+in vec2 TexCoords;
+
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+
+uniform vec3 viewPos;
+uniform mat4 view;
+uniform DirLight dirLight;
+
+// clustered point lights, see ClusteredLighting
+uniform samplerBuffer lightData;
+uniform usamplerBuffer lightGrid;
+uniform usamplerBuffer lightIndices;
+// where this frame's light lists start in the stream buffer, in texels
+uniform int lightDataBase;
+uniform int lightGridBase;
+uniform int lightIndexBase;
+uniform vec2 clusterTileSize;
+uniform vec3 clusterCount;
+uniform float clusterScale;
+uniform float clusterBias;
+
+// function prototypes
+vec3 OctahedronDecode(vec2 e);
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 normal, vec3 viewDir);
+vec3 CalcPointLight(PointLight light, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir);
+PointLight FetchPointLight(int index);
+
+void main()
+{
+    // nothing was drawn here: keep the clear color
+    float depth = texture(gDepth, TexCoords).r;
+    if (depth == 1.0)
+        discard;
+    gl_FragDepth = depth;
+
+    // properties
+    vec4 position = inverseViewProjection * vec4(vec3(TexCoords, depth) * 2.0 - 1.0, 1.0);
+    vec3 fragPos = position.xyz / position.w;
+    vec3 norm = OctahedronDecode(texture(gNormal, TexCoords).rg);
+    vec2 specular = texture(gSpecular, TexCoords).rg;
+    Surface surface = Surface(texture(gAlbedo, TexCoords).rgb, specular.r, exp2(specular.g * 8.0));
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    // phase 1: directional lighting
+    vec3 result = CalcDirLight(dirLight, surface, norm, viewDir);
+    // phase 2: the point lights of this pixel's cluster
+    float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+    ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy / clusterTileSize),
+                          int(log(viewDepth) * clusterScale - clusterBias));
+    cluster = clamp(cluster, ivec3(0), ivec3(clusterCount) - 1);
+    int clusterIndex = (cluster.z * int(clusterCount.y) + cluster.y) * int(clusterCount.x) + cluster.x;
+    uvec2 range = texelFetch(lightGrid, lightGridBase + clusterIndex).xy;
+    for (uint i = 0u; i < range.y; i++)
+        result += CalcPointLight(FetchPointLight(int(texelFetch(lightIndices, lightIndexBase + int(range.x + i)).x)), surface, norm, fragPos, viewDir);
+
+    FragColor = vec4(result, 1.0);
+}
+
+vec3 OctahedronDecode(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+PointLight FetchPointLight(int index)
+{
+    int texel = lightDataBase + index * 4;
+    vec4 positionRadius = texelFetch(lightData, texel);
+    vec4 ambientConstant = texelFetch(lightData, texel + 1);
+    vec4 diffuseLinear = texelFetch(lightData, texel + 2);
+    vec4 specularQuadratic = texelFetch(lightData, texel + 3);
+    return PointLight(positionRadius.xyz, ambientConstant.w, diffuseLinear.w, specularQuadratic.w,
+                      ambientConstant.rgb, diffuseLinear.rgb, specularQuadratic.rgb);
+}
+
+// calculates the color when using a directional light.
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 normal, vec3 viewDir)
+{
+    vec3 lightDir = normalize(-light.direction);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess);
+    // combine results
+    vec3 ambient = light.ambient * surface.albedo;
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
+    return (ambient + diffuse + specular);
+}
+
+// calculates the color when using a point light.
+vec3 CalcPointLight(PointLight light, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess);
+    // attenuation
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // combine results
+    vec3 ambient = light.ambient * surface.albedo;
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
+    ambient *= attenuation;
+    diffuse *= attenuation;
+    specular *= attenuation;
+    return (ambient + diffuse + specular);
+}
@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+// the same math as pyramid.vs, so the main pass can test against this depth with GL_LEQUAL
+invariant gl_Position;
+
+#include "draw_constants.glsl"
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    vec3 fragPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(fragPos, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+// depth_prepass.vs with the position pulled from the GeometryBuffer
+#include "vertex_pulling.glsl"
+
+// the same math as pyramid_pulled.vs, so the main pass can test against this depth with GL_LEQUAL
+invariant gl_Position;
+
+#include "draw_constants.glsl"
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    vec3 fragPos = vec3(model * vec4(PullVertex().position, 1.0));
+    gl_Position = projection * view * vec4(fragPos, 1.0);
+}
\ No newline at end of file
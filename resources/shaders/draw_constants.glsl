@@ -0,0 +1,5 @@
+// per draw constants, written by RenderQueue into a stream buffer and bound per draw
+layout (std140) uniform DrawConstants {
+    mat4 model;
+    mat3 normalMatrix; // transpose(inverse(mat3(model))), computed on the CPU
+};
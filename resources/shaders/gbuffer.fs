@@ -0,0 +1,33 @@
+#version 330 core
+// G-buffer layout, see DeferredRenderer
+layout (location = 0) out vec2 gNormal;   // RG16, octahedral
+layout (location = 1) out vec4 gAlbedo;   // RGBA8
+layout (location = 2) out vec2 gSpecular; // RG8, specular intensity and log2(shininess) / 8
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform Material material;
+
+// maps the unit sphere onto the [-1, 1] square: the upper half directly, the lower half folded over the diagonals
+vec2 OctahedronEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return e * 0.5 + 0.5;
+}
+
+void main()
+{
+    gNormal = OctahedronEncode(normalize(Normal));
+    gAlbedo = vec4(texture(material.diffuse, TexCoords).rgb, 1.0);
+    vec3 specular = texture(material.specular, TexCoords).rgb;
+    gSpecular = vec2(dot(specular, vec3(0.2126, 0.7152, 0.0722)), log2(material.shininess) / 8.0);
+}
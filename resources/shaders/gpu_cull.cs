@@ -0,0 +1,49 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+struct Instance {
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 bounds; // world space sphere: xyz center, w radius
+    vec4 params;
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout (std430, binding = 1) buffer Commands { DrawCommand commands[]; };
+layout (std430, binding = 2) writeonly buffer Visible { uint visible[]; };
+
+uniform vec4 frustumPlanes[6];
+uniform vec3 cameraPos;
+uniform uint instanceCount;
+uniform uint lodCount;
+uniform float lodDistance[4]; // upper bound of each level, the last one is the draw distance
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= instanceCount)
+        return;
+
+    vec4 bounds = instances[id].bounds;
+    for (int i = 0; i < 6; i++)
+        if (dot(frustumPlanes[i].xyz, bounds.xyz) + frustumPlanes[i].w < -bounds.w)
+            return;
+
+    float distance = length(bounds.xyz - cameraPos) - bounds.w;
+    uint lod = 0u;
+    while (lod < lodCount && distance > lodDistance[lod])
+        lod++;
+    if (lod == lodCount)
+        return;
+
+    uint slot = atomicAdd(commands[lod].instanceCount, 1u);
+    visible[commands[lod].baseInstance + slot] = id;
+}
@@ -1,7 +1,7 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
+#include "draw_constants.glsl"
 uniform mat4 view;
 uniform mat4 projection;
 
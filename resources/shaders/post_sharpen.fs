@@ -0,0 +1,19 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D image;
+
+// unsharp mask: push each pixel away from the mean of its 4 neighbours
+const float amount = 0.6;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 last = textureSize(image, 0) - 1;
+    vec3 center = texelFetch(image, pixel, 0).rgb;
+    vec3 neighbours = texelFetch(image, clamp(pixel + ivec2(1, 0), ivec2(0), last), 0).rgb
+                    + texelFetch(image, clamp(pixel - ivec2(1, 0), ivec2(0), last), 0).rgb
+                    + texelFetch(image, clamp(pixel + ivec2(0, 1), ivec2(0), last), 0).rgb
+                    + texelFetch(image, clamp(pixel - ivec2(0, 1), ivec2(0), last), 0).rgb;
+    FragColor = vec4(clamp(center + amount * (center - neighbours * 0.25), 0.0, 1.0), 1.0);
+}
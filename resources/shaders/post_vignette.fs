@@ -0,0 +1,13 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image;
+
+void main()
+{
+    vec2 fromCenter = TexCoords * 2.0 - 1.0;
+    float falloff = 1.0 - 0.4 * dot(fromCenter, fromCenter);
+    FragColor = vec4(texelFetch(image, ivec2(gl_FragCoord.xy), 0).rgb * falloff, 1.0);
+}
@@ -0,0 +1,9 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D image;
+
+void main()
+{
+    FragColor = texelFetch(image, ivec2(gl_FragCoord.xy), 0);
+}
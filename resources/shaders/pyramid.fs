@@ -33,13 +33,27 @@ in vec3 Normal;
 in vec2 TexCoords;
 
 uniform vec3 viewPos;
+uniform mat4 view;
 uniform DirLight dirLight;
-uniform PointLight pointLight;
 uniform Material material;
 
+// clustered point lights, see ClusteredLighting
+uniform samplerBuffer lightData;
+uniform usamplerBuffer lightGrid;
+uniform usamplerBuffer lightIndices;
+// where this frame's light lists start in the stream buffer, in texels
+uniform int lightDataBase;
+uniform int lightGridBase;
+uniform int lightIndexBase;
+uniform vec2 clusterTileSize;
+uniform vec3 clusterCount;
+uniform float clusterScale;
+uniform float clusterBias;
+
 // function prototypes
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+PointLight FetchPointLight(int index);
 
 void main()
 {
@@ -49,12 +63,30 @@ void main()
 
     // phase 1: directional lighting
     vec3 result = CalcDirLight(dirLight, norm, viewDir);
-    // phase 2: point light
-    result += CalcPointLight(pointLight, norm, FragPos, viewDir);
+    // phase 2: the point lights of this fragment's cluster
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+    ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy / clusterTileSize),
+                          int(log(depth) * clusterScale - clusterBias));
+    cluster = clamp(cluster, ivec3(0), ivec3(clusterCount) - 1);
+    int clusterIndex = (cluster.z * int(clusterCount.y) + cluster.y) * int(clusterCount.x) + cluster.x;
+    uvec2 range = texelFetch(lightGrid, lightGridBase + clusterIndex).xy;
+    for (uint i = 0u; i < range.y; i++)
+        result += CalcPointLight(FetchPointLight(int(texelFetch(lightIndices, lightIndexBase + int(range.x + i)).x)), norm, FragPos, viewDir);
 
     FragColor = vec4(result, 1.0);
 }
 
+PointLight FetchPointLight(int index)
+{
+    int texel = lightDataBase + index * 4;
+    vec4 positionRadius = texelFetch(lightData, texel);
+    vec4 ambientConstant = texelFetch(lightData, texel + 1);
+    vec4 diffuseLinear = texelFetch(lightData, texel + 2);
+    vec4 specularQuadratic = texelFetch(lightData, texel + 3);
+    return PointLight(positionRadius.xyz, ambientConstant.w, diffuseLinear.w, specularQuadratic.w,
+                      ambientConstant.rgb, diffuseLinear.rgb, specularQuadratic.rgb);
+}
+
 // calculates the color when using a directional light.
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
 {
@@ -0,0 +1,43 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in uint aInstance; // written by gpu_cull.cs, one per instance
+
+struct Instance {
+    mat4 model;
+    mat3 normalMatrix;
+    vec4 bounds;
+    vec4 params; // x: spin phase
+};
+
+layout (std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+
+// depth prepasses run the same math, see depth_prepass.vs
+invariant gl_Position;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float time;
+
+void main()
+{
+    Instance instance = instances[aInstance];
+    float angle = time + instance.params.x;
+    mat4 spin = mat4(cos(angle), 0.0, -sin(angle), 0.0,
+                     0.0, 1.0, 0.0, 0.0,
+                     sin(angle), 0.0, cos(angle), 0.0,
+                     0.0, 0.0, 0.0, 1.0);
+    mat4 model = instance.model * spin;
+
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    // spin is a rotation, its own normal matrix
+    Normal = instance.normalMatrix * mat3(spin) * aNormal;
+    TexCoords = aTexCoords;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+// pyramid.vs with the attributes pulled from the GeometryBuffer
+#include "vertex_pulling.glsl"
+
+// depth prepasses run the same math, see depth_prepass_pulled.vs
+invariant gl_Position;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+#include "draw_constants.glsl"
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    PulledVertex vertex = PullVertex();
+    FragPos = vec3(model * vec4(vertex.position, 1.0));
+    Normal = normalMatrix * vertex.normal;
+    TexCoords = vertex.texCoords;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
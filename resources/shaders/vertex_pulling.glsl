@@ -0,0 +1,16 @@
+// Programmable vertex pulling, see GeometryBuffer: the draw indexes GeometryBuffer's indices from an
+// attribute-less VAO with the mesh's base vertex, so gl_VertexID is the vertex in geometryVertices.
+uniform samplerBuffer geometryVertices;
+
+struct PulledVertex {
+    vec3 position;
+    vec3 normal;
+    vec2 texCoords;
+};
+
+PulledVertex PullVertex()
+{
+    vec4 a = texelFetch(geometryVertices, gl_VertexID * 2);
+    vec4 b = texelFetch(geometryVertices, gl_VertexID * 2 + 1);
+    return PulledVertex(a.xyz, vec3(a.w, b.xy), b.zw);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+// see VisibilityBuffer: draw id + 1 in the top bits, the triangle in the low TRIANGLE_BITS
+out uint visibility;
+
+uniform int drawId;
+
+void main()
+{
+    visibility = (uint(drawId) << 19u) | uint(gl_PrimitiveID);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+// visibility.vs with the position pulled from the GeometryBuffer
+#include "vertex_pulling.glsl"
+
+#include "draw_constants.glsl"
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(PullVertex().position, 1.0);
+}
\ No newline at end of file
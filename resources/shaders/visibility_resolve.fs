@@ -0,0 +1,199 @@
+#version 330 core
+out vec4 FragColor;
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// what the material gives one pixel
+struct Surface {
+    vec3 albedo;
+    vec3 specular;
+};
+
+in vec2 TexCoords;
+
+// see VisibilityBuffer and GeometryBuffer
+uniform usampler2D visibility;
+uniform sampler2D visibilityDepth;
+uniform samplerBuffer drawTable;
+uniform usamplerBuffer drawRecords; // the same texels as uints, for the integer last texel of a draw
+uniform int drawTableBase;
+uniform samplerBuffer geometryVertices;
+uniform usamplerBuffer geometryIndices;
+uniform int materialSlot;
+uniform mat4 viewProjection;
+uniform vec2 screenSize;
+
+uniform vec3 viewPos;
+uniform mat4 view;
+uniform DirLight dirLight;
+uniform Material material;
+
+// clustered point lights, see ClusteredLighting
+uniform samplerBuffer lightData;
+uniform usamplerBuffer lightGrid;
+uniform usamplerBuffer lightIndices;
+// where this frame's light lists start in the stream buffer, in texels
+uniform int lightDataBase;
+uniform int lightGridBase;
+uniform int lightIndexBase;
+uniform vec2 clusterTileSize;
+uniform vec3 clusterCount;
+uniform float clusterScale;
+uniform float clusterBias;
+
+const uint TRIANGLE_BITS = 19u;
+
+// function prototypes
+vec3 Barycentrics(vec4 c0, vec4 c1, vec4 c2, vec2 pixel);
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 normal, vec3 viewDir);
+vec3 CalcPointLight(PointLight light, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir);
+PointLight FetchPointLight(int index);
+
+void main()
+{
+    uint id = texelFetch(visibility, ivec2(gl_FragCoord.xy), 0).r;
+    if (id == 0u)
+        discard;
+    int draw = int(id >> TRIANGLE_BITS) - 1;
+    int triangle = int(id & ((1u << TRIANGLE_BITS) - 1u));
+    int drawTexel = drawTableBase + draw * 8;
+    uvec4 record = texelFetch(drawRecords, drawTexel + 7);
+    // one pass per material, the other materials' pixels are somebody else's
+    if (int(record.z) != materialSlot)
+        discard;
+    gl_FragDepth = texelFetch(visibilityDepth, ivec2(gl_FragCoord.xy), 0).r;
+
+    // the triangle, in world and clip space
+    mat4 model = mat4(texelFetch(drawTable, drawTexel), texelFetch(drawTable, drawTexel + 1),
+                      texelFetch(drawTable, drawTexel + 2), texelFetch(drawTable, drawTexel + 3));
+    vec3 position[3];
+    vec3 normal[3];
+    vec2 uv[3];
+    vec4 clip[3];
+    for (int k = 0; k < 3; k++)
+    {
+        int vertex = int(texelFetch(geometryIndices, int(record.x) + triangle * 3 + k).r + record.y);
+        vec4 a = texelFetch(geometryVertices, vertex * 2);
+        vec4 b = texelFetch(geometryVertices, vertex * 2 + 1);
+        position[k] = vec3(model * vec4(a.xyz, 1.0));
+        normal[k] = vec3(a.w, b.xy);
+        uv[k] = b.zw;
+        clip[k] = viewProjection * vec4(position[k], 1.0);
+    }
+
+    // barycentrics at this pixel and its neighbours, for the position and the texture gradients
+    vec3 b = Barycentrics(clip[0], clip[1], clip[2], gl_FragCoord.xy);
+    vec3 bx = Barycentrics(clip[0], clip[1], clip[2], gl_FragCoord.xy + vec2(1.0, 0.0));
+    vec3 by = Barycentrics(clip[0], clip[1], clip[2], gl_FragCoord.xy + vec2(0.0, 1.0));
+    vec2 texCoords = b.x * uv[0] + b.y * uv[1] + b.z * uv[2];
+    vec2 dx = bx.x * uv[0] + bx.y * uv[1] + bx.z * uv[2] - texCoords;
+    vec2 dy = by.x * uv[0] + by.y * uv[1] + by.z * uv[2] - texCoords;
+    vec3 fragPos = b.x * position[0] + b.y * position[1] + b.z * position[2];
+    mat3 normalMatrix = mat3(texelFetch(drawTable, drawTexel + 4).xyz, texelFetch(drawTable, drawTexel + 5).xyz,
+                             texelFetch(drawTable, drawTexel + 6).xyz);
+    vec3 norm = normalize(normalMatrix * (b.x * normal[0] + b.y * normal[1] + b.z * normal[2]));
+    Surface surface = Surface(textureGrad(material.diffuse, texCoords, dx, dy).rgb,
+                              textureGrad(material.specular, texCoords, dx, dy).rgb);
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    // phase 1: directional lighting
+    vec3 result = CalcDirLight(dirLight, surface, norm, viewDir);
+    // phase 2: the point lights of this pixel's cluster
+    float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+    ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy / clusterTileSize),
+                          int(log(viewDepth) * clusterScale - clusterBias));
+    cluster = clamp(cluster, ivec3(0), ivec3(clusterCount) - 1);
+    int clusterIndex = (cluster.z * int(clusterCount.y) + cluster.y) * int(clusterCount.x) + cluster.x;
+    uvec2 range = texelFetch(lightGrid, lightGridBase + clusterIndex).xy;
+    for (uint i = 0u; i < range.y; i++)
+        result += CalcPointLight(FetchPointLight(int(texelFetch(lightIndices, lightIndexBase + int(range.x + i)).x)), surface, norm, fragPos, viewDir);
+
+    FragColor = vec4(result, 1.0);
+}
+
+// perspective correct barycentrics of a window position inside the triangle c0 c1 c2 (clip space)
+vec3 Barycentrics(vec4 c0, vec4 c1, vec4 c2, vec2 pixel)
+{
+    vec3 invW = 1.0 / vec3(c0.w, c1.w, c2.w);
+    vec2 p0 = c0.xy * invW.x, p1 = c1.xy * invW.y, p2 = c2.xy * invW.z;
+    vec2 p = pixel / screenSize * 2.0 - 1.0;
+    vec2 e1 = p1 - p0, e2 = p2 - p0, e = p - p0;
+    float area = e1.x * e2.y - e1.y * e2.x;
+    float b1 = (e.x * e2.y - e.y * e2.x) / area;
+    float b2 = (e1.x * e.y - e1.y * e.x) / area;
+    vec3 screen = vec3(1.0 - b1 - b2, b1, b2) * invW;
+    return screen / (screen.x + screen.y + screen.z);
+}
+
+PointLight FetchPointLight(int index)
+{
+    int texel = lightDataBase + index * 4;
+    vec4 positionRadius = texelFetch(lightData, texel);
+    vec4 ambientConstant = texelFetch(lightData, texel + 1);
+    vec4 diffuseLinear = texelFetch(lightData, texel + 2);
+    vec4 specularQuadratic = texelFetch(lightData, texel + 3);
+    return PointLight(positionRadius.xyz, ambientConstant.w, diffuseLinear.w, specularQuadratic.w,
+                      ambientConstant.rgb, diffuseLinear.rgb, specularQuadratic.rgb);
+}
+
+// calculates the color when using a directional light.
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 normal, vec3 viewDir)
+{
+    vec3 lightDir = normalize(-light.direction);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // combine results
+    vec3 ambient = light.ambient * surface.albedo;
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
+    return (ambient + diffuse + specular);
+}
+
+// calculates the color when using a point light.
+vec3 CalcPointLight(PointLight light, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // attenuation
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // combine results
+    vec3 ambient = light.ambient * surface.albedo;
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
+    ambient *= attenuation;
+    diffuse *= attenuation;
+    specular *= attenuation;
+    return (ambient + diffuse + specular);
+}
@@ -10,38 +10,162 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
-
+#include <learnopengl/cooked_texture.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/command_recorder.h>
+#include <learnopengl/frustum.h>
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/gl_backend.h>
+#include <learnopengl/gpu_driven.h>
+#include <learnopengl/occlusion_culling.h>
+#include <learnopengl/occlusion_queries.h>
+#include <learnopengl/clustered_lighting.h>
+#include <learnopengl/deferred_renderer.h>
+#include <learnopengl/gpu_timer.h>
+#include <learnopengl/geometry_buffer.h>
+#include <learnopengl/visibility_buffer.h>
+#include <learnopengl/depth_prepass.h>
+#include <learnopengl/frame_graph.h>
+#include <learnopengl/stream_buffer.h>
+#include <learnopengl/job_system.h>
+#include <learnopengl/task_graph.h>
+#include <learnopengl/scene_systems.h>
+#include <learnopengl/scene_graph.h>
+#include <learnopengl/triple_buffer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow *window);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void processInput(GLFWwindow *window, float deltaTime);
 unsigned int loadTexture(const char *path);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// a stress scene on top of the pyramid, plane and Anubis: a field of small spinning pyramids around the plane,
+// PYRAMID_FIELD_SIZE^2 grid cells, with its own point lights. Off by default, F toggles
+bool pyramidFieldEnabled = false;
+const unsigned int PYRAMID_FIELD_SIZE = 64;
+const float PYRAMID_FIELD_SPACING = 1.5f;
+// beyond this distance the field pyramids drop their base, which cannot be seen from above anyway
+const float PYRAMID_LOD_DISTANCE = 25.0f;
+
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
-// timing
-float deltaTime = 0.0f;
-float lastFrame = 0.0f;
-
-// lighting
-glm::vec3 lightPos(1.2f, 2.0f, 2.0f);
+// timing: the simulation advances in fixed steps of 1 / SIMULATION_RATES[simulationRateSetting] seconds
+// however fast frames are drawn, T cycles the rate
+const unsigned int SIMULATION_RATES[] = {20, 30, 60, 120, 240};
+unsigned int simulationRateSetting = 2;
+// a longer frame is simulated as if it took this long, so that one hitch does not snowball into more steps
+const double MAX_FRAME_TIME = 0.25;
+
+// J writes the job system's trace of the next frame to job_trace.json, for chrome://tracing; counts presses
+unsigned int jobTraceRequests = 0;
+
+// coloured point lights scattered over the field on top of the two scene lights, while the field is shown;
+// L cycles the count
+const unsigned int FIELD_LIGHT_COUNTS[] = {0, 1, 4, 16, 64, 256, 1024};
+unsigned int fieldLightSetting = 4;
+
+// the pyramid field is culled and drawn on the GPU when the context supports it, G toggles
+bool gpuDrivenEnabled = false;
+// CPU occlusion culling against the pyramid and the plane, O toggles
+bool occlusionCullingEnabled = true;
+// GPU occlusion queries with conditional rendering for Anubis, Q toggles
+bool occlusionQueriesEnabled = true;
+// how lit surfaces are shaded, M cycles
+enum ShadingPath {
+    SHADING_FORWARD,
+    SHADING_DEFERRED,
+    SHADING_VISIBILITY,
+    SHADING_PATH_COUNT
+};
+const char *SHADING_PATH_NAMES[SHADING_PATH_COUNT] = {"forward", "deferred", "visibility buffer"};
+ShadingPath shadingPath = SHADING_FORWARD;
+// sharpen and vignette after the scene, P toggles
+bool postEffectsEnabled = false;
+// lit surfaces fetch their vertices from the shared geometry buffer instead of their VAOs, V toggles
+bool vertexPullingEnabled = false;
+// object classes, the tag of their draw packets; forward shading can lay down the depth of each class in a
+// prepass first, 1-4 cycle pyramid, plane, Anubis and field through auto, on and off
+enum ObjectClass {
+    OBJECT_OTHER,
+    OBJECT_PYRAMID,
+    OBJECT_PLANE,
+    OBJECT_ANUBIS,
+    OBJECT_FIELD,
+    OBJECT_CLASS_COUNT
+};
+const char *OBJECT_CLASS_NAMES[OBJECT_CLASS_COUNT] = {"other", "pyramid", "plane", "anubis", "field"};
+DepthPrepassMode prepassModes[OBJECT_CLASS_COUNT] = {DEPTH_PREPASS_OFF, DEPTH_PREPASS_AUTO, DEPTH_PREPASS_AUTO,
+                                                     DEPTH_PREPASS_AUTO, DEPTH_PREPASS_AUTO};
+
+// what the fixed steps advance. A frame shows the blend of the last two states, how far between them
+// being the part of a step the frame's time has already run into
+struct SimulationState {
+    double time = 0.0;
+    Camera camera;
+    // lighting, the light orbits at 3 units
+    glm::vec3 lightPos = glm::vec3(3.0f, 2.0f, 0.0f);
+
+    static SimulationState blend(const SimulationState &previous, const SimulationState &current, float alpha)
+    {
+        SimulationState state;
+        state.time = previous.time + (current.time - previous.time) * alpha;
+        state.camera = Camera(glm::mix(previous.camera.Position, current.camera.Position, alpha), current.camera.WorldUp,
+                              glm::mix(previous.camera.Yaw, current.camera.Yaw, alpha),
+                              glm::mix(previous.camera.Pitch, current.camera.Pitch, alpha));
+        state.camera.Zoom = glm::mix(previous.camera.Zoom, current.camera.Zoom, alpha);
+        state.lightPos = glm::mix(previous.lightPos, current.lightPos, alpha);
+        return state;
+    }
+};
+
+void simulate(SimulationState &state, GLFWwindow *window, float step);
+
+// one frame as the render thread draws it: the camera, the lights, the transforms of the scene
+// objects and the settings. The main thread fills one per tick and publishes it; the render thread only
+// ever reads its copy, so neither touches the other's state
+struct RenderSnapshot {
+    float time = 0.0f;
+    glm::mat4 projection, view;
+    glm::vec3 cameraPos;
+    float fovy = 0.0f;
+    int width = 0, height = 0;
+    std::vector<PointLight> lights;
+    glm::mat4 pyramidModel, lightCubeModel, anubisModel;
+    ShadingPath shadingPath = SHADING_FORWARD;
+    bool pyramidField = false, gpuDriven = false;
+    bool occlusionCulling = false, occlusionQueries = false, postEffects = false, vertexPulling = false;
+    DepthPrepassMode prepassModes[OBJECT_CLASS_COUNT];
+    unsigned int jobTraceRequests = 0;
+};
+
+void renderLoop(GLFWwindow *window, TripleBuffer<RenderSnapshot> &snapshots, const std::atomic<bool> &quit,
+                std::promise<void> &ready);
 
 int main()
 {
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -49,19 +173,25 @@ int main()
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // glfw window creation
-    // --------------------
+    // glfw window creation, a 4.3 context if there is one, otherwise 3.3 core
+    // -------------------------------------------------------------------------
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
     if (window == NULL)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    }
+    if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetKeyCallback(window, key_callback);
 
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -73,6 +203,167 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    GLCapabilities::load((GLADloadproc)glfwGetProcAddress);
+    const GLCapabilities &caps = GLCapabilities::get();
+    gpuDrivenEnabled = caps.gpuDriven;
+    GLBackend::select(caps.directStateAccess);
+    std::cout << "OpenGL " << caps.major << "." << caps.minor << " (" << caps.renderer << "), "
+              << (caps.gpuDriven ? "GPU driven field" : "CPU recorded field, GL 3.3 fallback") << ", "
+              << GLBackend::name() << std::endl;
+
+    // point lights: the orbiting orange light, a red one next to Anubis, then the field lights
+    std::vector<PointLight> sceneLights(2);
+    sceneLights[0].ambient = glm::vec3(0.1f, 0.06f, 0.0f);
+    sceneLights[0].diffuse = sceneLights[0].specular = glm::vec3(1.0f, 0.6f, 0.0f);
+    sceneLights[1].position = glm::vec3(2.5f, 3.0f, -2.5f);
+    sceneLights[1].ambient = glm::vec3(0.0f);
+    sceneLights[1].diffuse = glm::vec3(1.0f, 0.0f, 0.0f);
+    sceneLights[1].specular = glm::vec3(1.0f, 0.0f, 1.0f);
+    sceneLights[1].linear = 0.35f;
+    sceneLights[1].quadratic = 0.44f;
+    std::vector<PointLight> fieldLights(FIELD_LIGHT_COUNTS[sizeof(FIELD_LIGHT_COUNTS) / sizeof(FIELD_LIGHT_COUNTS[0]) - 1]);
+    std::mt19937 random(1);
+    const float fieldExtent = PYRAMID_FIELD_SIZE * PYRAMID_FIELD_SPACING / 2.0f;
+    std::uniform_real_distribution<float> fieldArea(-fieldExtent, fieldExtent), unit(0.0f, 1.0f);
+    for (PointLight &light : fieldLights)
+    {
+        light.position = glm::vec3(fieldArea(random), unit(random) * 6.2831853f, fieldArea(random));
+        light.ambient = glm::vec3(0.0f);
+        light.diffuse = light.specular = glm::vec3(unit(random), unit(random), unit(random)) * 2.5f;
+        light.linear = 1.0f;
+        light.quadratic = 6.0f;
+    }
+
+    // the render thread owns the context from here on and draws the snapshots this thread publishes, one
+    // tick behind: the next tick is simulated while the last one is drawn
+    // -----------------------------------------------------------------------------------------------
+    glfwMakeContextCurrent(NULL);
+    TripleBuffer<RenderSnapshot> snapshots;
+    std::atomic<bool> quit(false);
+    std::promise<void> rendererReady;
+    std::thread renderThread(renderLoop, window, std::ref(snapshots), std::cref(quit), std::ref(rendererReady));
+    rendererReady.get_future().wait();
+
+    // where the scene objects are placed; their world transforms are kept between frames and only the
+    // light cube, which moves, is recomputed
+    SceneGraph sceneObjects;
+    // pyramid
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::scale(model, glm::vec3(2.0f));
+    model = glm::translate(model,glm::vec3(0.0f,0.25f,0.0f));
+    int pyramidNode = sceneObjects.add(SceneGraph::NO_PARENT, model, "pyramid");
+    // lightCube, placed every frame
+    int lightCubeNode = sceneObjects.add(SceneGraph::NO_PARENT, glm::mat4(1.0f), "lightCube");
+    //anubis
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(4.0f, 2.25f, -4.0f));
+    model = glm::scale(model, glm::vec3(0.3));
+    model = glm::rotate(model,glm::radians(-45.0f),glm::vec3(0.0f,1.0f,0.0f));
+    int anubisNode = sceneObjects.add(SceneGraph::NO_PARENT, model, "anubis");
+
+    // main loop
+    // ---------
+    SimulationState previous, current;
+    current.camera = camera;
+    previous = current;
+    double accumulator = 0.0, lastFrame = glfwGetTime();
+    while (!glfwWindowShouldClose(window))
+    {
+        // per-frame time logic: the frame's time is simulated in whole steps, what is left of it carries over
+        // ----------------------------------------------------------------------------------------------------
+        double currentFrame = glfwGetTime();
+        accumulator += std::min(currentFrame - lastFrame, MAX_FRAME_TIME);
+        lastFrame = currentFrame;
+
+        // simulation
+        // ----------
+        double step = 1.0 / SIMULATION_RATES[simulationRateSetting];
+        while (accumulator >= step)
+        {
+            previous = current;
+            simulate(current, window, (float)step);
+            accumulator -= step;
+        }
+        SimulationState state = SimulationState::blend(previous, current, (float)(accumulator / step));
+
+        // the frame for the render thread
+        // -------------------------------
+        RenderSnapshot &snapshot = snapshots.back();
+        snapshot.time = (float)state.time;
+        snapshot.projection = glm::perspective(glm::radians(state.camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        snapshot.view = state.camera.GetViewMatrix();
+        snapshot.cameraPos = state.camera.Position;
+        snapshot.fovy = glm::radians(state.camera.Zoom);
+        glfwGetFramebufferSize(window, &snapshot.width, &snapshot.height);
+
+        // field lights bob above the pyramids, their y holds the phase
+        snapshot.lights.assign(sceneLights.begin(), sceneLights.end());
+        snapshot.lights[0].position = state.lightPos;
+        unsigned int fieldLightCount = pyramidFieldEnabled ? FIELD_LIGHT_COUNTS[fieldLightSetting] : 0;
+        for (unsigned int i = 0; i < fieldLightCount; i++)
+        {
+            snapshot.lights.push_back(fieldLights[i]);
+            snapshot.lights.back().position.y = 0.6f + 0.3f * std::sin(snapshot.time + fieldLights[i].position.y);
+        }
+
+        // lightCube
+        model = glm::mat4(1.0f);
+        model = glm::translate(model, state.lightPos);
+        model = glm::scale(model, glm::vec3(0.2f)); // a smaller cube
+        sceneObjects.setLocal(lightCubeNode, model);
+        sceneObjects.update();
+        snapshot.pyramidModel = sceneObjects.world(pyramidNode);
+        snapshot.lightCubeModel = sceneObjects.world(lightCubeNode);
+        snapshot.anubisModel = sceneObjects.world(anubisNode);
+
+        snapshot.shadingPath = shadingPath;
+        snapshot.pyramidField = pyramidFieldEnabled;
+        snapshot.gpuDriven = gpuDrivenEnabled;
+        snapshot.occlusionCulling = occlusionCullingEnabled;
+        snapshot.occlusionQueries = occlusionQueriesEnabled;
+        snapshot.postEffects = postEffectsEnabled;
+        snapshot.vertexPulling = vertexPullingEnabled;
+        std::copy(prepassModes, prepassModes + OBJECT_CLASS_COUNT, snapshot.prepassModes);
+        snapshot.jobTraceRequests = jobTraceRequests;
+
+        // no further ahead than one tick: the last one has to be taken before this one replaces it
+        while (snapshots.pending())
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        snapshots.publish();
+
+        // glfw: poll IO events (keys pressed/released, mouse moved etc.)
+        // ---------------------------------------------------------------
+        glfwPollEvents();
+    }
+
+    quit = true;
+    renderThread.join();
+
+    // glfw: terminate, clearing all previously allocated GLFW resources.
+    // ------------------------------------------------------------------
+    glfwTerminate();
+    return 0;
+}
+
+// one fixed step of the simulation: camera movement from the keys held, the light's orbit
+// ---------------------------------------------------------------------------------------
+void simulate(SimulationState &state, GLFWwindow *window, float step)
+{
+    processInput(window, step);
+    state.time += step;
+    state.camera = camera;
+    state.lightPos.x = 3.0f * cos(state.time);
+    state.lightPos.z = 3.0f * sin(state.time);
+}
+
+// the render thread: creates every GL object, then draws each published snapshot once until the
+// simulation stops; ready is set once the scene is loaded
+// ---------------------------------------------------------------------------------------------
+void renderLoop(GLFWwindow *window, TripleBuffer<RenderSnapshot> &snapshots, const std::atomic<bool> &quit,
+                std::promise<void> &ready)
+{
+    glfwMakeContextCurrent(window);
+    const GLCapabilities &caps = GLCapabilities::get();
 
     // configure global opengl state
     // -----------------------------
@@ -82,7 +373,27 @@ int main()
     // ------------------------------------
     Shader pyramidShader("resources/shaders/pyramid.vs", "resources/shaders/pyramid.fs");
     Shader lightCubeShader("resources/shaders/light_cube.vs", "resources/shaders/light_cube.fs");
-
+    Shader gbufferShader("resources/shaders/pyramid.vs", "resources/shaders/gbuffer.fs");
+    Shader depthPrepassShader("resources/shaders/depth_prepass.vs", "resources/shaders/depth_prepass.fs");
+    Shader pyramidPulledShader("resources/shaders/pyramid_pulled.vs", "resources/shaders/pyramid.fs");
+    Shader gbufferPulledShader("resources/shaders/pyramid_pulled.vs", "resources/shaders/gbuffer.fs");
+    Shader depthPrepassPulledShader("resources/shaders/depth_prepass_pulled.vs", "resources/shaders/depth_prepass.fs");
+    Shader sharpenShader("resources/shaders/deferred_lighting.vs", "resources/shaders/post_sharpen.fs");
+    Shader vignetteShader("resources/shaders/deferred_lighting.vs", "resources/shaders/post_vignette.fs");
+    Shader presentShader("resources/shaders/deferred_lighting.vs", "resources/shaders/present.fs");
+
+    // the positions of interleaved scene vertices packed into a buffer of their own, behind a VAO for
+    // depth only passes: 12 bytes fetched per vertex instead of the whole 32 byte stride
+    auto positionStream = [](const float *data, size_t vertexCount, size_t stride, unsigned int &vbo) {
+        std::vector<float> positions(vertexCount * 3);
+        for (size_t i = 0; i < vertexCount; i++)
+            std::copy(data + i * stride, data + i * stride + 3, positions.begin() + i * 3);
+        unsigned int vao = GLBackend::createVertexArray();
+        vbo = GLBackend::createBuffer();
+        GLBackend::bufferData(vbo, positions.size() * sizeof(float), positions.data(), GL_STATIC_DRAW);
+        GLBackend::vertexAttribute(vao, 0, 3, GL_FLOAT, vbo, 3 * sizeof(float), 0);
+        return vao;
+    };
 
     // pyramid vertices
     float vertices[] = {
@@ -113,20 +424,23 @@ int main()
     };
 
     //configure the pyramid's VAO and VBO
-    unsigned int pyramidVBO, pyramidVAO;
-    glGenVertexArrays(1, &pyramidVAO);
-    glGenBuffers(1, &pyramidVBO);
+    unsigned int pyramidVBO = GLBackend::createBuffer(), pyramidVAO = GLBackend::createVertexArray();
+    GLBackend::bufferData(pyramidVBO, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    GLBackend::vertexAttribute(pyramidVAO, 0, 3, GL_FLOAT, pyramidVBO, 8 * sizeof(float), 0);
+    GLBackend::vertexAttribute(pyramidVAO, 1, 3, GL_FLOAT, pyramidVBO, 8 * sizeof(float), 3 * sizeof(float));
+    GLBackend::vertexAttribute(pyramidVAO, 2, 2, GL_FLOAT, pyramidVBO, 8 * sizeof(float), 6 * sizeof(float));
 
-    glBindBuffer(GL_ARRAY_BUFFER, pyramidVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // indexed copy for the GPU driven path: the full pyramid, and the first 12 indices (the sides) as the far lod
+    unsigned int pyramidEBO;
+    std::vector<unsigned int> pyramidIndices(sizeof(vertices) / (8 * sizeof(float)));
+    for (unsigned int i = 0; i < pyramidIndices.size(); i++)
+        pyramidIndices[i] = i;
+    pyramidEBO = GLBackend::createBuffer();
+    GLBackend::bufferData(pyramidEBO, pyramidIndices.size() * sizeof(unsigned int), pyramidIndices.data(), GL_STATIC_DRAW);
 
-    glBindVertexArray(pyramidVAO);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    unsigned int pyramidPositionVBO;
+    unsigned int pyramidDepthVAO = positionStream(vertices, sizeof(vertices) / (8 * sizeof(float)), 8, pyramidPositionVBO);
 
 
     // configure the lightCube's VAO,VBO and EBO
@@ -164,22 +478,14 @@ int main()
             6, 7, 3
     };
 
-    unsigned int lightCubeVAO, lightCubeVBO, lightCubeEBO;
-    glGenVertexArrays(1, &lightCubeVAO);
-    glGenBuffers(1, &lightCubeVBO);
-    glGenBuffers(1, &lightCubeEBO);
-    glBindVertexArray(lightCubeVAO);
+    unsigned int lightCubeVAO = GLBackend::createVertexArray();
+    unsigned int lightCubeVBO = GLBackend::createBuffer(), lightCubeEBO = GLBackend::createBuffer();
 
-    glBindBuffer(GL_ARRAY_BUFFER, lightCubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(lightCube_vertices), lightCube_vertices, GL_STATIC_DRAW);
+    GLBackend::bufferData(lightCubeVBO, sizeof(lightCube_vertices), lightCube_vertices, GL_STATIC_DRAW);
+    GLBackend::bufferData(lightCubeEBO, sizeof(lightCube_indices), lightCube_indices, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lightCubeEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(lightCube_indices), lightCube_indices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glBindVertexArray(0);
+    GLBackend::vertexAttribute(lightCubeVAO, 0, 3, GL_FLOAT, lightCubeVBO, 3 * sizeof(float), 0);
+    GLBackend::elementBuffer(lightCubeVAO, lightCubeEBO);
 
     // plane
     float planeVertices[] = {
@@ -193,153 +499,606 @@ int main()
             5.0f, -0.5f, -5.0f,     0.0f, 1.0f, 0.0f,   2.0f, 2.0f
     };
 
-    unsigned int planeVAO, planeVBO;
-    glGenVertexArrays(1, &planeVAO);
-    glGenBuffers(1, &planeVBO);
-    glBindVertexArray(planeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glBindVertexArray(0);
+    unsigned int planeVAO = GLBackend::createVertexArray(), planeVBO = GLBackend::createBuffer();
+    GLBackend::bufferData(planeVBO, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
+    GLBackend::vertexAttribute(planeVAO, 0, 3, GL_FLOAT, planeVBO, 8 * sizeof(float), 0);
+    GLBackend::vertexAttribute(planeVAO, 1, 3, GL_FLOAT, planeVBO, 8 * sizeof(float), 3 * sizeof(float));
+    GLBackend::vertexAttribute(planeVAO, 2, 2, GL_FLOAT, planeVBO, 8 * sizeof(float), 6 * sizeof(float));
+
+    unsigned int planePositionVBO;
+    unsigned int planeDepthVAO = positionStream(planeVertices, 6, 8, planePositionVBO);
 
     // load textures
-    unsigned int floorTexture = loadTexture(FileSystem::getPath("resources/textures/sand.jpg").c_str());
-    unsigned int diffuseMap = loadTexture(FileSystem::getPath("resources/textures/brickwall.jpg").c_str());
-    unsigned int specularMap = loadTexture(FileSystem::getPath("resources/textures/brickwall.jpg").c_str());
+    unsigned int floorTexture = loadTexture("resources/textures/sand.jpg");
+    unsigned int diffuseMap = loadTexture("resources/textures/brickwall.jpg");
+    unsigned int specularMap = loadTexture("resources/textures/brickwall.jpg");
+
+    Model anubis("resources/objects/anubis/Anubis_baseMesh.OBJ", false, MODEL_LOADER_NATIVE_OBJ, VERTEX_STORAGE_SPLIT);
+
+    AssetIoStats::instance().report(std::cout);
+
+    // render queue programs and materials
+    // -----------------------------------
+    // the camera of the snapshot being drawn
+    glm::mat4 projection, view;
+    glm::vec3 viewPos;
+    // everything written per frame (draw constants, light lists, the visibility draw table) streams through one ring
+    StreamBuffer streamBuffer(2 * 1024 * 1024);
+    ClusteredLighting clusteredLighting(streamBuffer);
+
+    RenderProgram litProgram;
+    litProgram.id = 1;
+    litProgram.shader = &pyramidShader;
+    litProgram.perFrame = [&](Shader &shader) {
+        shader.setVec3("viewPos", viewPos);
+
+        shader.setVec3("dirLight.direction", -0.2f, 2.0f, -0.3f);
+        shader.setVec3("dirLight.ambient", 0.3f, 0.24f, 0.14f);
+        shader.setVec3("dirLight.diffuse", 0.7f, 0.42f, 0.26f);
+        shader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
+        // point lights
+        clusteredLighting.bind(shader);
+
+        shader.setMat4("projection", projection);
+        shader.setMat4("view", view);
+    };
+
+    // the same surfaces written to the G-buffer instead of lit, for the deferred path
+    RenderProgram gbufferProgram;
+    gbufferProgram.id = 3;
+    gbufferProgram.shader = &gbufferShader;
+    gbufferProgram.perFrame = [&](Shader &shader) {
+        shader.setMat4("projection", projection);
+        shader.setMat4("view", view);
+    };
+
+    // depth only, for the prepass
+    RenderProgram depthProgram;
+    depthProgram.id = 4;
+    depthProgram.shader = &depthPrepassShader;
+    depthProgram.perFrame = gbufferProgram.perFrame;
+
+    RenderProgram lightCubeProgram;
+    lightCubeProgram.id = 2;
+    lightCubeProgram.shader = &lightCubeShader;
+    lightCubeProgram.perFrame = [&](Shader &shader) {
+        shader.setMat4("projection", projection);
+        shader.setMat4("view", view);
+    };
 
-    // shader configuration
-    // --------------------
-    pyramidShader.use();
-    pyramidShader.setInt("material.diffuse", 1);
-    pyramidShader.setInt("material.specular", 1);
+    uint16_t nextMaterialId = 1;
+    std::vector<RenderMaterial> materials;
+    materials.reserve(2 + anubis.meshes.size());
+    auto litMaterial = [&](unsigned int diffuse, unsigned int specular) {
+        RenderMaterial material;
+        material.id = nextMaterialId++;
+        material.samplers = {{"material.diffuse", diffuse}, {"material.specular", specular}};
+        material.floats = {{"material.shininess", 64.0f}};
+        materials.push_back(material);
+        return &materials.back();
+    };
+    const RenderMaterial *brickMaterial = litMaterial(diffuseMap, specularMap);
+    const RenderMaterial *sandMaterial = litMaterial(floorTexture, floorTexture);
+    std::vector<const RenderMaterial*> anubisMaterials;
+    for (const Mesh &mesh : anubis.meshes)
+    {
+        unsigned int diffuse = floorTexture, specular = 0;
+        for (const Texture &texture : mesh.textures)
+        {
+            if (texture.type == "texture_diffuse")
+                diffuse = texture.id;
+            else if (texture.type == "texture_specular")
+                specular = texture.id;
+        }
+        anubisMaterials.push_back(litMaterial(diffuse, specular ? specular : diffuse));
+    }
+    RenderMaterial lightCubeMaterial;
+    lightCubeMaterial.id = nextMaterialId++;
+    RenderMaterial depthMaterial;
+    depthMaterial.id = nextMaterialId++;
+
+    RenderGeometry pyramidGeometry = RenderGeometry::arrays(pyramidVAO, 0, sizeof(vertices) / (8 * sizeof(float)));
+    RenderGeometry pyramidSidesGeometry = RenderGeometry::arrays(pyramidVAO, 0, 12);
+    RenderGeometry planeGeometry = RenderGeometry::arrays(planeVAO, 0, 6);
+    pyramidGeometry.depthVao = pyramidSidesGeometry.depthVao = pyramidDepthVAO;
+    planeGeometry.depthVao = planeDepthVAO;
+    RenderGeometry lightCubeGeometry = RenderGeometry::elements(lightCubeVAO, 36, GL_UNSIGNED_INT);
+    std::vector<RenderGeometry> anubisGeometries;
+    for (const Mesh &mesh : anubis.meshes)
+        anubisGeometries.push_back(RenderGeometry::fromMesh(mesh));
+
+    // every lit mesh once more in the shared geometry buffer, for the visibility buffer resolve
+    GeometryBuffer sharedGeometry;
+    pyramidGeometry.sharedMesh = pyramidSidesGeometry.sharedMesh =
+            sharedGeometry.add(vertices, pyramidIndices.size(), 8, pyramidIndices.data(), pyramidIndices.size());
+    const unsigned int planeIndices[] = {0, 1, 2, 3, 4, 5};
+    planeGeometry.sharedMesh = sharedGeometry.add(planeVertices, 6, 8, planeIndices, 6);
+    for (unsigned int i = 0; i < anubis.meshes.size(); i++)
+        anubisGeometries[i].sharedMesh = sharedGeometry.add(anubis.meshes[i]);
+    sharedGeometry.upload();
+
+    // ... which also draws them by vertex pulling, all from one attribute-less VAO
+    RenderGeometry pyramidPulledGeometry = sharedGeometry.pulled(pyramidGeometry);
+    RenderGeometry pyramidSidesPulledGeometry = sharedGeometry.pulled(pyramidSidesGeometry);
+    RenderGeometry planePulledGeometry = sharedGeometry.pulled(planeGeometry);
+    std::vector<RenderGeometry> anubisPulledGeometries;
+    for (const RenderGeometry &geometry : anubisGeometries)
+        anubisPulledGeometries.push_back(geometry.sharedMesh < 0 ? geometry : sharedGeometry.pulled(geometry));
+    // the lit, G-buffer and depth programs once more with the pulling vertex shaders
+    auto pulledProgram = [&](const RenderProgram &program, uint16_t id, Shader &shader) {
+        RenderProgram pulled = program;
+        pulled.id = id;
+        pulled.shader = &shader;
+        pulled.perFrame = [&program, &sharedGeometry](Shader &shader) {
+            program.perFrame(shader);
+            sharedGeometry.bind(shader, VisibilityBuffer::GEOMETRY_TEXTURE_UNIT);
+        };
+        return pulled;
+    };
+    RenderProgram litPulledProgram = pulledProgram(litProgram, 5, pyramidPulledShader);
+    RenderProgram gbufferPulledProgram = pulledProgram(gbufferProgram, 6, gbufferPulledShader);
+    RenderProgram depthPulledProgram = pulledProgram(depthProgram, 7, depthPrepassPulledShader);
+
+    std::vector<glm::vec3> fieldPositions;
+    for (unsigned int x = 0; x < PYRAMID_FIELD_SIZE; x++)
+        for (unsigned int z = 0; z < PYRAMID_FIELD_SIZE; z++)
+        {
+            glm::vec3 position((x - PYRAMID_FIELD_SIZE / 2.0f) * PYRAMID_FIELD_SPACING, -0.25f,
+                               (z - PYRAMID_FIELD_SIZE / 2.0f) * PYRAMID_FIELD_SPACING);
+            if (std::abs(position.x) > 6.0f || std::abs(position.z) > 6.0f)
+                fieldPositions.push_back(position);
+        }
+
+    std::unique_ptr<GpuDrivenRenderer> gpuField;
+    std::unique_ptr<Shader> pyramidIndirectShader, pyramidIndirectGBufferShader, pyramidIndirectDepthShader;
+    if (caps.gpuDriven)
+    {
+        gpuField.reset(new GpuDrivenRenderer());
+        pyramidIndirectShader.reset(new Shader("resources/shaders/pyramid_indirect.vs", "resources/shaders/pyramid.fs"));
+        pyramidIndirectGBufferShader.reset(new Shader("resources/shaders/pyramid_indirect.vs", "resources/shaders/gbuffer.fs"));
+        pyramidIndirectDepthShader.reset(new Shader("resources/shaders/pyramid_indirect.vs", "resources/shaders/depth_prepass.fs"));
+        gpuField->setGeometry(pyramidVBO, pyramidEBO, {
+                {(GLuint)pyramidIndices.size(), 0, 0, PYRAMID_LOD_DISTANCE},
+                {12, 0, 0, 100.0f}});
+        std::vector<GpuInstance> instances(fieldPositions.size());
+        for (size_t i = 0; i < fieldPositions.size(); i++)
+        {
+            instances[i].model = glm::scale(glm::translate(glm::mat4(1.0f), fieldPositions[i]), glm::vec3(0.5f));
+            instances[i].normalMatrix = affineNormalMatrix(instances[i].model);
+            instances[i].bounds = glm::vec4(fieldPositions[i], 0.45f);
+            instances[i].params = glm::vec4(i * 0.1f, 0.0f, 0.0f, 0.0f);
+        }
+        gpuField->setInstances(instances);
+    }
 
-    Model anubis(FileSystem::getPath("resources/objects/anubis/Anubis_baseMesh.OBJ"));
+    // occluders and the local bounds of the occludees; Anubis' meshes are placed by their nodes
+    OcclusionMesh pyramidOccluder = OcclusionMesh::fromVertices(vertices, sizeof(vertices) / (8 * sizeof(float)), 8);
+    OcclusionMesh planeOccluder = OcclusionMesh::fromVertices(planeVertices, 6, 8);
+    std::vector<BoundingBox> anubisBounds(anubis.meshes.size());
+    for (unsigned int i = 0; i < anubis.meshes.size(); i++)
+    {
+        BoundingBox meshBounds;
+        for (const Vertex &vertex : anubis.meshes[i].vertices)
+            meshBounds.expand(vertex.Position);
+        anubisBounds[i] = meshBounds.transformed(anubis.nodes.world(anubis.meshNodes[i]));
+    }
+    BoundingBox anubisModelBounds;
+    for (const BoundingBox &bounds : anubisBounds)
+    {
+        anubisModelBounds.expand(bounds.min);
+        anubisModelBounds.expand(bounds.max);
+    }
+    BoundingBox unitCube;
+    unitCube.min = glm::vec3(-0.5f);
+    unitCube.max = glm::vec3(0.5f);
+
+    RenderQueue renderQueue(streamBuffer);
+    JobSystem jobs;
+    TaskGraph taskGraph;
+    CommandRecorder recorder(jobs);
+    SoftwareOcclusion occlusion(jobs);
+    // the pyramid field as entities, transformed, culled, LOD'd and recorded by the scene systems
+    World scene;
+    for (size_t i = 0; i < fieldPositions.size(); i++)
+    {
+        Transform transform;
+        transform.position = fieldPositions[i];
+        transform.scale = 0.5f;
+        transform.yaw = i * 0.1f;
+        transform.spin = 1.0f;
+        MeshRenderer mesh;
+        mesh.geometry = &pyramidGeometry;
+        mesh.pulled = &pyramidPulledGeometry;
+        mesh.farGeometry = &pyramidSidesGeometry;
+        mesh.farPulled = &pyramidSidesPulledGeometry;
+        mesh.material = brickMaterial;
+        mesh.objectClass = OBJECT_FIELD;
+        Bounds bounds;
+        bounds.center = fieldPositions[i];
+        bounds.radius = 0.45f;
+        scene.create(transform, mesh, bounds);
+    }
+    std::vector<Chunk*> sceneChunks;
+    unsigned int jobTracesWritten = 0;
+    OcclusionQueries occlusionQueries;
+    DeferredRenderer deferredRenderer;
+    VisibilityBuffer visibilityBuffer(sharedGeometry, streamBuffer);
+    GpuTimer forwardTimer;
+    FrameGraph frameGraph;
+    // post effects and the copy to the window: a full-screen triangle reading one texture into another target
+    unsigned int fullScreenVAO = GLBackend::createVertexArray();
+    auto addFullScreenPass = [&](const char *name, Shader &shader, FrameGraphHandle input, FrameGraphHandle output) {
+        frameGraph.addPass(name, [&](FrameGraph::Builder &builder) {
+            builder.read(input);
+            builder.write(output);
+        }, [&shader, input, fullScreenVAO](const FrameGraph::Resources &resources) {
+            shader.use();
+            GLBackend::bindTexture(0, GL_TEXTURE_2D, resources.texture(input));
+            shader.setInt("image", 0);
+            glDisable(GL_DEPTH_TEST);
+            glBindVertexArray(fullScreenVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glBindVertexArray(0);
+            glEnable(GL_DEPTH_TEST);
+        });
+    };
+    DepthPrepass depthPrepass;
+    for (int i = 0; i < OBJECT_CLASS_COUNT; i++)
+        depthPrepass.addClass(OBJECT_CLASS_NAMES[i], prepassModes[i]);
+    const unsigned int ANUBIS_QUERY = 1;
+    std::cout << "Recording " << fieldPositions.size() << " field objects on " << recorder.threadCount() << " threads" << std::endl;
+    float statsTime = 0.0f, tasksTime = 0.0f, submitTime = 0.0f;
+    unsigned int statsFrames = 0;
 
 
+    ready.set_value();
+    int viewportWidth = 0, viewportHeight = 0;
+
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window))
+    for (;;)
     {
-        // per-frame time logic
-        // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        // input
-        // -----
-        processInput(window);
+        // the newest snapshot; once the simulation has stopped, the last one still gets drawn
+        bool quitting = quit;
+        if (!snapshots.acquire())
+        {
+            if (quitting)
+                break;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        const RenderSnapshot &frame = snapshots.front();
+        float currentFrame = frame.time;
 
         // render
         // ------
+        // make sure the viewport matches the window; width and height will be significantly larger than
+        // specified on retina displays
+        int width = frame.width, height = frame.height;
+        if (width != viewportWidth || height != viewportHeight)
+        {
+            glViewport(0, 0, width, height);
+            viewportWidth = width;
+            viewportHeight = height;
+        }
         //glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClearColor(0.75f, 0.52f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-
-        pyramidShader.use();
-        pyramidShader.setVec3("light.position", glm::vec3(1.2f, 2.0f, 2.0f));
-        pyramidShader.setVec3("viewPos", camera.Position);
-
-
-        pyramidShader.setVec3("dirLight.direction", -0.2f, 2.0f, -0.3f);
-        pyramidShader.setVec3("dirLight.ambient", 0.3f, 0.24f, 0.14f);
-        pyramidShader.setVec3("dirLight.diffuse", 0.7f, 0.42f, 0.26f);
-        pyramidShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-        // point light 1
-        pyramidShader.setVec3("pointLight.position", lightPos);
-        pyramidShader.setVec3("pointLight.ambient", 1.0 * 0.1,  0.6 * 0.1,  0.0* 0.1);
-        pyramidShader.setVec3("pointLight.diffuse", glm::vec3(1.0f, 0.6f, 0.0f));
-        pyramidShader.setVec3("pointLight.specular",  glm::vec3(1.0f, 0.6f, 0.0f));
-        pyramidShader.setFloat("pointLight.constant", 1.0f);
-        pyramidShader.setFloat("pointLight.linear", 0.09);
-        pyramidShader.setFloat("pointLight.quadratic", 0.032);
-
-
-        // light properties
-        pyramidShader.setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
-        pyramidShader.setVec3("light.diffuse", 0.5f, 0.5f, 0.5f);
-        pyramidShader.setVec3("light.specular", 1.0f, 0.85f, 0.0f);
-
-        // material properties
-        pyramidShader.setFloat("material.shininess", 64.0f);
-
-
-        lightPos.x = 3.0f * cos(glfwGetTime());
-        lightPos.z = 3.0f * sin(glfwGetTime());
 
         // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        pyramidShader.setMat4("projection", projection);
-        pyramidShader.setMat4("view", view);
-
-        // world transformation
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::scale(model, glm::vec3(2.0f));
-        model = glm::translate(model,glm::vec3(0.0f,0.25f,0.0f));
-        pyramidShader.setMat4("model", model);
-
-        // bind diffuse map
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap);
-        // bind specular map
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, specularMap);
-        // render the pyramid
-        glBindVertexArray(pyramidVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-
-        // draw the lightCube
-        lightCubeShader.use();
-        lightCubeShader.setMat4("projection", projection);
-        lightCubeShader.setMat4("view", view);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, lightPos);
-        model = glm::scale(model, glm::vec3(0.2f)); // a smaller cube
-        lightCubeShader.setMat4("model", model);
-        glBindVertexArray(lightCubeVAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-        // draw plane
-        pyramidShader.use();
-        glBindVertexArray(planeVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, floorTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, floorTexture);
-        model = glm::mat4(1.0f);
-        pyramidShader.setMat4("model", model);
-        pyramidShader.setMat4("view",view);
-        pyramidShader.setMat4("projection",projection);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-
-        //anubis
-
-        pyramidShader.setVec3("pointLight.ambient", 1.0 * 0.1,  0.6 * 0.1,  0.0* 0.1);
-        pyramidShader.setVec3("pointLight.diffuse", glm::vec3(1.0f, 0.0f, 0.0f));
-        pyramidShader.setVec3("pointLight.specular",  glm::vec3(1.0f, 0.0f, 1.0f));
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(4.0f, 2.25f, -4.0f));
-        model = glm::scale(model, glm::vec3(0.3));
-        model = glm::rotate(model,glm::radians(-45.0f),glm::vec3(0.0f,1.0f,0.0f));
-        pyramidShader.setMat4("model", model);
-        anubis.Draw(pyramidShader);
-
-
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
+        projection = frame.projection;
+        view = frame.view;
+        viewPos = frame.cameraPos;
+        renderQueue.begin(view);
+        streamBuffer.beginFrame();
+        GLBackend::stats() = GLBackendStats();
+        jobs.beginFrame();
+
+        // lit surfaces either go through the forward shader, into the G-buffer or into the visibility buffer
+        bool deferred = frame.shadingPath == SHADING_DEFERRED, visibility = frame.shadingPath == SHADING_VISIBILITY;
+        const RenderProgram &surfaceProgram = deferred ? gbufferProgram : litProgram;
+        const RenderProgram &surfacePulledProgram = deferred ? gbufferPulledProgram : litPulledProgram;
+        RenderPass surfacePass = frame.shadingPath == SHADING_FORWARD ? RENDER_PASS_OPAQUE : RENDER_PASS_DEFERRED;
+        for (int i = 0; i < OBJECT_CLASS_COUNT; i++)
+            if (depthPrepass.mode(i) != frame.prepassModes[i])
+                depthPrepass.setMode(i, frame.prepassModes[i]);
+        depthPrepass.beginFrame();
+        auto prepassed = [&](ObjectClass objectClass) {
+            return frame.shadingPath == SHADING_FORWARD && depthPrepass.enabled(objectClass);
+        };
+        // a lit surface, after its depth only copy if its class has the prepass; target is the queue or a command list.
+        // pulled is the same geometry drawn by vertex pulling, used when that is on.
+        auto submitSurface = [&](auto &target, ObjectClass objectClass, const RenderMaterial &material,
+                                 const RenderGeometry &geometry, const RenderGeometry &pulled, const glm::mat4 &model,
+                                 GLuint condition) {
+            bool pulling = frame.vertexPulling && pulled.vao == sharedGeometry.pullingVao();
+            if (prepassed(objectClass))
+                target.submit(RENDER_PASS_DEPTH_PREPASS, pulling ? depthPulledProgram : depthProgram, depthMaterial,
+                              pulling ? pulled : geometry.depthOnly(), model, condition, objectClass);
+            target.submit(surfacePass, pulling ? surfacePulledProgram : surfaceProgram, material, pulling ? pulled : geometry,
+                          model, condition, objectClass);
+        };
+
+        // Anubis is drawn on last frame's query result, which is GL, so the condition is picked up here
+        GLuint anubisCondition = 0;
+        if (frame.occlusionQueries && !anubis.meshes.empty())
+            anubisCondition = occlusionQueries.condition(ANUBIS_QUERY, anubisModelBounds.transformed(frame.anubisModel),
+                                                         frame.cameraPos);
+        auto occluded = [&](const BoundingBox &worldBounds) {
+            return frame.occlusionCulling && !occlusion.isVisible(worldBounds);
+        };
+
+        // the CPU side of the frame as a task graph on the job system, stages side by side where they do not
+        // depend on each other; none of them touches GL, which follows on this thread:
+        //   lights -----------------------------------------+
+        //   occluders ----+-- scene --------------------------+-- upload, submit, sort
+        //   transforms ---+-- culling --+-- recording --------+
+        //                 +-- LOD ------+
+        // the pyramid field, when shown, is either culled by a compute shader after the graph, or its entities
+        // are culled, LOD'd and recorded in it; the visibility buffer needs a draw id per pyramid, so it always
+        // takes the recorded path
+        double tasksStart = glfwGetTime();
+        bool gpuDriven = frame.pyramidField && frame.gpuDriven && gpuField && !visibility;
+        bool recordedField = frame.pyramidField && !gpuDriven;
+        Frustum frustum = Frustum::fromMatrix(projection * view);
+        taskGraph.clear();
+        // lights into clusters
+        taskGraph.add("lights", [&]() {
+            clusteredLighting.assign(frame.lights, view, frame.fovy, (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f,
+                                     jobs);
+        });
+        // the pyramid and the plane hide whatever is behind them; rasterize them into the CPU depth buffer
+        // before anything is tested against it
+        int occluders = taskGraph.add("occluders", [&]() {
+            occlusion.begin(projection * view);
+            if (frame.occlusionCulling)
+            {
+                occlusion.addOccluder(pyramidOccluder, frame.pyramidModel);
+                occlusion.addOccluder(planeOccluder, glm::mat4(1.0f));
+                occlusion.rasterize();
+            }
+        });
+        taskGraph.add("scene", [&]() {
+            // pyramid
+            glm::mat4 model = frame.pyramidModel;
+            submitSurface(renderQueue, OBJECT_PYRAMID, *brickMaterial, pyramidGeometry, pyramidPulledGeometry, model, 0);
+
+            // lightCube
+            model = frame.lightCubeModel;
+            if (!occluded(unitCube.transformed(model)))
+                renderQueue.submit(RENDER_PASS_OPAQUE, lightCubeProgram, lightCubeMaterial, lightCubeGeometry, model);
+
+            // plane
+            submitSurface(renderQueue, OBJECT_PLANE, *sandMaterial, planeGeometry, planePulledGeometry, glm::mat4(1.0f), 0);
+
+            //anubis
+            for (unsigned int i = 0; i < anubis.meshes.size(); i++)
+            {
+                if (occluded(anubisBounds[i].transformed(frame.anubisModel)))
+                    continue;
+                model = frame.anubisModel * anubis.nodes.world(anubis.meshNodes[i]);
+                // meshes that only live in GL buffers cannot be resolved from the visibility buffer, they stay forward
+                if (visibility && anubisGeometries[i].sharedMesh < 0)
+                    renderQueue.submit(RENDER_PASS_OPAQUE, litProgram, *anubisMaterials[i], anubisGeometries[i], model,
+                                       anubisCondition, OBJECT_ANUBIS);
+                else
+                    submitSurface(renderQueue, OBJECT_ANUBIS, *anubisMaterials[i], anubisGeometries[i], anubisPulledGeometries[i],
+                                  model, anubisCondition);
+            }
+        }, {occluders});
+        if (recordedField)
+        {
+            int transformed = taskGraph.add("transforms", [&]() {
+                updateTransforms(scene, jobs, currentFrame);
+            });
+            int culling = taskGraph.add("culling", [&]() {
+                cullMeshes(scene, jobs, frustum, occluded);
+            }, {occluders, transformed});
+            int lod = taskGraph.add("LOD", [&]() {
+                selectLods(scene, jobs, frame.cameraPos, PYRAMID_LOD_DISTANCE);
+            }, {transformed});
+            taskGraph.add("recording", [&]() {
+                // ranges of chunks per command list, in order, so draws come out as the entities were created
+                scene.chunks<Transform, MeshRenderer>(sceneChunks);
+                recorder.record(sceneChunks.size(), view, [&](CommandList &list, size_t begin, size_t end) {
+                    for (size_t c = begin; c < end; c++)
+                    {
+                        Chunk &chunk = *sceneChunks[c];
+                        const Transform *transforms = chunk.array<Transform>();
+                        const MeshRenderer *meshes = chunk.array<MeshRenderer>();
+                        for (unsigned int i = 0; i < chunk.count; i++)
+                        {
+                            const MeshRenderer &mesh = meshes[i];
+                            if (!mesh.visible)
+                                continue;
+                            submitSurface(list, (ObjectClass)mesh.objectClass, *mesh.material,
+                                          mesh.far ? *mesh.farGeometry : *mesh.geometry, mesh.far ? *mesh.farPulled : *mesh.pulled,
+                                          transforms[i].world, 0);
+                        }
+                    }
+                });
+            }, {culling, lod});
+        }
+        taskGraph.run(jobs);
+        if (frame.jobTraceRequests != jobTracesWritten)
+        {
+            jobs.writeTrace("job_trace.json");
+            jobTracesWritten = frame.jobTraceRequests;
+        }
+
+        // submit
+        double submitStart = glfwGetTime();
+        clusteredLighting.upload(frame.lights);
+        if (gpuDriven)
+            gpuField->cull(projection * view, frame.cameraPos);
+        else if (recordedField)
+            recorder.submitTo(renderQueue);
+
+        renderQueue.sort();
+        auto drawGpuField = [&](Shader &shader, const RenderProgram &program) {
+            shader.use();
+            program.perFrame(shader);
+            shader.setFloat("time", currentFrame);
+            brickMaterial->apply(shader);
+            gpuField->draw();
+        };
+        // the frame as a graph: the shading path draws into transient scene targets, the post effects
+        // follow when enabled (culled otherwise) and the result is copied to the window
+        FrameGraphHandle backbuffer = frameGraph.importBackbuffer();
+        FrameGraphHandle sceneColor = frameGraph.createTexture("scene color", TextureDesc(width, height, GL_RGBA8));
+        FrameGraphHandle sceneDepth = frameGraph.createTexture("scene depth", TextureDesc(width, height, GL_DEPTH24_STENCIL8));
+        frameGraph.addPass("clear", [&](FrameGraph::Builder &builder) {
+            builder.write(sceneColor);
+            builder.write(sceneDepth);
+        }, [](const FrameGraph::Resources&) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        });
+        if (deferred)
+        {
+            deferredRenderer.addPasses(frameGraph, width, height, sceneColor, sceneDepth, [&]() {
+                renderQueue.execute(RENDER_PASS_DEFERRED);
+                if (gpuDriven)
+                    drawGpuField(*pyramidIndirectGBufferShader, gbufferProgram);
+            }, projection * view, litProgram.perFrame);
+        }
+        else if (visibility)
+        {
+            visibilityBuffer.addPasses(frameGraph, renderQueue, RENDER_PASS_DEFERRED, projection, view, width, height,
+                                       sceneColor, sceneDepth, litProgram.perFrame);
+        }
+        if (deferred || visibility)
+        {
+            // unlit and forward only things on top, against the depth the lighting pass wrote
+            frameGraph.addPass("forward", [&](FrameGraph::Builder &builder) {
+                builder.write(sceneColor);
+                builder.write(sceneDepth);
+            }, [&](const FrameGraph::Resources&) {
+                renderQueue.execute(RENDER_PASS_OPAQUE);
+            });
+        }
+        else
+        {
+            frameGraph.addPass("forward", [&](FrameGraph::Builder &builder) {
+                builder.write(sceneColor);
+                builder.write(sceneDepth);
+            }, [&](const FrameGraph::Resources&) {
+                // depth of the prepassed classes first, then every class shaded, each under its own sample counter
+                forwardTimer.begin();
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                for (int i = 0; i < OBJECT_CLASS_COUNT; i++)
+                {
+                    if (!prepassed((ObjectClass)i))
+                        continue;
+                    unsigned int vertices = renderQueue.stats.vertices;
+                    depthPrepass.beginPrepass(i);
+                    renderQueue.execute(RENDER_PASS_DEPTH_PREPASS, (uint16_t)i);
+                    vertices = renderQueue.stats.vertices - vertices;
+                    if (i == OBJECT_FIELD && gpuDriven)
+                    {
+                        // the GPU picks the pyramids; count them all at full detail, which errs towards no prepass
+                        drawGpuField(*pyramidIndirectDepthShader, depthProgram);
+                        vertices += gpuField->instanceCount() * (unsigned int)pyramidIndices.size();
+                    }
+                    depthPrepass.endPrepass(i, vertices);
+                }
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                for (int i = 0; i < OBJECT_CLASS_COUNT; i++)
+                {
+                    depthPrepass.beginShading(i);
+                    renderQueue.execute(RENDER_PASS_OPAQUE, (uint16_t)i);
+                    if (i == OBJECT_FIELD && gpuDriven)
+                        drawGpuField(*pyramidIndirectShader, litProgram);
+                    depthPrepass.endShading(i);
+                }
+                renderQueue.execute(RENDER_PASS_TRANSPARENT);
+                forwardTimer.end();
+            });
+        }
+        // bounding boxes of the expensive models against this frame's depth, for next frame's conditions
+        if (frame.occlusionQueries)
+        {
+            frameGraph.addPass("occlusion queries", [&](FrameGraph::Builder &builder) {
+                builder.write(sceneDepth);
+                builder.sideEffect();
+            }, [&](const FrameGraph::Resources&) {
+                occlusionQueries.issue(projection * view);
+            });
+        }
+        FrameGraphHandle sharpened = frameGraph.createTexture("sharpened", TextureDesc(width, height, GL_RGBA8));
+        FrameGraphHandle vignetted = frameGraph.createTexture("vignetted", TextureDesc(width, height, GL_RGBA8));
+        addFullScreenPass("sharpen", sharpenShader, sceneColor, sharpened);
+        addFullScreenPass("vignette", vignetteShader, sharpened, vignetted);
+        addFullScreenPass("present", presentShader, frame.postEffects ? vignetted : sceneColor, backbuffer);
+        frameGraph.execute();
+        streamBuffer.endFrame();
+        occlusionQueries.endFrame();
+
+        tasksTime += submitStart - tasksStart;
+        submitTime += glfwGetTime() - submitStart;
+        statsFrames++;
+        if (currentFrame - statsTime > 5.0f)
+        {
+            std::cout << "frame: task graph " << tasksTime * 1000.0f / statsFrames << " ms, sort+submit "
+                      << submitTime * 1000.0f / statsFrames << " ms, " << renderQueue.stats.draws << " draws, "
+                      << renderQueue.stats.programBinds << " program / " << renderQueue.stats.materialBinds
+                      << " material / " << renderQueue.stats.vaoBinds << " vao binds" << std::endl;
+            occlusion.collectStats();
+            if (frame.occlusionCulling && occlusion.stats.tested)
+                std::cout << "occlusion: " << occlusion.stats.culled << " of " << occlusion.stats.tested << " tested culled ("
+                          << 100.0f * occlusion.stats.culled / occlusion.stats.tested << "%), "
+                          << occlusion.stats.occluderTriangles << " occluder triangles rasterized in "
+                          << occlusion.stats.rasterMs << " ms" << std::endl;
+            const LightClusterStats &lightStats = clusteredLighting.clusters.stats;
+            std::cout << "lights: " << lightStats.lights << " in " << LightClusters::COUNT << " clusters, "
+                      << lightStats.references << " references, at most " << lightStats.maxPerCluster
+                      << " per cluster, assigned in " << lightStats.assignMs << " ms" << std::endl;
+            if (deferred)
+                std::cout << "deferred: geometry " << deferredRenderer.geometryTimer.averageMs() << " ms, lighting "
+                          << deferredRenderer.lightingTimer.averageMs()
+                          << " ms (GPU), G-buffer " << deferredRenderer.memoryBytes() / (1024.0f * 1024.0f) << " MB at "
+                          << DeferredRenderer::BYTES_PER_PIXEL << " bytes per pixel" << std::endl;
+            else if (visibility)
+                std::cout << "visibility buffer: " << visibilityBuffer.stats.draws << " draws ("
+                          << visibilityBuffer.stats.skipped << " skipped) in " << visibilityBuffer.visibilityTimer.averageMs() << " ms, "
+                          << visibilityBuffer.stats.materials << " material resolves in " << visibilityBuffer.resolveTimer.averageMs()
+                          << " ms (GPU), " << visibilityBuffer.memoryBytes() / (1024.0f * 1024.0f) << " MB target, "
+                          << sharedGeometry.memoryBytes() / 1024.0f << " KB shared geometry" << std::endl;
+            else
+            {
+                std::cout << "forward: " << forwardTimer.averageMs() << " ms (GPU), fragment shader invocations per frame:" << std::endl;
+                depthPrepass.report(std::cout);
+            }
+            forwardTimer.reset();
+            deferredRenderer.geometryTimer.reset();
+            deferredRenderer.lightingTimer.reset();
+            visibilityBuffer.visibilityTimer.reset();
+            visibilityBuffer.resolveTimer.reset();
+            frameGraph.report(std::cout);
+            std::cout << "stream buffer: " << (streamBuffer.isPersistent() ? "persistent" : "unsynchronized map") << ", "
+                      << streamBuffer.stats.bytes / 1024.0f << " KB in " << streamBuffer.stats.allocations
+                      << " allocations this frame, " << streamBuffer.capacity() / 1024 << " KB ring, "
+                      << streamBuffer.stats.waits << " waits (" << streamBuffer.stats.waitMs << " ms)" << std::endl;
+            std::cout << "gl backend: " << GLBackend::name() << ", " << GLBackend::stats().binds
+                      << " texture and edit binds this frame" << std::endl;
+            if (frame.occlusionQueries)
+                std::cout << "occlusion queries: " << occlusionQueries.stats.hidden << " of " << occlusionQueries.stats.tracked
+                          << " tracked models hidden, " << renderQueue.stats.conditionalDraws << " conditional draws, "
+                          << occlusionQueries.poolSize() << " pooled queries" << std::endl;
+            if (gpuDriven)
+            {
+                std::vector<GLuint> visible = gpuField->visibleCounts();
+                std::cout << "gpu field: " << visible[0] << " full + " << visible[1] << " far lod of "
+                          << gpuField->instanceCount() << " instances in one multi draw" << std::endl;
+            }
+            statsTime = currentFrame;
+            jobs.report(std::cout, statsFrames);
+            tasksTime = submitTime = 0.0f;
+            statsFrames = 0;
+        }
+
+
+        // glfw: swap buffers
+        // ------------------
         glfwSwapBuffers(window);
-        glfwPollEvents();
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
@@ -347,20 +1106,21 @@ int main()
     glDeleteVertexArrays(1, &pyramidVAO);
     glDeleteVertexArrays(1, &lightCubeVAO);
     glDeleteVertexArrays(1, &planeVAO);
+    glDeleteVertexArrays(1, &pyramidDepthVAO);
+    glDeleteVertexArrays(1, &planeDepthVAO);
+    glDeleteVertexArrays(1, &fullScreenVAO);
     glDeleteBuffers(1, &planeVBO);
+    glDeleteBuffers(1, &planePositionVBO);
+    glDeleteBuffers(1, &pyramidPositionVBO);
     glDeleteBuffers(1, &pyramidVBO);
+    glDeleteBuffers(1, &pyramidEBO);
     glDeleteBuffers(1, &lightCubeVBO);
     glDeleteBuffers(1, &lightCubeEBO);
-
-    // glfw: terminate, clearing all previously allocated GLFW resources.
-    // ------------------------------------------------------------------
-    glfwTerminate();
-    return 0;
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow *window)
+void processInput(GLFWwindow *window, float deltaTime)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
@@ -375,13 +1135,67 @@ void processInput(GLFWwindow *window)
         camera.ProcessKeyboard(RIGHT, deltaTime);
 }
 
-// glfw: whenever the window size changed (by OS or user resize) this callback function executes
-// ---------------------------------------------------------------------------------------------
-void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+// glfw: key presses that toggle render paths, once per press rather than every frame
+// ---------------------------------------------------------------------------------
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-    // make sure the viewport matches the new window dimensions; note that width and
-    // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    if (action != GLFW_PRESS)
+        return;
+    if (key == GLFW_KEY_F)
+    {
+        pyramidFieldEnabled = !pyramidFieldEnabled;
+        std::cout << "pyramid field: " << (pyramidFieldEnabled ? "shown" : "hidden") << std::endl;
+    }
+    if (key == GLFW_KEY_G && GLCapabilities::get().gpuDriven)
+    {
+        gpuDrivenEnabled = !gpuDrivenEnabled;
+        std::cout << "pyramid field: " << (gpuDrivenEnabled ? "GPU driven" : "CPU recorded") << std::endl;
+    }
+    if (key == GLFW_KEY_O)
+    {
+        occlusionCullingEnabled = !occlusionCullingEnabled;
+        std::cout << "occlusion culling: " << (occlusionCullingEnabled ? "on" : "off") << std::endl;
+    }
+    if (key == GLFW_KEY_Q)
+    {
+        occlusionQueriesEnabled = !occlusionQueriesEnabled;
+        std::cout << "occlusion queries: " << (occlusionQueriesEnabled ? "on" : "off") << std::endl;
+    }
+    if (key == GLFW_KEY_M)
+    {
+        shadingPath = (ShadingPath)((shadingPath + 1) % SHADING_PATH_COUNT);
+        std::cout << "shading: " << SHADING_PATH_NAMES[shadingPath] << std::endl;
+    }
+    if (key >= GLFW_KEY_1 && key < GLFW_KEY_1 + OBJECT_CLASS_COUNT - 1)
+    {
+        int objectClass = OBJECT_PYRAMID + key - GLFW_KEY_1;
+        const DepthPrepassMode next[3] = {DEPTH_PREPASS_AUTO, DEPTH_PREPASS_OFF, DEPTH_PREPASS_ON}; // auto, on, off, auto
+        prepassModes[objectClass] = next[prepassModes[objectClass]];
+        const char *names[3] = {"off", "on", "auto"};
+        std::cout << "depth prepass for " << OBJECT_CLASS_NAMES[objectClass] << ": " << names[prepassModes[objectClass]] << std::endl;
+    }
+    if (key == GLFW_KEY_P)
+    {
+        postEffectsEnabled = !postEffectsEnabled;
+        std::cout << "post effects: " << (postEffectsEnabled ? "on" : "off") << std::endl;
+    }
+    if (key == GLFW_KEY_V)
+    {
+        vertexPullingEnabled = !vertexPullingEnabled;
+        std::cout << "vertex pulling: " << (vertexPullingEnabled ? "on" : "off") << std::endl;
+    }
+    if (key == GLFW_KEY_T)
+    {
+        simulationRateSetting = (simulationRateSetting + 1) % (sizeof(SIMULATION_RATES) / sizeof(SIMULATION_RATES[0]));
+        std::cout << "simulation: " << SIMULATION_RATES[simulationRateSetting] << " steps per second" << std::endl;
+    }
+    if (key == GLFW_KEY_J)
+        jobTraceRequests++;
+    if (key == GLFW_KEY_L)
+    {
+        fieldLightSetting = (fieldLightSetting + 1) % (sizeof(FIELD_LIGHT_COUNTS) / sizeof(FIELD_LIGHT_COUNTS[0]));
+        std::cout << "field lights: " << FIELD_LIGHT_COUNTS[fieldLightSetting] << std::endl;
+    }
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -415,37 +1229,11 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 // ---------------------------------------------------
 unsigned int loadTexture(char const * path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    // cooked textures are uploaded as is, anything else is decoded straight out of the mapping
+    AssetData file = FileSystem::read(path);
+    TextureImage image;
+    if (image.decode(file))
+        return TextureFromImage(image, false);
+    std::cout << "Texture failed to load at path: " << path << std::endl;
+    return GLBackend::createTexture(GL_TEXTURE_2D);
 }
\ No newline at end of file
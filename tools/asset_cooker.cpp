@@ -0,0 +1,469 @@
+// Offline asset processing: scans resources/, cooks every asset whose content (or the content of
+// anything it depends on) changed since the last run and writes the results into resources.pack.
+//
+//   asset_cooker [--root DIR] [--out PACK] [--cache DIR] [-j THREADS] [--force]
+//
+// Cooked formats:
+//   shaders   - includes expanded, ready for glShaderSource
+//   textures  - decoded to raw pixels behind a CookedTextureHeader, LZ4 compressed in the pack
+//   .obj      - stored as is for Assimp, plus the native reader's meshes as path + COOKED_MESH_SUFFIX
+//   the rest  - stored as is, but still tracked so a changed texture re-cooks the materials using it;
+//               .glb is read from its buffer views as it is, .mtl only matters to the .obj it belongs to
+
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/cooked_mesh.h>
+#include <learnopengl/cooked_texture.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/obj_loader.h> // also brings logl_root through filesystem.h
+#include <learnopengl/shader_includes.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// bump when a cooker changes its output format so everything gets re-cooked
+const uint64_t COOKER_VERSION = 2;
+
+enum AssetKind {
+    ASSET_SHADER,
+    ASSET_TEXTURE,
+    ASSET_MODEL,
+    ASSET_MATERIAL,
+    ASSET_RAW
+};
+
+struct Asset {
+    std::string path; // relative to the root, e.g. "resources/textures/sand.jpg"
+    AssetKind kind;
+    uint64_t contentHash = 0;
+    uint64_t key = 0; // content hash combined with the keys of all dependencies
+    std::vector<std::string> deps;
+    bool dirty = false;
+    bool ok = true;
+};
+
+struct CookerOptions {
+    std::string root;
+    std::string out;
+    std::string cache;
+    unsigned threads = 0;
+    bool force = false;
+};
+
+static const char* kindName(AssetKind kind)
+{
+    switch (kind) {
+        case ASSET_SHADER: return "shader";
+        case ASSET_TEXTURE: return "texture";
+        case ASSET_MODEL: return "model";
+        case ASSET_MATERIAL: return "material";
+        default: return "raw";
+    }
+}
+
+static std::string lowerExtension(const std::string &path)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return std::string();
+    std::string ext = path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext;
+}
+
+static AssetKind classify(const std::string &path)
+{
+    std::string ext = lowerExtension(path);
+    if (ext == "vs" || ext == "fs" || ext == "gs" || ext == "cs" || ext == "glsl" || ext == "vert" || ext == "frag")
+        return ASSET_SHADER;
+    if (ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "tga" || ext == "bmp" || ext == "psd" || ext == "hdr")
+        return ASSET_TEXTURE;
+    if (ext == "obj" || ext == "glb")
+        return ASSET_MODEL;
+    if (ext == "mtl")
+        return ASSET_MATERIAL;
+    return ASSET_RAW;
+}
+
+static uint64_t hashBytes(const unsigned char *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t hashCombine(uint64_t hash, uint64_t value)
+{
+    return hashBytes(reinterpret_cast<const unsigned char*>(&value), sizeof(value), hash);
+}
+
+static std::string hex(uint64_t value)
+{
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)value);
+    return buffer;
+}
+
+static void scanDirectory(const std::string &root, const std::string &relative, std::vector<std::string> &files)
+{
+    DIR *dir = opendir((root + "/" + relative).c_str());
+    if (!dir)
+        return;
+    while (struct dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == ".." || name[0] == '.')
+            continue;
+        std::string path = relative + "/" + name;
+        struct stat st;
+        if (stat((root + "/" + path).c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            scanDirectory(root, path, files);
+        else if (S_ISREG(st.st_mode))
+            files.push_back(path);
+    }
+    closedir(dir);
+}
+
+// runs fn(i) for i in [0, count) on the given number of threads
+static void parallelFor(size_t count, unsigned threads, const std::function<void(size_t)> &fn)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++)
+            fn(i);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t < count; t++)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread &t : pool)
+        t.join();
+}
+
+// side files referenced from a model/material/shader, as root relative paths
+static std::vector<std::string> parseDependencies(const Asset &asset, const AssetData &data)
+{
+    std::vector<std::string> deps;
+    std::string directory = asset.path.substr(0, asset.path.find_last_of('/') + 1);
+    std::istringstream lines(data.str());
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        std::istringstream tokens(line);
+        std::string keyword;
+        tokens >> keyword;
+        if (asset.kind == ASSET_SHADER && keyword == "#include") {
+            size_t open = line.find('"');
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close != std::string::npos)
+                deps.push_back(normalizeAssetPath(directory + line.substr(open + 1, close - open - 1)));
+        } else if (asset.kind == ASSET_MODEL && keyword == "mtllib") {
+            std::string file;
+            std::getline(tokens >> std::ws, file);
+            deps.push_back(normalizeAssetPath(directory + file));
+        } else if (asset.kind == ASSET_MATERIAL && (keyword.compare(0, 4, "map_") == 0 || keyword == "bump"
+                                                    || keyword == "disp" || keyword == "decal" || keyword == "norm")) {
+            // options such as "-bm 1.0" may precede the file name, which is always last
+            size_t last = line.find_last_of(" \t");
+            if (last != std::string::npos)
+                deps.push_back(normalizeAssetPath(directory + line.substr(last + 1)));
+        }
+    }
+    return deps;
+}
+
+// where the cooked output for a pack entry lives in the cache
+static std::string cachedPath(const CookerOptions &options, const std::string &packPath)
+{
+    return options.cache + "/" + hex(hashAssetPath(packPath)) + ".bin";
+}
+
+// models the native OBJ reader loads get its parsed meshes as a second pack entry
+static bool hasCookedMeshes(const Asset &asset)
+{
+    return asset.kind == ASSET_MODEL && lowerExtension(asset.path) == "obj";
+}
+
+static bool cookMeshesOf(const CookerOptions &options, const Asset &asset, std::vector<unsigned char> &cooked)
+{
+    AssetData source = readAsset(options.root + "/" + asset.path);
+    if (!source.valid())
+        return false;
+    // one thread, the cooker already runs an asset per thread
+    std::vector<MeshData> meshes = parseObj(source, asset.path, 1, [&](const std::string &path) {
+        return readAsset(options.root + "/" + normalizeAssetPath(path));
+    });
+    cooked = cookMeshes(meshes);
+    return true;
+}
+
+static bool cookAsset(const CookerOptions &options, const Asset &asset, std::vector<unsigned char> &cooked)
+{
+    AssetData source = readAsset(options.root + "/" + asset.path);
+    if (!source.valid())
+        return false;
+    if (asset.kind == ASSET_SHADER) {
+        std::string expanded;
+        std::vector<std::string> deps;
+        std::set<std::string> visited;
+        auto read = [&](const std::string &path, std::string &contents) {
+            AssetData data = readAsset(options.root + "/" + path);
+            contents = data.str();
+            return data.valid();
+        };
+        if (!expandShaderIncludes(asset.path, source.str(), read, expanded, deps, visited))
+            return false;
+        cooked.assign(expanded.begin(), expanded.end());
+        return true;
+    }
+    if (asset.kind == ASSET_TEXTURE) {
+        TextureImage image;
+        if (!image.decode(source)) {
+            std::cout << "  cannot decode " << asset.path << ", storing it as is" << std::endl;
+            cooked.assign(source.data(), source.data() + source.size());
+            return true;
+        }
+        CookedTextureHeader header;
+        header.magic = COOKED_TEXTURE_MAGIC;
+        header.version = COOKED_TEXTURE_VERSION;
+        header.width = (uint32_t)image.width;
+        header.height = (uint32_t)image.height;
+        header.components = (uint32_t)image.components;
+        header.reserved = 0;
+        size_t pixelBytes = (size_t)image.width * image.height * image.components;
+        cooked.resize(sizeof(header) + pixelBytes);
+        std::memcpy(cooked.data(), &header, sizeof(header));
+        std::memcpy(cooked.data() + sizeof(header), image.pixels, pixelBytes);
+        return true;
+    }
+    cooked.assign(source.data(), source.data() + source.size());
+    return true;
+}
+
+static std::map<std::string, uint64_t> loadManifest(const std::string &path)
+{
+    std::map<std::string, uint64_t> manifest;
+    std::ifstream in(path);
+    std::string key, assetPath;
+    // the path is the rest of the line, so it may contain spaces
+    while (in >> key && std::getline(in >> std::ws, assetPath))
+        manifest[assetPath] = std::stoull(key, nullptr, 16);
+    return manifest;
+}
+
+static bool fileExists(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+static bool readFileInto(const std::string &path, std::vector<unsigned char> &out)
+{
+    AssetData data = readAsset(path);
+    if (!data.valid())
+        return false;
+    out.assign(data.data(), data.data() + data.size());
+    return true;
+}
+
+static bool writeFile(const std::string &path, const std::vector<unsigned char> &data)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(data.data()), (std::streamsize)data.size());
+    return (bool)out;
+}
+
+int main(int argc, char **argv)
+{
+    CookerOptions options;
+    const char *envRoot = getenv("LOGL_ROOT_PATH");
+    options.root = envRoot ? envRoot : logl_root;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--root" && i + 1 < argc)
+            options.root = argv[++i];
+        else if (arg == "--out" && i + 1 < argc)
+            options.out = argv[++i];
+        else if (arg == "--cache" && i + 1 < argc)
+            options.cache = argv[++i];
+        else if (arg == "-j" && i + 1 < argc)
+            options.threads = (unsigned)std::stoul(argv[++i]);
+        else if (arg == "--force")
+            options.force = true;
+        else {
+            std::cout << "usage: asset_cooker [--root DIR] [--out PACK] [--cache DIR] [-j THREADS] [--force]" << std::endl;
+            return 1;
+        }
+    }
+    if (options.out.empty())
+        options.out = options.root + "/resources.pack";
+    if (options.cache.empty())
+        options.cache = options.root + "/.cooked";
+    if (options.threads == 0)
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    mkdir(options.cache.c_str(), 0755);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // 1. scan and hash everything, collecting dependency edges
+    std::vector<std::string> files;
+    scanDirectory(options.root, "resources", files);
+    std::sort(files.begin(), files.end());
+    std::vector<Asset> assets(files.size());
+    std::map<std::string, size_t> byPath;
+    for (size_t i = 0; i < files.size(); i++) {
+        assets[i].path = files[i];
+        assets[i].kind = classify(files[i]);
+        byPath[files[i]] = i;
+    }
+    parallelFor(assets.size(), options.threads, [&](size_t i) {
+        AssetData data = readAsset(options.root + "/" + assets[i].path);
+        if (!data.valid()) {
+            assets[i].ok = false;
+            return;
+        }
+        assets[i].contentHash = hashBytes(data.data(), data.size());
+        if (assets[i].kind == ASSET_SHADER || assets[i].kind == ASSET_MODEL || assets[i].kind == ASSET_MATERIAL)
+            assets[i].deps = parseDependencies(assets[i], data);
+    });
+
+    // 2. fold dependency keys in, depth first; a cycle or a missing file only contributes its path
+    std::vector<int> state(assets.size(), 0); // 0 = unvisited, 1 = in progress, 2 = done
+    std::function<uint64_t(size_t)> computeKey = [&](size_t i) -> uint64_t {
+        if (state[i] == 2)
+            return assets[i].key;
+        if (state[i] == 1)
+            return assets[i].contentHash;
+        state[i] = 1;
+        uint64_t key = hashCombine(hashCombine(14695981039346656037ull, COOKER_VERSION), assets[i].contentHash);
+        for (const std::string &dep : assets[i].deps) {
+            auto it = byPath.find(dep);
+            if (it == byPath.end()) {
+                std::cout << "  warning: " << assets[i].path << " references missing " << dep << std::endl;
+                key = hashCombine(key, hashAssetPath(dep));
+            } else {
+                key = hashCombine(key, computeKey(it->second));
+            }
+        }
+        assets[i].key = key;
+        state[i] = 2;
+        return key;
+    };
+    for (size_t i = 0; i < assets.size(); i++)
+        computeKey(i);
+
+    // 3. anything whose key differs from the manifest, or whose cached output is gone, is dirty
+    std::string manifestPath = options.cache + "/manifest.txt";
+    std::map<std::string, uint64_t> manifest = loadManifest(manifestPath);
+    std::vector<size_t> dirty;
+    for (size_t i = 0; i < assets.size(); i++) {
+        auto it = manifest.find(assets[i].path);
+        bool cached = fileExists(cachedPath(options, assets[i].path)) &&
+                      (!hasCookedMeshes(assets[i]) || fileExists(cachedPath(options, assets[i].path + COOKED_MESH_SUFFIX)));
+        assets[i].dirty = options.force || it == manifest.end() || it->second != assets[i].key || !cached;
+        if (assets[i].dirty && assets[i].ok)
+            dirty.push_back(i);
+    }
+    bool removed = false;
+    for (const auto &entry : manifest)
+        removed |= byPath.find(entry.first) == byPath.end();
+
+    if (dirty.empty() && !removed && fileExists(options.out)) {
+        std::cout << "asset_cooker: " << assets.size() << " assets up to date" << std::endl;
+        return 0;
+    }
+
+    // 4. cook dirty assets in parallel into the cache directory
+    std::atomic<int> failures(0);
+    std::mutex printMutex;
+    parallelFor(dirty.size(), options.threads, [&](size_t n) {
+        Asset &asset = assets[dirty[n]];
+        std::vector<unsigned char> cooked, meshes;
+        if (!cookAsset(options, asset, cooked) || !writeFile(cachedPath(options, asset.path), cooked) ||
+            (hasCookedMeshes(asset) && (!cookMeshesOf(options, asset, meshes) ||
+                                        !writeFile(cachedPath(options, asset.path + COOKED_MESH_SUFFIX), meshes)))) {
+            asset.ok = false;
+            failures++;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(printMutex);
+        std::cout << "  cooked " << std::setw(8) << kindName(asset.kind) << "  " << asset.path << std::endl;
+    });
+
+    // 5. assemble the pack from the cache; reading and compressing the blobs runs in parallel, the
+    // writer keeps blobs that don't shrink (already compressed sources) uncompressed
+    std::vector<AssetPackBlob> blobs(assets.size()), meshBlobs(assets.size());
+    parallelFor(assets.size(), options.threads, [&](size_t i) {
+        std::vector<unsigned char> cooked;
+        if (!assets[i].ok)
+            return;
+        if (!readFileInto(cachedPath(options, assets[i].path), cooked)) {
+            assets[i].ok = false;
+            return;
+        }
+        blobs[i] = AssetPackWriter::makeBlob(assets[i].path, cooked.data(), cooked.size());
+        if (!hasCookedMeshes(assets[i]))
+            return;
+        std::string meshPath = assets[i].path + COOKED_MESH_SUFFIX;
+        if (!readFileInto(cachedPath(options, meshPath), cooked))
+            assets[i].ok = false;
+        else
+            meshBlobs[i] = AssetPackWriter::makeBlob(meshPath, cooked.data(), cooked.size());
+    });
+    AssetPackWriter writer;
+    std::ostringstream manifestOut;
+    size_t packed = 0;
+    for (size_t i = 0; i < assets.size(); i++) {
+        if (!assets[i].ok)
+            continue;
+        writer.add(std::move(blobs[i]));
+        if (hasCookedMeshes(assets[i]))
+            writer.add(std::move(meshBlobs[i]));
+        manifestOut << hex(assets[i].key) << " " << assets[i].path << "\n";
+        packed++;
+    }
+
+    // 6. the manifest only moves on once the pack it describes is in place; without a pack the old
+    // manifest goes too, so the next run cannot take the stale pack for up to date
+    std::string tmp = options.out + ".tmp";
+    if (!writer.write(tmp) || std::rename(tmp.c_str(), options.out.c_str()) != 0) {
+        std::cout << "asset_cooker: failed to write " << options.out << std::endl;
+        std::remove(tmp.c_str());
+        std::remove(manifestPath.c_str());
+        return 1;
+    }
+    std::string manifestText = manifestOut.str(), manifestTmp = manifestPath + ".tmp";
+    if (!writeFile(manifestTmp, std::vector<unsigned char>(manifestText.begin(), manifestText.end())) ||
+        std::rename(manifestTmp.c_str(), manifestPath.c_str()) != 0) {
+        std::cout << "asset_cooker: failed to write " << manifestPath << std::endl;
+        std::remove(manifestTmp.c_str());
+        std::remove(manifestPath.c_str());
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "asset_cooker: cooked " << dirty.size() - failures << "/" << assets.size() << " assets, packed "
+              << packed << " into " << options.out << " in " << std::fixed << std::setprecision(3)
+              << seconds << " s on " << options.threads << " threads" << std::endl;
+    return failures ? 1 : 0;
+}
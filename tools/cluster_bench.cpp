@@ -0,0 +1,59 @@
+// Times the CPU light assignment of the clustered forward path for 1 to 1024 point lights, with one
+// thread and with the whole job system. Lights are scattered over the pyramid field, the camera looks at
+// it from the default start position. No GL context is needed.
+//
+//   cluster_bench [frames] [threads]
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/light_clusters.h>
+#include <learnopengl/job_system.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? std::atoi(argv[1]) : 200;
+    unsigned threads = argc > 2 ? (unsigned)std::atoi(argv[2]) : 0;
+
+    JobSystem single(1), pool(threads);
+    LightClusters clusters;
+    clusters.setProjection(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> field(-48.0f, 48.0f), unit(0.0f, 1.0f);
+    std::vector<PointLight> all(1024);
+    for (PointLight &light : all) {
+        light.position = glm::vec3(field(random), 0.2f + unit(random), field(random));
+        light.diffuse = light.specular = glm::vec3(unit(random), unit(random), unit(random)) * 2.5f;
+        light.ambient = glm::vec3(0.0f);
+        light.linear = 1.0f;
+        light.quadratic = 6.0f;
+    }
+
+    std::cout << "clusters " << LightClusters::X << "x" << LightClusters::Y << "x" << LightClusters::Z
+              << ", " << frames << " frames, " << pool.threadCount() << " threads" << std::endl;
+    for (size_t count = 1; count <= all.size(); count *= 2) {
+        std::vector<PointLight> lights(all.begin(), all.begin() + count);
+        auto time = [&](JobSystem &workers) {
+            double total = 0.0;
+            for (int i = 0; i < frames; i++) {
+                clusters.assign(lights, view, workers);
+                total += clusters.stats.assignMs;
+            }
+            return total / frames;
+        };
+        double one = time(single), many = time(pool);
+        std::cout << std::setw(5) << count << " lights: " << std::fixed << std::setprecision(3)
+                  << one << " ms on 1 thread, " << many << " ms on " << pool.threadCount() << ", "
+                  << clusters.stats.references << " light references, at most " << clusters.stats.maxPerCluster
+                  << " per cluster" << std::endl;
+    }
+    return 0;
+}
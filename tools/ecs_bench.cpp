@@ -0,0 +1,90 @@
+// Throughput of the scene systems over 10 to 1M entities, with one thread and with the whole job system:
+// updateTransforms, and cullMeshes plus selectLods for culling. Nine in ten entities are meshes scattered
+// over a 1000 x 1000 field, the rest lights, a second archetype the mesh systems skip. The camera is the
+// default start position looking down the field. No GL context is needed.
+//
+//   ecs_bench [max entities] [threads]
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/scene_systems.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// million entities per second over repetitions that together touch a few million entities
+template <typename F>
+static double throughput(size_t entities, const F &fn)
+{
+    int repetitions = (int)std::max<size_t>(3, 4000000 / entities);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; i++)
+        fn(i);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return entities * repetitions / seconds / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    size_t maxEntities = argc > 1 ? (size_t)std::atoll(argv[1]) : 1000000;
+    unsigned threads = argc > 2 ? (unsigned)std::atoi(argv[2]) : 0;
+
+    JobSystem single(1), all(threads);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+    glm::vec3 cameraPos(0.0f, 0.0f, 3.0f);
+    auto occluded = [](const BoundingBox&) { return false; };
+
+    std::cout << "chunks of " << Chunk::BYTES / 1024 << " KB, " << all.threadCount() << " threads, million entities per second"
+              << std::endl;
+    for (size_t count = 10; count <= maxEntities; count *= 10) {
+        World world;
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> field(-500.0f, 500.0f), unit(0.0f, 1.0f);
+        for (size_t i = 0; i < count; i++) {
+            Transform transform;
+            transform.position = glm::vec3(field(random), unit(random), field(random));
+            transform.scale = 0.5f;
+            transform.yaw = unit(random) * 6.28f;
+            transform.spin = 1.0f;
+            if (i % 10 == 9) {
+                world.create(transform, Light());
+                continue;
+            }
+            Bounds bounds;
+            bounds.center = transform.position;
+            bounds.radius = 0.45f;
+            world.create(transform, MeshRenderer(), bounds);
+        }
+        std::vector<Chunk*> meshChunks;
+        world.chunks<MeshRenderer>(meshChunks);
+
+        auto transforms = [&](JobSystem &jobs) {
+            return throughput(count, [&](int i) { updateTransforms(world, jobs, i * 0.016f); });
+        };
+        auto culling = [&](JobSystem &jobs) {
+            return throughput(count, [&](int) {
+                cullMeshes(world, jobs, frustum, occluded);
+                selectLods(world, jobs, cameraPos, 10.0f);
+            });
+        };
+        double transformsOne = transforms(single), transformsAll = transforms(all);
+        double cullingOne = culling(single), cullingAll = culling(all);
+        size_t visible = 0;
+        for (Chunk *chunk : meshChunks)
+            for (unsigned int i = 0; i < chunk->count; i++)
+                visible += chunk->array<MeshRenderer>()[i].visible;
+        std::cout << std::setw(7) << count << " entities in " << std::setw(5) << meshChunks.size() << " mesh chunks: "
+                  << std::fixed << std::setprecision(1) << "transforms " << std::setw(6) << transformsOne << " / "
+                  << std::setw(6) << transformsAll << ", culling " << std::setw(6) << cullingOne << " / "
+                  << std::setw(6) << cullingAll << ", " << visible << " visible" << std::endl;
+    }
+    return 0;
+}
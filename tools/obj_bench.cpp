@@ -0,0 +1,101 @@
+// Compares the native OBJ reader against the Assimp import Model used before it.
+// Both sides stop at CPU ready vertex/index arrays, no GL context is needed.
+//
+//   obj_bench <file.obj> [repetitions] [threads]
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <learnopengl/mapped_io_system.h>
+#include <learnopengl/obj_loader.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// same flags and per vertex conversion as Model::loadModel/processMesh
+static size_t loadWithAssimp(const std::string &path, size_t &indexCount)
+{
+    Assimp::Importer importer;
+    importer.SetIOHandler(new MappedIOSystem());
+    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+        return 0;
+    }
+    size_t vertexCount = 0;
+    indexCount = 0;
+    for (unsigned int m = 0; m < scene->mNumMeshes; m++) {
+        const aiMesh *mesh = scene->mMeshes[m];
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+            Vertex vertex;
+            vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+            if (mesh->HasNormals())
+                vertex.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+            if (mesh->mTextureCoords[0]) {
+                vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+                vertex.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+                vertex.Bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+            } else {
+                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+            }
+            vertices.push_back(vertex);
+        }
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+            for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; j++)
+                indices.push_back(mesh->mFaces[i].mIndices[j]);
+        vertexCount += vertices.size();
+        indexCount += indices.size();
+    }
+    return vertexCount;
+}
+
+static size_t loadNative(const std::string &path, unsigned threads, size_t &indexCount)
+{
+    std::vector<MeshData> meshes = loadObj(path, threads);
+    size_t vertexCount = 0;
+    indexCount = 0;
+    for (const MeshData &mesh : meshes) {
+        vertexCount += mesh.vertices.size();
+        indexCount += mesh.indices.size();
+    }
+    return vertexCount;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        std::cout << "usage: obj_bench <file.obj> [repetitions] [threads]" << std::endl;
+        return 1;
+    }
+    std::string path = argv[1];
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+    unsigned threads = argc > 3 ? (unsigned)std::atoi(argv[3]) : 0;
+
+    auto run = [&](const char *name, const std::function<size_t(size_t&)> &load) {
+        double best = 1e30, total = 0.0;
+        size_t vertices = 0, indices = 0;
+        for (int i = 0; i < repetitions; i++) {
+            auto start = std::chrono::steady_clock::now();
+            vertices = load(indices);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = std::min(best, seconds);
+            total += seconds;
+        }
+        std::cout << std::setw(8) << name << ": best " << std::fixed << std::setprecision(2) << best * 1000.0
+                  << " ms, mean " << total / repetitions * 1000.0 << " ms, "
+                  << vertices << " vertices, " << indices / 3 << " triangles" << std::endl;
+        return best;
+    };
+
+    double assimp = run("assimp", [&](size_t &indices) { return loadWithAssimp(path, indices); });
+    double native = run("native", [&](size_t &indices) { return loadNative(path, threads, indices); });
+    std::cout << "speedup " << std::setprecision(2) << assimp / native << "x" << std::endl;
+    return 0;
+}
@@ -0,0 +1,70 @@
+// SceneGraph::update over 1K to 1M node hierarchies, with one thread and with the whole job system: all
+// nodes dirty, as when the root moves, and one node in a thousand moved, as a frame where a few objects
+// move some of their parts. Every node has four children until the count is reached, so the levels
+// grow by four. No GL context is needed.
+//
+//   scene_graph_bench [max nodes] [threads]
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/scene_graph.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// milliseconds per update, over repetitions that together touch a few million nodes
+template <typename F>
+static double milliseconds(size_t nodes, const F &fn)
+{
+    int repetitions = (int)std::max<size_t>(3, 4000000 / nodes);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; i++)
+        fn(i);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1000.0 / repetitions;
+}
+
+int main(int argc, char **argv)
+{
+    size_t maxNodes = argc > 1 ? (size_t)std::atoll(argv[1]) : 1000000;
+    unsigned threads = argc > 2 ? (unsigned)std::atoi(argv[2]) : 0;
+
+    JobSystem all(threads);
+    std::cout << all.threadCount() << " threads, milliseconds per update" << std::endl;
+    for (size_t count = 1000; count <= maxNodes; count *= 10) {
+        SceneGraph graph;
+        graph.add(SceneGraph::NO_PARENT, glm::mat4(1.0f));
+        for (size_t i = 1; i < count; i++) {
+            glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, (float)(i % 4)));
+            graph.add((int)((i - 1) / 4), glm::rotate(local, 0.1f, glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
+        graph.update();
+
+        auto full = [&](JobSystem *jobs) {
+            return milliseconds(count, [&](int i) {
+                graph.setLocal(0, glm::translate(glm::mat4(1.0f), glm::vec3((float)i, 0.0f, 0.0f)));
+                graph.update(jobs);
+            });
+        };
+        size_t moved = 0;
+        auto partial = [&](JobSystem *jobs) {
+            return milliseconds(count, [&](int i) {
+                for (size_t node = 500; node < count; node += 1000)
+                    graph.setLocal((int)node, glm::translate(graph.local((int)node), glm::vec3(0.0f, (float)(i & 1), 0.0f)));
+                moved = graph.update(jobs);
+            });
+        };
+        double fullOne = full(nullptr), fullAll = full(&all);
+        double partialOne = partial(nullptr), partialAll = partial(&all);
+        std::cout << std::setw(7) << count << " nodes in " << graph.levelCount() << " levels: " << std::fixed
+                  << std::setprecision(3) << "all dirty " << std::setw(7) << fullOne << " / " << std::setw(7) << fullAll
+                  << ", " << moved << " dirty " << std::setw(7) << partialOne << " / " << std::setw(7) << partialAll
+                  << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Estimates the vertex fetch traffic of depth only and full passes for the two Mesh vertex storages.
+// Indices are replayed in draw order through a 32 entry post-transform cache (hits fetch nothing) and
+// an LRU cache of 64 byte lines in front of memory; every line miss counts as 64 bytes fetched. The
+// interleaved layout drags normals, texture coords and tangents into the cache with each position,
+// the split one reads 12 bytes per vertex for depth and two streams for shading. No GL context is
+// needed.
+//
+//   vertex_fetch_bench [file.obj] [cache KB]
+// Without a file, a 512x512 grid stands in, drawn row by row.
+
+#include <learnopengl/obj_loader.h>
+
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+static const size_t LINE_BYTES = 64;
+static const size_t POST_TRANSFORM_ENTRIES = 32;
+
+// fully associative LRU over cache lines
+class LineCache
+{
+public:
+    explicit LineCache(size_t lines) : capacity(lines) {}
+
+    // touches [address, address + bytes); returns the lines that missed
+    size_t touch(size_t address, size_t bytes)
+    {
+        size_t misses = 0;
+        for (size_t line = address / LINE_BYTES; line <= (address + bytes - 1) / LINE_BYTES; line++) {
+            auto found = lookup.find(line);
+            if (found != lookup.end()) {
+                order.splice(order.begin(), order, found->second);
+                continue;
+            }
+            misses++;
+            order.push_front(line);
+            lookup[line] = order.begin();
+            if (order.size() > capacity) {
+                lookup.erase(order.back());
+                order.pop_back();
+            }
+        }
+        return misses;
+    }
+
+private:
+    size_t capacity;
+    std::list<size_t> order;
+    std::unordered_map<size_t, std::list<size_t>::iterator> lookup;
+};
+
+// one stream a pass reads: where vertex i's bytes start and how many of them the shader uses
+struct Stream {
+    size_t base, stride, offset, bytes;
+};
+
+// bytes fetched from memory for one draw of indices reading streams
+static size_t fetchBytes(const std::vector<unsigned int> &indices, const std::vector<Stream> &streams, size_t cacheLines)
+{
+    LineCache cache(cacheLines);
+    std::deque<unsigned int> transformed;
+    size_t misses = 0;
+    for (unsigned int index : indices) {
+        bool hit = false;
+        for (unsigned int t : transformed)
+            hit = hit || t == index;
+        if (hit)
+            continue;
+        transformed.push_back(index);
+        if (transformed.size() > POST_TRANSFORM_ENTRIES)
+            transformed.pop_front();
+        for (const Stream &stream : streams)
+            misses += cache.touch(stream.base + index * stream.stride + stream.offset, stream.bytes);
+    }
+    return misses * LINE_BYTES;
+}
+
+static MeshData grid(unsigned int size)
+{
+    MeshData mesh;
+    mesh.vertices.resize((size + 1) * (size + 1));
+    for (unsigned int y = 0; y <= size; y++)
+        for (unsigned int x = 0; x <= size; x++)
+            mesh.vertices[y * (size + 1) + x].Position = glm::vec3((float)x, 0.0f, (float)y);
+    for (unsigned int y = 0; y < size; y++)
+        for (unsigned int x = 0; x < size; x++) {
+            unsigned int a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+            const unsigned int quad[6] = {a, c, b, b, c, d};
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    return mesh;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<MeshData> meshes;
+    if (argc > 1)
+        meshes = loadObj(argv[1]);
+    else
+        meshes.push_back(grid(512));
+    size_t cacheLines = (argc > 2 ? (size_t)std::atoi(argv[2]) : 16) * 1024 / LINE_BYTES;
+    if (meshes.empty()) {
+        std::cout << "ERROR::VERTEX_FETCH:: no meshes in " << argv[1] << std::endl;
+        return 1;
+    }
+
+    // positions first in both layouts; split keeps the other attributes in a second buffer after them
+    size_t vertices = 0, triangles = 0;
+    size_t interleavedDepth = 0, splitDepth = 0, interleavedFull = 0, splitFull = 0;
+    for (const MeshData &mesh : meshes) {
+        size_t positionBytes = mesh.vertices.size() * sizeof(glm::vec3);
+        Stream interleavedPosition = {0, sizeof(Vertex), 0, sizeof(glm::vec3)};
+        Stream interleavedAll = {0, sizeof(Vertex), 0, sizeof(Vertex)};
+        Stream splitPosition = {0, sizeof(glm::vec3), 0, sizeof(glm::vec3)};
+        Stream splitAttributes = {positionBytes, sizeof(VertexAttributes), 0, sizeof(VertexAttributes)};
+        interleavedDepth += fetchBytes(mesh.indices, {interleavedPosition}, cacheLines);
+        splitDepth += fetchBytes(mesh.indices, {splitPosition}, cacheLines);
+        interleavedFull += fetchBytes(mesh.indices, {interleavedAll}, cacheLines);
+        splitFull += fetchBytes(mesh.indices, {splitPosition, splitAttributes}, cacheLines);
+        vertices += mesh.vertices.size();
+        triangles += mesh.indices.size() / 3;
+    }
+
+    auto line = [&](const char *name, size_t interleaved, size_t split) {
+        std::cout << std::setw(6) << name << ": interleaved " << std::fixed << std::setprecision(1)
+                  << interleaved / 1024.0 << " KB (" << (double)interleaved / vertices << " B/vertex), split "
+                  << split / 1024.0 << " KB (" << (double)split / vertices << " B/vertex), "
+                  << 100.0 * (1.0 - (double)split / interleaved) << "% saved" << std::endl;
+    };
+    std::cout << meshes.size() << " meshes, " << vertices << " vertices, " << triangles << " triangles, "
+              << cacheLines * LINE_BYTES / 1024 << " KB cache of " << LINE_BYTES << " byte lines" << std::endl;
+    line("depth", interleavedDepth, splitDepth);
+    line("full", interleavedFull, splitFull);
+    return 0;
+}